@@ -0,0 +1,284 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "gameboy/cpu.h"
+#include "gameboy/cpu_instruction_decode.h"
+#include "gameboy/gameboy.h"
+#include "gameboy/memory.h"
+#include "gameboy/ppu_sprite.h"
+#include "gameboy/ppu_tile.h"
+
+/*
+ * Throughput of each subsystem, reported as emulated M-cycles per second
+ * and where it makes sense frames per second, so changes can be compared
+ * across commits with --benchmark_format=json
+ */
+
+namespace
+{
+    // M-cycles in one line of 456 dots
+    const double LINE_MCYCLES = 456/4;
+
+    // Code starts after the cart header, jumped to from the entry point
+    const uint16_t CODE_START = 0x150;
+
+    ROMDATA bench_rom(const std::vector<uint8_t>& code)
+    {
+        ROMDATA rom(std::vector<uint8_t>(32768, 0));
+        const std::vector<uint8_t> entry = {0xC3, CODE_START & 0xFF, CODE_START >> 8};
+        std::copy(entry.cbegin(), entry.cend(), rom.begin() + 0x100);
+        std::copy(code.cbegin(), code.cend(), rom.begin() + CODE_START);
+        return rom;
+    }
+
+    // Fixed seed so every run draws the same tiles
+    uint8_t next_random(uint32_t& seed)
+    {
+        seed = seed*1664525 + 1013904223;
+        return seed >> 24;
+    }
+
+    void report(benchmark::State& state, double mcycles, double frames = 0)
+    {
+        state.counters["mcycles_per_second"] = benchmark::Counter(mcycles, benchmark::Counter::kIsRate);
+        if (frames > 0)
+        {
+            state.counters["frames_per_second"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+        }
+    }
+}
+
+// Every opcode decoded, as the CPU does at the start of each instruction
+static void BM_DecodeOpcode(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    GAMEBOY::CpuRegisters registers;
+    for (auto _ : state)
+    {
+        for (int opcode=0; opcode<0x100; opcode++)
+        {
+            GAMEBOY::CpuInstruction* instruction = GAMEBOY::decode_opcode(opcode, registers, memory);
+            benchmark::DoNotOptimize(instruction);
+            delete instruction;
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*0x100);
+}
+BENCHMARK(BM_DecodeOpcode);
+
+// Cpu::tick through a mix of ALU, load & CB instructions, without the rest of the machine
+static void BM_CpuTick(benchmark::State& state)
+{
+    // LD HL,0xC000 then a long block, jumping back to its start
+    std::vector<uint8_t> code = {0x21, 0x00, 0xC0};
+    const std::vector<uint8_t> block = {
+        // LD B,C; ADD A,B; INC C; XOR D; LD (HL),A; LD A,(HL); SWAP A; LD A,0x12
+        0x41, 0x80, 0x0C, 0xAA, 0x77, 0x7E, 0xCB, 0x37, 0x3E, 0x12};
+    for (int i=0; i<512; i++)
+    {
+        code.insert(code.end(), block.cbegin(), block.cend());
+    }
+    // JP back to the block, just after LD HL
+    code.insert(code.end(), {0xC3, (CODE_START + 3) & 0xFF, (CODE_START + 3) >> 8});
+    ROMDATA rom = bench_rom(code);
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    GAMEBOY::Cpu cpu(memory);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cpu.tick());
+    }
+    report(state, state.iterations());
+}
+BENCHMARK(BM_CpuTick);
+
+// Each access takes an M-cycle on hardware
+static void BM_MemoryRead(benchmark::State& state, uint16_t base, uint16_t mask)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    uint16_t offset = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(memory.read(base + (offset++ & mask)));
+    }
+    report(state, state.iterations());
+}
+BENCHMARK_CAPTURE(BM_MemoryRead, rom, GAMEBOY::CART_ROM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryRead, vram, GAMEBOY::VRAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryRead, cart_ram, GAMEBOY::CART_RAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryRead, wram, GAMEBOY::WRAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryRead, oam, GAMEBOY::OAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryRead, io, GAMEBOY::IOHandler::PPU_REG_SCY, 0);
+BENCHMARK_CAPTURE(BM_MemoryRead, hram, GAMEBOY::HRAM_LO, 0x3F);
+
+static void BM_MemoryWrite(benchmark::State& state, uint16_t base, uint16_t mask)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    uint16_t offset = 0;
+    for (auto _ : state)
+    {
+        memory.write(base + (offset & mask), static_cast<uint8_t>(offset));
+        offset++;
+    }
+    report(state, state.iterations());
+}
+BENCHMARK_CAPTURE(BM_MemoryWrite, vram, GAMEBOY::VRAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryWrite, cart_ram, GAMEBOY::CART_RAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryWrite, wram, GAMEBOY::WRAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryWrite, oam, GAMEBOY::OAM_LO, 0x3F);
+BENCHMARK_CAPTURE(BM_MemoryWrite, io, GAMEBOY::IOHandler::PPU_REG_SCY, 0);
+BENCHMARK_CAPTURE(BM_MemoryWrite, hram, GAMEBOY::HRAM_LO, 0x3F);
+
+// Background lines with the tile cache warm
+static void BM_TilemapRenderLine(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    uint32_t seed = 1;
+    for (uint16_t addr=GAMEBOY::VRAM_LO; addr<=GAMEBOY::VRAM_HI; addr++)
+    {
+        memory.write(addr, next_random(seed));
+    }
+    auto render_state = GAMEBOY::PPU_RenderState::capture(memory);
+    GAMEBOY::PPU_Tilemap tilemap(memory.stats());
+    uint8_t line = 0;
+    for (auto _ : state)
+    {
+        render_state.scx = line;
+        render_state.scy = line/2;
+        benchmark::DoNotOptimize(tilemap.render_line(render_state, line));
+        // the cache is only cleared for the first line
+        render_state.vram_modified = false;
+        line = line == GAMEBOY::SCREEN_HEIGHT - 1 ? 0 : line + 1;
+    }
+    report(state, state.iterations()*LINE_MCYCLES, state.iterations()/double(GAMEBOY::SCREEN_HEIGHT));
+}
+BENCHMARK(BM_TilemapRenderLine);
+
+// Lines with all 40 sprites spread over the screen, up to 10 per line
+static void BM_SpritemapRenderLine(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    uint32_t seed = 1;
+    for (uint16_t addr=GAMEBOY::VRAM_LO; addr<GAMEBOY::VRAM_LO + 0x1000; addr++)
+    {
+        memory.write(addr, next_random(seed));
+    }
+    for (uint8_t sprite=0; sprite<40; sprite++)
+    {
+        uint16_t entry = GAMEBOY::OAM_LO + sprite*4;
+        memory.write(entry, 16 + (sprite*14) % GAMEBOY::SCREEN_HEIGHT);
+        memory.write(entry + 1, 8 + (sprite*37) % GAMEBOY::SCREEN_WIDTH);
+        memory.write(entry + 2, sprite);
+        memory.write(entry + 3, (sprite & 0x03) << 5);
+    }
+    // LCD, BG & OBJ enabled
+    memory.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x93);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(memory);
+    render_state.vram_modified = false;
+    GAMEBOY::PPU_Spritemap spritemap(memory.stats());
+    auto line_buffer = std::make_shared<GAMEBOY::LINE_PIXELS>();
+    uint8_t line = 0;
+    for (auto _ : state)
+    {
+        spritemap.render_line(render_state, line, line_buffer);
+        benchmark::DoNotOptimize(line_buffer->data());
+        line = line == GAMEBOY::SCREEN_HEIGHT - 1 ? 0 : line + 1;
+    }
+    report(state, state.iterations()*LINE_MCYCLES, state.iterations()/double(GAMEBOY::SCREEN_HEIGHT));
+}
+BENCHMARK(BM_SpritemapRenderLine);
+
+/*
+ * The timer no longer ticks, TIMA is derived from the clock when read and
+ * the only work is the reload event. Worst case, overflowing every 16 dots
+ */
+static void BM_TimerOverflow(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TMA, 0xFF);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0xFF);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    GAMEBOY::Scheduler& scheduler = memory.scheduler();
+    for (auto _ : state)
+    {
+        scheduler.advance(4);
+    }
+    report(state, state.iterations());
+}
+BENCHMARK(BM_TimerOverflow);
+
+static void BM_TimerReadTima(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher memory(rom, input_handler);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    GAMEBOY::Scheduler& scheduler = memory.scheduler();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA));
+        scheduler.advance(4);
+    }
+    report(state, state.iterations());
+}
+BENCHMARK(BM_TimerReadTima);
+
+static void BM_SystemFrame(benchmark::State& state, std::vector<uint8_t> code)
+{
+    ROMDATA rom = bench_rom(code);
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    uint64_t start = gameboy.cycles();
+    for (auto _ : state)
+    {
+        gameboy.run_frame();
+    }
+    report(state, (gameboy.cycles() - start)/4.0, state.iterations());
+}
+// Copies TIMA & LY across memory, drawing whatever ends up in VRAM
+BENCHMARK_CAPTURE(BM_SystemFrame, busy, std::vector<uint8_t>{
+    0x3E, 0x05, 0xE0, 0x07, 0x21, 0x00, 0x80,
+    0xF0, 0x05, 0x22, 0xF0, 0x44, 0xE0, 0x43, 0x04, 0x18, 0xF6});
+// HALTs until each VBlank, as most games do once a frame's work is done
+BENCHMARK_CAPTURE(BM_SystemFrame, halted, std::vector<uint8_t>{
+    0x3E, 0x01, 0xE0, 0xFF, 0xAF, 0xE0, 0x0F, 0x76, 0x04, 0x18, 0xF9});
+
+// Branching a running machine, then running the child for a frame
+static void BM_Fork(benchmark::State& state)
+{
+    ROMDATA rom = bench_rom({0x3E, 0x05, 0xE0, 0x07, 0x21, 0x00, 0x80,
+        0xF0, 0x05, 0x22, 0xF0, 0x44, 0xE0, 0x43, 0x04, 0x18, 0xF6});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    gameboy.run_frame();
+    bool run_child = state.range(0);
+    uint64_t mcycles = 0;
+    for (auto _ : state)
+    {
+        GAMEBOY::InputHandler child_input_handler;
+        std::unique_ptr<GAMEBOY::Gameboy> child = gameboy.fork(child_input_handler);
+        if (run_child)
+        {
+            mcycles += child->run_frame().cycles/4;
+        }
+        benchmark::DoNotOptimize(child);
+    }
+    report(state, mcycles);
+    state.counters["forks_per_second"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Fork)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include "gameboy/spsc_queue.h"
+
+/*
+ * Plays the APU's samples through an SDL audio device
+ * Samples are handed from the emulation thread to SDL's audio callback
+ * through a lock-free ring. While more than m_MAX_QUEUED is waiting new
+ * samples are dropped, so running faster than real time never builds up
+ * latency, and the callback plays silence when the ring runs dry.
+ */
+class AudioOutput
+{
+private:
+    // interleaved stereo, about 340ms at 48kHz
+    GAMEBOY::SpscRing<int16_t, 32768> m_ring;
+    // about 40ms
+    static const size_t m_MAX_QUEUED = 4096;
+    SDL_AudioDeviceID m_device = 0;
+    uint32_t m_sample_rate = 48000;
+    std::atomic<uint64_t> m_underruns{0};
+    std::atomic<uint64_t> m_dropped{0};
+    static void m_callback(void* userdata, Uint8* stream, int len);
+public:
+    AudioOutput() = default;
+    ~AudioOutput();
+    AudioOutput(const AudioOutput&) = delete;
+    AudioOutput& operator=(const AudioOutput&) = delete;
+    // False if no audio device could be opened
+    bool open();
+    // Rate the device was opened at, which the APU should generate at
+    uint32_t sample_rate();
+    // Queue interleaved stereo samples, from the emulation thread only
+    void submit(const int16_t* samples, size_t frames);
+    // Callbacks which ran out of samples part way through
+    uint64_t underruns();
+    // Frames dropped as too many were queued
+    uint64_t dropped_frames();
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef __APU_H__
+#define __APU_H__
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/apu_synth.h"
+#include "gameboy/scheduler.h"
+
+// https://gbdev.io/pandocs/Audio.html
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * The four DMG sound channels
+     * Nothing runs per M-cycle, the channels are brought up to date when a
+     * register is accessed and on each 512Hz frame sequencer event, which
+     * also hands the samples made since the last event to the callback.
+     * Without a callback the channels' register visible state is kept but
+     * no waveforms are generated.
+     */
+    class APU
+    {
+    public:
+        // Interleaved left & right samples
+        typedef std::function<void(const int16_t* samples, size_t frames)> SAMPLE_CALLBACK;
+        static constexpr uint32_t CLOCK_RATE = 4194304;
+        static const uint16_t REG_LO = 0xFF10;
+        static const uint16_t REG_HI = 0xFF3F;
+        /*
+         * Channel 1, square wave with frequency sweep
+         * NR10 sweep: bits 6-4 pace, bit 3 decrease, bits 2-0 step
+         * NR11 bits 7-6 duty, bits 5-0 initial length
+         * NR12 envelope: bits 7-4 initial volume, bit 3 increase, bits 2-0 pace
+         * NR13 frequency low 8 bits
+         * NR14 bit 7 trigger, bit 6 length enable, bits 2-0 frequency high
+         */
+        static const uint16_t NR10 = 0xFF10;
+        static const uint16_t NR11 = 0xFF11;
+        static const uint16_t NR12 = 0xFF12;
+        static const uint16_t NR13 = 0xFF13;
+        static const uint16_t NR14 = 0xFF14;
+        // Channel 2, square wave, as channel 1 without the sweep
+        static const uint16_t NR21 = 0xFF16;
+        static const uint16_t NR22 = 0xFF17;
+        static const uint16_t NR23 = 0xFF18;
+        static const uint16_t NR24 = 0xFF19;
+        /*
+         * Channel 3, 32 4-bit samples from wave RAM
+         * NR30 bit 7 DAC enable
+         * NR31 initial length
+         * NR32 bits 6-5 output level: mute, 100%, 50%, 25%
+         */
+        static const uint16_t NR30 = 0xFF1A;
+        static const uint16_t NR31 = 0xFF1B;
+        static const uint16_t NR32 = 0xFF1C;
+        static const uint16_t NR33 = 0xFF1D;
+        static const uint16_t NR34 = 0xFF1E;
+        /*
+         * Channel 4, noise from a linear feedback shift register
+         * NR43 bits 7-4 clock shift, bit 3 7-bit LFSR, bits 2-0 clock divider
+         */
+        static const uint16_t NR41 = 0xFF20;
+        static const uint16_t NR42 = 0xFF21;
+        static const uint16_t NR43 = 0xFF22;
+        static const uint16_t NR44 = 0xFF23;
+        /*
+         * NR50 bits 6-4 left volume, bits 2-0 right volume
+         * NR51 bits 7-4 channels 4-1 to the left, bits 3-0 to the right
+         * NR52 bit 7 power, bits 3-0 channel 4-1 active, read only
+         */
+        static const uint16_t NR50 = 0xFF24;
+        static const uint16_t NR51 = 0xFF25;
+        static const uint16_t NR52 = 0xFF26;
+        static const uint16_t WAVE_RAM_LO = 0xFF30;
+        static const uint16_t WAVE_RAM_HI = 0xFF3F;
+    private:
+        // 512Hz, from bit 4 of DIV
+        static constexpr uint64_t m_FRAME_SEQUENCER_CYCLES = 8192;
+        struct Envelope
+        {
+            uint8_t volume = 0;
+            uint8_t timer = 0;
+        };
+        struct Channel
+        {
+            bool enabled = false;
+            uint16_t length = 0;
+            // cycle the channel's waveform next steps
+            uint64_t next_step = 0;
+            // duty position, wave position or LFSR
+            uint16_t phase = 0;
+            Envelope envelope;
+            // amplitude last added to the left & right buffers
+            float left = 0;
+            float right = 0;
+        };
+        Scheduler& m_scheduler;
+        std::array<uint8_t, REG_HI - REG_LO + 1> m_regs = {};
+        std::array<Channel, 4> m_channels;
+        uint8_t m_sequencer_step = 0;
+        // channel 1 frequency sweep
+        uint16_t m_sweep_shadow = 0;
+        uint8_t m_sweep_timer = 0;
+        bool m_sweep_enabled = false;
+        // channels are up to date to this cycle
+        uint64_t m_synth_time = 0;
+        // synthesis, only while there is a callback
+        SAMPLE_CALLBACK m_sample_callback;
+        uint32_t m_sample_rate = 0;
+        uint64_t m_frame_start = 0;
+        std::unique_ptr<BandlimitedBuffer> m_left;
+        std::unique_ptr<BandlimitedBuffer> m_right;
+        std::vector<int16_t> m_out;
+        uint8_t& m_reg(uint16_t addr)
+        {
+            return m_regs[addr - REG_LO];
+        }
+        bool m_powered()
+        {
+            return m_reg(NR52) & 0x80;
+        }
+        uint16_t m_frequency(size_t channel);
+        void m_frequency(size_t channel, uint16_t frequency);
+        uint64_t m_period(size_t channel);
+        bool m_dac(size_t channel);
+        void m_trigger(size_t channel, uint64_t time);
+        uint8_t m_output(size_t channel);
+        void m_step(size_t channel);
+        // Brings the channels up to the given cycle
+        void m_run(uint64_t time);
+        // Adds any change in a channel's amplitude at the cycle
+        void m_update(size_t channel, uint64_t time);
+        uint16_t m_sweep_next();
+        void m_sequencer_event(uint64_t time);
+        void m_emit(uint64_t time);
+    public:
+        APU(Scheduler& scheduler);
+        APU(const APU&) = delete;
+        APU& operator=(const APU&) = delete;
+        uint8_t read(uint16_t addr);
+        void write(uint16_t addr, uint8_t data);
+        /*
+         * Generate stereo samples at the sample rate, handed over in batches
+         * of around 2ms of audio. An empty callback stops synthesis
+         */
+        void on_samples(SAMPLE_CALLBACK callback, uint32_t sample_rate = 48000);
+        // Hand over the samples made up to now, rather than waiting for the next batch
+        void flush();
+        // Registers and channel state, synthesis restarts from the loaded cycle
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+    };
+};
+
+#endif
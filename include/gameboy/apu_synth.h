@@ -0,0 +1,75 @@
+#ifndef __APU_SYNTH_H__
+#define __APU_SYNTH_H__
+
+#include <array>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    /*
+     * Resamples a signal made of steps at the machine clock down to the
+     * host sample rate without aliasing
+     * Each change in level is added as a band-limited impulse, a windowed
+     * sinc picked from a table by the fractional sample position, and
+     * samples are read back as the running sum of the impulses. The work
+     * is proportional to the number of changes rather than the clock rate,
+     * and the inner loops run over fixed size float arrays so the compiler
+     * can vectorise them.
+     */
+    class BandlimitedBuffer
+    {
+    public:
+        static const size_t TAPS = 16;
+        static const size_t PHASE_BITS = 6;
+        static const size_t PHASES = 1 << PHASE_BITS;
+    private:
+        typedef std::array<float, TAPS> KERNEL;
+        std::array<KERNEL, PHASES> m_kernels;
+        // samples per clock as 32.32 fixed point
+        uint64_t m_factor;
+        // position of clock 0 of the current frame, 32.32 fixed point
+        uint64_t m_offset = 0;
+        std::vector<float> m_samples;
+        size_t m_available = 0;
+        float m_sum = 0;
+        // DC blocking filter, as on hardware
+        float m_dc = 0;
+        // Make room for at least size samples, keeping those written
+        void m_grow(size_t size);
+    public:
+        BandlimitedBuffer(uint32_t clock_rate, uint32_t sample_rate, size_t capacity);
+        // Add a change in level at a clock since the start of the frame
+        void add_delta(uint32_t time, float delta)
+        {
+            uint64_t position = m_offset + time*m_factor;
+            size_t index = position >> 32;
+            // a frame longer than the capacity, never drop the step
+            if (index + TAPS > m_samples.size())
+            {
+                m_grow(index + TAPS);
+            }
+            const KERNEL& kernel = m_kernels[(position >> (32 - PHASE_BITS)) & (PHASES - 1)];
+            float* out = m_samples.data() + index;
+            for (size_t tap=0; tap<TAPS; tap++)
+            {
+                out[tap] += kernel[tap]*delta;
+            }
+        }
+        // Samples before this clock are complete, which starts a new frame
+        void end_frame(uint32_t time);
+        size_t available() const
+        {
+            return m_available;
+        }
+        /*
+         * Read up to count samples, each written stride apart so channels
+         * can be interleaved, returns the number read
+         */
+        size_t read(int16_t* out, size_t count, size_t stride = 1, float gain = 1.0f);
+        void clear();
+    };
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/gameboy.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Runs many Gameboy instances across a pool of worker threads
+     * Instances are stepped a quantum of frames at a time. Each worker
+     * keeps a queue of instances and cycles through its own, so an
+     * instance stays on the same thread, and on Linux the same core,
+     * between quanta. A worker which runs out takes the instance least
+     * recently queued on another worker. Every instance has its own timer
+     * and serial output, nothing else is shared between them.
+     */
+    class BatchRunner
+    {
+    public:
+        /*
+         * Called on the worker thread after each quantum, such as to
+         * change the buttons held. Returning false finishes the instance
+         */
+        typedef std::function<bool(Gameboy&, InputHandler&)> QUANTUM_CALLBACK;
+        struct Stats
+        {
+            size_t instances = 0;
+            size_t threads = 0;
+            // emulated frames & T-cycles across all instances
+            uint64_t frames = 0;
+            uint64_t cycles = 0;
+            // instances taken from another worker's queue
+            uint64_t steals = 0;
+            double seconds = 0;
+            double frames_per_second = 0;
+        };
+    private:
+        struct Instance
+        {
+            InputHandler input_handler;
+            std::unique_ptr<Gameboy> gameboy;
+            uint64_t frames;
+            uint64_t frames_run = 0;
+            bool finished = false;
+            QUANTUM_CALLBACK callback;
+            std::vector<uint8_t> serial;
+            // time spent running quanta, not waiting in a queue
+            uint64_t run_ns = 0;
+            std::exception_ptr error;
+        };
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<size_t> queue;
+        };
+        size_t m_threads;
+        std::vector<std::unique_ptr<Instance>> m_instances;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<size_t> m_remaining{0};
+        std::atomic<uint64_t> m_steals{0};
+        std::atomic<bool> m_failed{false};
+        bool m_isolate_errors = false;
+        bool m_next(size_t worker, size_t& index);
+        void m_work(size_t worker, uint32_t quantum_frames);
+    public:
+        // 0 threads uses one per hardware thread
+        BatchRunner(size_t threads = 0);
+        // Add an instance to run for the given number of frames
+        size_t add(ROMDATA& rom, uint64_t frames, QUANTUM_CALLBACK callback = nullptr);
+        size_t size() const;
+        Gameboy& gameboy(size_t index);
+        InputHandler& input_handler(size_t index);
+        // Bytes the instance has sent over serial
+        const std::vector<uint8_t>& serial(size_t index) const;
+        uint64_t frames_run(size_t index) const;
+        // Seconds the instance has spent running on a worker
+        double seconds(size_t index) const;
+        /*
+         * When set, an exception thrown by an instance only finishes that
+         * instance, kept for error(), instead of stopping the run
+         */
+        void isolate_errors(bool isolate);
+        // The exception which finished an isolated instance, if any
+        std::exception_ptr error(size_t index) const;
+        /*
+         * Run every unfinished instance to completion, returning once all
+         * have finished. Unless errors are isolated, the first exception
+         * thrown by an instance stops the run and is rethrown
+         */
+        Stats run(uint32_t quantum_frames = 1);
+    };
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __CONFORMANCE_H__
+#define __CONFORMANCE_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/gameboy.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Watches a test ROM for the ways Blargg & mooneye style suites say
+     * they have finished
+     *  - "Passed" or "Failed" sent over serial, or mooneye's Fibonacci bytes
+     *  - LD B,B, passing if B, C, D, E, H & L hold 3, 5, 8, 13, 21 & 34
+     *  - JR -2 with interrupts off, which nothing can leave
+     * ROMs still running once the cycle budget is spent time out
+     */
+    class ConformanceMonitor
+    {
+    public:
+        enum class STATUS: uint8_t
+        {
+            RUNNING,
+            PASSED,
+            FAILED,
+            TIMEOUT
+        };
+        // How the ROM finished
+        enum class SOURCE: uint8_t
+        {
+            NONE,
+            SERIAL,
+            BREAKPOINT,
+            LOOP,
+            BUDGET
+        };
+    private:
+        Gameboy& m_gameboy;
+        uint64_t m_budget;
+        STATUS m_status = STATUS::RUNNING;
+        SOURCE m_source = SOURCE::NONE;
+        uint64_t m_cycles = 0;
+        // cycle the ROM was first seen stuck in a loop
+        bool m_looped = false;
+        uint64_t m_loop_cycles = 0;
+        void m_finish(STATUS status, SOURCE source, uint64_t cycles);
+        void m_breakpoint(const CpuRegisters& registers, uint8_t opcode);
+    public:
+        // Sets the gameboy's breakpoint callback, so must outlive its runs
+        ConformanceMonitor(Gameboy& gameboy, uint64_t cycle_budget);
+        ConformanceMonitor(const ConformanceMonitor&) = delete;
+        ConformanceMonitor& operator=(const ConformanceMonitor&) = delete;
+        /*
+         * Called between runs with the serial output so far, returns
+         * RUNNING until the ROM has finished
+         */
+        STATUS check(const std::vector<uint8_t>& serial);
+        STATUS status() const
+        {
+            return m_status;
+        }
+        SOURCE source() const
+        {
+            return m_source;
+        }
+        // T-cycles the ROM took to finish, to the end of the run it
+        // finished in for serial output & budgets
+        uint64_t cycles() const
+        {
+            return m_cycles;
+        }
+        static const char* name(STATUS status);
+        static const char* name(SOURCE source);
+    };
+};
+
+#endif
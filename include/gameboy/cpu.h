@@ -1,26 +1,57 @@
 #ifndef __CPU_H__
 #define __CPU_H__
 
+#include <functional>
+
 #include "gameboy/cpu_registers.h"
 #include "gameboy/cpu_instruction.h"
 #include "gameboy/cpu_interrupt.h"
 #include "gameboy/memory.h"
 #include "gameboy/rom.h"
-#include "gameboy/timer.h"
+#include "gameboy/trace.h"
 
 namespace GAMEBOY
 {
     class Cpu
     {
+    public:
+        // Registers before the instruction & its opcode
+        typedef std::function<void(const CpuRegisters&, uint8_t)> BREAKPOINT_CALLBACK;
     private:
         CpuInstruction* currentInstruction = nullptr;
         CpuRegisters registers;
         AddressDispatcher& memory;
         InterruptHandler interruptHandler;
+        bool m_halted = false;
+        bool m_stopped = false;
+        BREAKPOINT_CALLBACK m_breakpoint;
+        // INSTRUCTION & INTERRUPT records, with the registers before
+        void m_trace(TraceRecorder& tracer, TraceKind kind, uint8_t opcode, uint16_t addr);
     public:
         Cpu(AddressDispatcher& memory)
         : memory(memory) {}
         const CpuRegisters& tick();
+        /*
+         * True while HALTed with no interrupt pending, in which case
+         * nothing changes until another component requests an interrupt
+         */
+        bool halted();
+        /*
+         * True between instructions, or while HALTed or STOPped
+         * Save states can only be taken at an instruction boundary
+         */
+        bool instruction_boundary();
+        // Registers & HALT/STOP, throws std::logic_error mid-instruction
+        void save_state(StateWriter& state);
+        void load_state(StateReader& state);
+        /*
+         * Called before running LD B,B, the software breakpoint test ROMs
+         * use, and JR -2, the infinite loop they end in
+         */
+        void on_breakpoint(BREAKPOINT_CALLBACK callback)
+        {
+            m_breakpoint = callback;
+        }
     };
 };
 
@@ -0,0 +1,19 @@
+#ifndef __CPU_DISASM_H__
+#define __CPU_DISASM_H__
+
+#include <string>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    // Bytes taken by the instruction, including the opcode & any CB prefix
+    uint8_t instruction_length(uint8_t opcode);
+    /*
+     * Text for the instruction at pc, given the bytes after the opcode
+     * Relative jumps show their target, opcodes the CPU doesn't have
+     * show as DB $XX
+     */
+    std::string disassemble(uint16_t pc, uint8_t opcode, uint8_t op0, uint8_t op1);
+};
+
+#endif
@@ -28,8 +28,9 @@ namespace GAMEBOY
         AddressDispatcher& memory;
         uint8_t step = 0;
     public:
-        HALT(CpuRegisters& registers, AddressDispatcher& memory)
-        : registers(registers), memory(memory) {}
+        // step 1 resumes an already HALTed CPU, such as from a save state
+        HALT(CpuRegisters& registers, AddressDispatcher& memory, uint8_t step = 0)
+        : registers(registers), memory(memory), step(step) {}
         InstructionResult tick();
     };
 
@@ -43,8 +44,8 @@ namespace GAMEBOY
         AddressDispatcher& memory;
         uint8_t step = 0;
     public:
-        STOP(CpuRegisters& registers, AddressDispatcher& memory)
-        : registers(registers), memory(memory) {}
+        STOP(CpuRegisters& registers, AddressDispatcher& memory, uint8_t step = 0)
+        : registers(registers), memory(memory), step(step) {}
         InstructionResult tick();
     };
 
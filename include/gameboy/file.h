@@ -0,0 +1,34 @@
+#ifndef __FILE_H__
+#define __FILE_H__
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    /*
+     * File access used by the core, such as loading ROMs
+     * Frontends can supply their own, e.g. to read from an archive
+     * or a platform specific storage API
+     */
+    class FileInterface
+    {
+    public:
+        virtual ~FileInterface() = default;
+        virtual std::optional<std::vector<uint8_t>> read(const std::string& path) = 0;
+        virtual bool write(const std::string& path, const std::vector<uint8_t>& data) = 0;
+        // Backed by the C++ standard library
+        static FileInterface& standard();
+    };
+
+    class StdFileInterface: public FileInterface
+    {
+    public:
+        std::optional<std::vector<uint8_t>> read(const std::string& path) override;
+        bool write(const std::string& path, const std::vector<uint8_t>& data) override;
+    };
+};
+
+#endif
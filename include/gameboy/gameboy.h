@@ -7,8 +7,29 @@
 #include "gameboy/memory_dma.h"
 #include "gameboy/input.h"
 
+#include <memory>
+#include <vector>
+
 namespace GAMEBOY
 {
+    struct RunResult
+    {
+        enum class STOP_REASON: uint8_t
+        {
+            // a frame was completed, entering VBlank
+            FRAME,
+            // the cycle budget ran out
+            CYCLES,
+            // an event in the requested mask was dispatched
+            EVENT,
+            // the predicate returned true
+            PREDICATE
+        };
+        STOP_REASON reason;
+        // T-cycles executed, always whole M-cycles
+        uint64_t cycles;
+    };
+
     class Gameboy
     {
     private:
@@ -16,10 +37,129 @@ namespace GAMEBOY
         Cpu cpu;
         PPU ppu;
         DmaController dma;
+        // Global checksum from the cartridge header, save states only
+        // load into a machine running the same ROM
+        uint16_t m_rom_checksum;
+        RunResult m_run(uint64_t max_cycles, uint32_t event_mask, bool stop_on_frame);
+        void m_skip_halt(uint64_t end);
+        void m_finish_instruction();
+        void m_load_state(const std::vector<uint8_t>& in);
+        // Shares the parent's memory, the rest starts from power on
+        Gameboy(Gameboy& parent, InputHandler& input_handler);
     public:
-        Gameboy(ROMDATA& rom, InputHandler& input_handler, std::shared_ptr<LINE_PIXELS> line_buffer)
-        : memory(rom, input_handler), cpu(memory), ppu(memory, line_buffer), dma(memory) {}
+        Gameboy(ROMDATA& rom, InputHandler& input_handler);
+        /*
+         * Advance 1 M-cycle, returns true when a frame has been completed
+         * Components other than the CPU only run when one of their
+         * scheduled events becomes due
+         */
         bool tick();
+        /*
+         * Batch run APIs, keeping the loop inside the core
+         * While the CPU is HALTed the clock jumps straight to the next event
+         */
+        // Run until the next frame is completed, or a frame's worth of
+        // cycles has passed with the LCD off, or max_cycles if sooner
+        RunResult run_frame(uint64_t max_cycles = FRAME_CYCLES);
+        // Run at least the given number of T-cycles
+        RunResult run_cycles(uint64_t cycles);
+        // Run until an event with its event_bit set in the mask has been dispatched
+        RunResult run_until_event(uint32_t event_mask, uint64_t max_cycles = FRAME_CYCLES);
+        // Run until the predicate, checked after each M-cycle, returns true
+        template<typename PREDICATE>
+        RunResult run_until(PREDICATE predicate, uint64_t max_cycles = FRAME_CYCLES)
+        {
+            Scheduler& scheduler = memory.scheduler();
+            uint64_t start = scheduler.now();
+            while (scheduler.now() - start < max_cycles)
+            {
+                cpu.tick();
+                scheduler.advance(4);
+                if (predicate())
+                {
+                    return {RunResult::STOP_REASON::PREDICATE, scheduler.now() - start};
+                }
+            }
+            return {RunResult::STOP_REASON::CYCLES, scheduler.now() - start};
+        }
+        // T-cycles since power on
+        uint64_t cycles();
+        /*
+         * Completed frames are read from the front buffer, which stays
+         * valid until the next frame completes
+         */
+        const FRAME_PIXELS& frame();
+        // Incremented each time a drawn frame completes, frames
+        // skipped by frameskip() aren't counted
+        uint64_t frame_sequence();
+        void on_frame_ready(PPU_Framebuffer::FRAME_READY_CALLBACK callback);
+        // Bytes sent over serial by this instance only
+        void on_serial_out(IOHandler::SERIAL_OUT_CALLBACK callback);
+        /*
+         * Snapshot of the performance counters since power on, which
+         * aren't part of save states so carry on across loads
+         */
+        Stats stats();
+        // Sound, set APU::on_samples to generate samples
+        APU& apu();
+        PPU_FrameSkip& frameskip();
+        /*
+         * Draw lines on a render thread alongside emulation, off by
+         * default as batches already keep every core busy
+         */
+        bool render_thread();
+        void render_thread(bool enabled);
+        /*
+         * Record execution to a trace, which must stay open until it's
+         * detached by setting nullptr. Forks don't inherit the tracer
+         */
+        TraceRecorder* tracer();
+        void tracer(TraceRecorder* tracer);
+        // LD B,B & JR -2, see Cpu::on_breakpoint. Forks don't inherit it
+        void on_breakpoint(Cpu::BREAKPOINT_CALLBACK callback);
+        // Read memory without side effects, see AddressDispatcher::peek
+        uint8_t peek(uint16_t addr);
+        // Framebuffer settings, such as also emitting RGBA8888 frames
+        PPU_Framebuffer& framebuffer();
+        /*
+         * Save states are a versioned binary snapshot of the whole machine,
+         * including the input handler's buttons but not the ROM or host
+         * settings such as frame skip. States are taken between
+         * instructions, so saving first finishes the instruction in flight.
+         * The output vector is cleared, reusing its capacity
+         */
+        static const uint16_t STATE_VERSION = 6;
+        // Global checksum from the cartridge header
+        uint16_t rom_checksum();
+        void save_state(std::vector<uint8_t>& out);
+        std::vector<uint8_t> save_state();
+        /*
+         * Throws std::invalid_argument for states from a different version
+         * or ROM, or holding invalid values, and std::out_of_range for
+         * truncated states. Either way the machine is left unchanged
+         */
+        void load_state(const std::vector<uint8_t>& in);
+        /*
+         * Independent copy of the running machine, for searching many
+         * inputs from one state. The ROM is shared and WRAM, VRAM, OAM &
+         * cartridge RAM are shared copy on write a page at a time, so a
+         * child costs the pages either side writes afterwards. Like
+         * save_state() the instruction in flight is finished first.
+         * The child takes its buttons from the parent, with host settings
+         * at their defaults and its performance counters from zero. It can
+         * run on any thread, but the parent mustn't run during the fork
+         */
+        std::unique_ptr<Gameboy> fork(InputHandler& input_handler);
+        /*
+         * Battery backed cartridge RAM in the layout of .sav files, with
+         * the MBC3 clock appended, empty for cartridges without a battery.
+         * The clock counts emulated time, so speeds up with fast-forward,
+         * and on load catches up on the host time since it was saved.
+         * Host time is in seconds since the Unix epoch
+         */
+        std::vector<uint8_t> save_battery(int64_t host_time);
+        // Throws std::invalid_argument, changing nothing, for saves which don't fit the cartridge
+        void load_battery(const std::vector<uint8_t>& in, int64_t host_time);
     };
 };
 
@@ -5,6 +5,9 @@
 
 namespace GAMEBOY
 {
+    class StateWriter;
+    class StateReader;
+
     class InputHandler
     {
     private:
@@ -28,6 +31,8 @@ namespace GAMEBOY
         void btn_up(BUTTON btn);
         uint8_t poll_irq();
         void set_irq(uint8_t state);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 };
 
@@ -0,0 +1,124 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+/*
+ * Lowest level compiled in, statements using the GBEMU_LOG macros below
+ * this level are removed entirely, including formatting their arguments
+ * 0: DEBUG, 1: INFO, 2: WARN, 3: ERROR, 4: CRITICAL
+ */
+#ifndef GBEMU_LOG_MIN_LEVEL
+#define GBEMU_LOG_MIN_LEVEL 0
+#endif
+
+namespace GAMEBOY
+{
+    enum class LOG_LEVEL: uint8_t
+    {
+        DEBUG,
+        INFO,
+        WARN,
+        ERROR,
+        CRITICAL
+    };
+
+    /*
+     * The core doesn't depend on any particular logging library,
+     * messages are formatted and passed to the sink, which by default
+     * writes them to stderr. Frontends can install their own sink,
+     * which should be done before any emulation is started.
+     */
+    typedef std::function<void(LOG_LEVEL, const char*)> LOG_SINK;
+    // Runtime minimum level, read inline so filtered messages cost a compare
+    extern std::atomic<LOG_LEVEL> log_runtime_level;
+    inline bool log_enabled(LOG_LEVEL level)
+    {
+        return level >= log_runtime_level.load(std::memory_order_relaxed);
+    }
+    // Whether GBEMU_LOG statements at this level are compiled in at all
+    constexpr bool log_compiled([[maybe_unused]] LOG_LEVEL level)
+    {
+#if GBEMU_LOG_MIN_LEVEL > 0
+        return static_cast<int>(level) >= GBEMU_LOG_MIN_LEVEL;
+#else
+        // every level, without an always true compare
+        return true;
+#endif
+    }
+    // An empty sink restores the default
+    void log_sink(LOG_SINK sink);
+    // Messages below this level are dropped, defaults to INFO
+    void log_level(LOG_LEVEL level);
+    LOG_LEVEL log_level();
+    const char* log_level_name(LOG_LEVEL level);
+    void log(LOG_LEVEL level, const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    /*
+     * Limits a single call site, for messages caused by emulated code
+     * which can otherwise repeat every instruction
+     * Repeats of the previous message are counted instead of logged, and
+     * at most max_per_window messages are logged per window, with the
+     * number dropped reported once the window has passed
+     */
+    class LogLimiter
+    {
+    private:
+        std::mutex m_mutex;
+        const uint32_t m_max_per_window;
+        const std::chrono::steady_clock::duration m_window;
+        std::chrono::steady_clock::time_point m_window_start;
+        uint32_t m_window_count = 0;
+        uint32_t m_suppressed = 0;
+        uint32_t m_repeats = 0;
+        LOG_LEVEL m_last_level = LOG_LEVEL::DEBUG;
+        std::string m_last;
+        void m_flush();
+    public:
+        LogLimiter(uint32_t max_per_window = 10,
+                std::chrono::steady_clock::duration window = std::chrono::seconds(1));
+        void log(LOG_LEVEL level, const char* format, ...)
+            __attribute__((format(printf, 3, 4)));
+        // Report any repeated or dropped messages now
+        void flush();
+    };
+};
+
+#define GBEMU_LOG(level, ...) \
+    do { \
+        if constexpr (::GAMEBOY::log_compiled(level)) \
+        { \
+            if (::GAMEBOY::log_enabled(level)) \
+            { \
+                ::GAMEBOY::log(level, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+// Rate limited & deduplicated per call site
+#define GBEMU_LOG_LIMITED(level, ...) \
+    do { \
+        if constexpr (::GAMEBOY::log_compiled(level)) \
+        { \
+            if (::GAMEBOY::log_enabled(level)) \
+            { \
+                static ::GAMEBOY::LogLimiter gbemu_log_limiter; \
+                gbemu_log_limiter.log(level, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define GBEMU_LOG_DEBUG(...) GBEMU_LOG(::GAMEBOY::LOG_LEVEL::DEBUG, __VA_ARGS__)
+#define GBEMU_LOG_INFO(...) GBEMU_LOG(::GAMEBOY::LOG_LEVEL::INFO, __VA_ARGS__)
+#define GBEMU_LOG_WARN(...) GBEMU_LOG(::GAMEBOY::LOG_LEVEL::WARN, __VA_ARGS__)
+#define GBEMU_LOG_ERROR(...) GBEMU_LOG(::GAMEBOY::LOG_LEVEL::ERROR, __VA_ARGS__)
+#define GBEMU_LOG_CRITICAL(...) GBEMU_LOG(::GAMEBOY::LOG_LEVEL::CRITICAL, __VA_ARGS__)
+#define GBEMU_LOG_WARN_LIMITED(...) GBEMU_LOG_LIMITED(::GAMEBOY::LOG_LEVEL::WARN, __VA_ARGS__)
+
+#endif
@@ -2,61 +2,87 @@
 #define __MEMORY_H__
 
 #include <array>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <stdint.h>
-#include <SDL2/SDL_log.h>
 
 #include "gameboy/rom.h"
 #include "gameboy/memory_access.h"
+#include "gameboy/memory_cart.h"
+#include "gameboy/memory_cow.h"
 #include "gameboy/memory_io.h"
+#include "gameboy/memory_map.h"
 #include "gameboy/input.h"
-
-// https://gbdev.io/pandocs/Memory_Map.html
+#include "gameboy/scheduler.h"
+#include "gameboy/stats.h"
 
 namespace GAMEBOY
 {
-    const static uint16_t CART_ROM_LO = 0x0000;
-    const static uint16_t CART_ROM_HI = 0x7FFF;
-    const static uint16_t VRAM_LO = 0x8000;
-    const static uint16_t VRAM_HI = 0x9FFF;
-    const static uint16_t CART_RAM_LO = 0xA000;
-    const static uint16_t CART_RAM_HI = 0xBFFF;
-    const static uint16_t WRAM_LO = 0xC000;
-    const static uint16_t WRAM_HI = 0xDFFF;
-    const static uint16_t OAM_LO = 0xFE00;
-    const static uint16_t OAM_HI = 0xFE9F;
-    const static uint16_t IO_REG_LO = 0xFF00;
-    const static uint16_t INTERRUPT_FLAG = 0xFF0F;
-    const static uint16_t IO_REG_HI = 0xFF7F;
-    const static uint16_t HRAM_LO = 0xFF80;
-    const static uint16_t HRAM_HI = 0xFFFE;
-    const static uint16_t INTERRUPT_ENABLE = 0xFFFF;
-    
-    class CartMapper
-    {
-    public:
-        static CartMapper* create_mapper(ROMDATA& rom);
-        virtual uint8_t read(uint16_t addr) = 0;
-        virtual void write(uint16_t addr, uint8_t data) = 0;
-    };
+    typedef CowMemory<VRAM_HI - VRAM_LO + 1> VRAM_DATA;
+    // a single page, the whole of OAM is copied on write
+    typedef CowMemory<OAM_HI - OAM_LO + 1, OAM_HI - OAM_LO + 1> OAM_MEMORY;
+    typedef OAM_MEMORY::PAGE OAM_DATA;
+
+    class StateWriter;
+    class StateReader;
+    class TraceRecorder;
 
     class AddressDispatcher
     {
+    public:
+        // Address & value about to be written
+        typedef std::function<void(uint16_t, uint8_t)> RENDER_WRITE_HOOK;
     private:
-        CartMapper* cartMapper;
+        // declared first, the IO registers schedule events from construction
+        Scheduler m_scheduler;
+        // counters for every component, which all hold the dispatcher
+        Stats m_stats;
+        Cartridge cartridge;
         IOHandler ioHandler;
-        std::array<uint8_t, 0x2000> videoRam = {0};
-        std::array<uint8_t, 0x2000> workRam = {0};
-        std::array<uint8_t, 0xA0> oam = {0};
+        /*
+         * Copy on write, so the PPU can keep the VRAM a line was drawn
+         * from without copying it. A write while a snapshot is held
+         * moves the dispatcher onto a new copy of the page table, which
+         * only copies the page written
+         */
+        std::shared_ptr<VRAM_DATA> videoRam = std::make_shared<VRAM_DATA>();
+        CowMemory<WRAM_HI - WRAM_LO + 1> workRam;
+        OAM_MEMORY oam;
         std::array<uint8_t, 0x7F> highRam = {0};
         bool vramModified = false;
+        // Called before CPU writes which can change the output of a line being drawn
+        RENDER_WRITE_HOOK m_render_write_hook;
         bool vramLocked = false;
         bool oamLocked = false;
         bool dmaLocked = false;
+        TraceRecorder* m_tracer = nullptr;
+        // only while the CPU runs an instruction, other components poll registers
+        bool m_trace_accesses = false;
+        uint8_t m_read(uint16_t addr, MemoryAccessSource src);
     public:
         AddressDispatcher(ROMDATA& rom, InputHandler& input_handler);
+        /*
+         * Fork of the parent's memory & cartridge, sharing the ROM and
+         * memory copy on write. The caller copies the registers across
+         * with save_registers() once the other components are built
+         */
+        AddressDispatcher(const AddressDispatcher& parent, InputHandler& input_handler);
+        // components hold references into the dispatcher
+        AddressDispatcher(const AddressDispatcher&) = delete;
+        AddressDispatcher& operator=(const AddressDispatcher&) = delete;
         uint8_t read(uint16_t addr, MemoryAccessSource src=MemoryAccessSource::CPU);
         void write(uint16_t addr, uint8_t data, MemoryAccessSource src=MemoryAccessSource::CPU);
+        /*
+         * Read without side effects, ignoring locks & not counted in the
+         * stats, for tools looking at memory. IO registers other than
+         * IE read as 0xFF
+         */
+        uint8_t peek(uint16_t addr);
+        uint16_t rom_bank() const
+        {
+            return cartridge.rom_bank();
+        }
         enum class LOCKABLE
         {
             VRAM,
@@ -65,8 +91,69 @@ namespace GAMEBOY
         };
         void lock(LOCKABLE target);
         void unlock(LOCKABLE target);
-        bool vram_poll_modified();
+        // True if VRAM has been written since the last call
         bool vram_pop_modified();
+        // The same, without clearing it
+        bool vram_modified() const
+        {
+            return vramModified;
+        }
+        std::shared_ptr<const VRAM_DATA> vram_snapshot() const
+        {
+            return videoRam;
+        }
+        const OAM_DATA& oam_data() const
+        {
+            return oam.page(0);
+        }
+        void on_render_write(RENDER_WRITE_HOOK hook);
+        Scheduler& scheduler()
+        {
+            return m_scheduler;
+        }
+        Stats& stats()
+        {
+            return m_stats;
+        }
+        const PALETTE_LUT& palette(IOHandler::PALETTE palette);
+        APU& apu()
+        {
+            return ioHandler.apu();
+        }
+        Timer& timer()
+        {
+            return ioHandler.timer();
+        }
+        void on_serial_out(IOHandler::SERIAL_OUT_CALLBACK callback);
+        // Trace the machine is recording to, if any
+        TraceRecorder* tracer()
+        {
+            return m_tracer;
+        }
+        void tracer(TraceRecorder* tracer)
+        {
+            m_tracer = tracer;
+        }
+        // Record accesses to the tracer, set by the CPU around instructions
+        void trace_accesses(bool enabled)
+        {
+            m_trace_accesses = enabled;
+        }
+        // Memory, IO registers & the cartridge, but not the scheduler
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+        // IO registers, HRAM & locks, the state forks don't share
+        void save_registers(StateWriter& state) const;
+        void load_registers(StateReader& state);
+        // See Cartridge::save_battery
+        std::vector<uint8_t> save_battery(int64_t host_time) const
+        {
+            return cartridge.save_battery(host_time);
+        }
+        void load_battery(const std::vector<uint8_t>& in, int64_t host_time)
+        {
+            cartridge.load_battery(in, host_time);
+        }
     };
 };
 
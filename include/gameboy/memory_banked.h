@@ -0,0 +1,76 @@
+#ifndef __MEMORY_BANKED_H__
+#define __MEMORY_BANKED_H__
+
+#include <array>
+#include <stdint.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "gameboy/memory_map.h"
+#include "gameboy/rom.h"
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+    class Scheduler;
+
+    /*
+     * Common base of the mappers
+     * The ROM is kept as one flat image shared by every copy, and the
+     * cartridge RAM as copy on write banks. A mapper only decodes its
+     * register writes into which banks are mapped, the cartridge reads
+     * through the pointers from banks() without asking the mapper
+     */
+    class BankedMapper
+    {
+    private:
+        // shared with clones
+        std::shared_ptr<const std::vector<uint8_t>> m_rom;
+        size_t m_rom_banks;
+        std::vector<CART_RAM_BANK> m_ram;
+        bool m_battery;
+        uint16_t m_ram_mask;
+        uint8_t m_ram_fill;
+        std::array<uint16_t, 2> m_rom_map = {0, 1};
+        bool m_ram_mapped = false;
+        uint8_t m_ram_map = 0;
+        const Scheduler* m_scheduler = nullptr;
+    protected:
+        BankedMapper(ROMDATA& rom, size_t ram_banks, bool battery,
+            uint16_t ram_mask = CART_RAM_HI - CART_RAM_LO, uint8_t ram_fill = 0x00);
+        // T-cycles since power on, for mappers which keep time
+        uint64_t m_now() const;
+        size_t m_rom_bank_count() const
+        {
+            return m_rom_banks;
+        }
+        // Banks past the end of the ROM or RAM wrap around
+        void m_map_rom(uint16_t lo_bank, uint16_t hi_bank);
+        void m_map_ram(uint8_t bank);
+        void m_unmap_ram();
+    public:
+        // Set by the cartridge, copies are given the clock of their machine
+        void clock(const Scheduler& scheduler)
+        {
+            m_scheduler = &scheduler;
+        }
+        // Only asked for cartridge RAM while none is mapped
+        uint8_t read(uint16_t addr) const;
+        // Bank mapped at 0x4000-0x7FFF
+        uint16_t rom_bank() const
+        {
+            return m_rom_map[1];
+        }
+        CartBanks banks();
+        // The mapping and cartridge RAM, mappers save their registers after
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+        // Battery backed RAM as a .sav file holds it, nothing without a battery
+        void save_battery(StateWriter& state, int64_t host_time) const;
+        void load_battery(StateReader& state, int64_t host_time);
+    };
+};
+
+#endif
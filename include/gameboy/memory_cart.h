@@ -0,0 +1,79 @@
+#ifndef __MEMORY_CART_H__
+#define __MEMORY_CART_H__
+
+#include <stdint.h>
+#include <variant>
+#include <vector>
+
+#include "gameboy/memory_map.h"
+#include "gameboy/memory_mbc1.h"
+#include "gameboy/memory_mbc2.h"
+#include "gameboy/memory_mbc3.h"
+#include "gameboy/memory_mbc5.h"
+#include "gameboy/memory_static.h"
+#include "gameboy/rom.h"
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+    class Scheduler;
+
+    /*
+     * The cartridge's mapper, picked from the header once at load
+     * Reads go straight to the banks the mapper has mapped, the mapper
+     * itself is only visited when its registers are written
+     */
+    class Cartridge
+    {
+    private:
+        typedef std::variant<MapperStatic, MapperMbc1, MapperMbc2, MapperMbc3, MapperMbc5> MAPPER;
+        MAPPER m_mapper;
+        CartBanks m_banks;
+        static MAPPER m_create_mapper(ROMDATA& rom);
+        void m_refresh();
+    public:
+        // Mappers keeping time read it from the scheduler
+        Cartridge(ROMDATA& rom, const Scheduler& scheduler);
+        // Copy sharing the ROM, with cartridge RAM copy on write
+        Cartridge(const Cartridge& other, const Scheduler& scheduler);
+        Cartridge(const Cartridge&) = delete;
+        Cartridge& operator=(const Cartridge&) = delete;
+        uint8_t read_rom(uint16_t addr) const
+        {
+            return m_banks.rom[addr / CART_ROM_BANK_SIZE][addr % CART_ROM_BANK_SIZE];
+        }
+        uint8_t read_ram(uint16_t addr)
+        {
+            if (m_banks.ram != nullptr)
+            {
+                return m_banks.ram->read((addr - CART_RAM_LO) & m_banks.ram_mask) | m_banks.ram_fill;
+            }
+            return std::visit([addr](auto& mapper) { return mapper.read(addr); }, m_mapper);
+        }
+        void write(uint16_t addr, uint8_t data)
+        {
+            if (m_banks.ram != nullptr && addr >= CART_RAM_LO)
+            {
+                m_banks.ram->write((addr - CART_RAM_LO) & m_banks.ram_mask, data);
+                return;
+            }
+            std::visit([addr, data](auto& mapper) { mapper.write(addr, data); }, m_mapper);
+            m_refresh();
+        }
+        // Bank mapped at 0x4000-0x7FFF
+        uint16_t rom_bank() const;
+        // Bank registers and cartridge RAM, the ROM is never saved
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+        /*
+         * Battery backed RAM & clock in the layout of .sav files, empty
+         * without a battery. Host time is in seconds since the Unix epoch
+         */
+        std::vector<uint8_t> save_battery(int64_t host_time) const;
+        // Throws std::invalid_argument, changing nothing, if it doesn't fit the cartridge
+        void load_battery(const std::vector<uint8_t>& in, int64_t host_time);
+    };
+};
+
+#endif
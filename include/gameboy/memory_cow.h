@@ -0,0 +1,93 @@
+#ifndef __MEMORY_COW_H__
+#define __MEMORY_COW_H__
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gameboy/state.h"
+
+namespace GAMEBOY
+{
+    const static size_t COW_PAGE_SIZE = 0x400;
+
+    /*
+     * Fixed size memory split into pages shared copy on write
+     * Copying the memory only copies the page table, a page is copied
+     * the first time it's written while another copy still shares it.
+     * Copies can be used from different threads, each copy from one
+     * thread at a time
+     */
+    template<size_t SIZE, size_t PAGE_SIZE = COW_PAGE_SIZE>
+    class CowMemory
+    {
+        static_assert(SIZE % PAGE_SIZE == 0, "CowMemory must be whole pages");
+    public:
+        typedef std::array<uint8_t, PAGE_SIZE> PAGE;
+        static constexpr size_t PAGE_COUNT = SIZE / PAGE_SIZE;
+    private:
+        std::array<std::shared_ptr<PAGE>, PAGE_COUNT> m_pages;
+        PAGE& m_unshare(size_t index)
+        {
+            std::shared_ptr<PAGE>& page = m_pages[index];
+            if (page.use_count() != 1)
+            {
+                page = std::make_shared<PAGE>(*page);
+            }
+            // pairs with the release when another copy let go of the page
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return *page;
+        }
+    public:
+        CowMemory()
+        {
+            for (std::shared_ptr<PAGE>& page : m_pages)
+            {
+                page = std::make_shared<PAGE>();
+            }
+        }
+        uint8_t read(size_t offset) const
+        {
+            return (*m_pages[offset / PAGE_SIZE])[offset % PAGE_SIZE];
+        }
+        void write(size_t offset, uint8_t data)
+        {
+            m_unshare(offset / PAGE_SIZE)[offset % PAGE_SIZE] = data;
+        }
+        const PAGE& page(size_t index) const
+        {
+            return *m_pages[index];
+        }
+        // Pages not shared with any other copy
+        size_t unique_pages() const
+        {
+            size_t count = 0;
+            for (const std::shared_ptr<PAGE>& page : m_pages)
+            {
+                count += page.use_count() == 1;
+            }
+            return count;
+        }
+        // Stored as one block, the same as a plain array of SIZE bytes
+        void save_state(StateWriter& state) const
+        {
+            for (const std::shared_ptr<PAGE>& page : m_pages)
+            {
+                state.write(*page);
+            }
+        }
+        // Copies still sharing the old pages keep their contents
+        void load_state(StateReader& state)
+        {
+            for (std::shared_ptr<PAGE>& page : m_pages)
+            {
+                page = std::make_shared<PAGE>();
+                state.read(*page);
+            }
+        }
+    };
+};
+
+#endif
@@ -5,16 +5,23 @@
 
 namespace GAMEBOY
 {
+    /*
+     * OAM DMA runs as a scheduled event each M-cycle while a transfer
+     * is in progress, started by CPU writes to the DMA register
+     */
     class DmaController
     {
     private:
         AddressDispatcher& memory;
         uint8_t step = 0;
         uint8_t m_dma_addr = 0;
+        void m_step(uint64_t time);
     public:
-        DmaController(AddressDispatcher& memory)
-        : memory(memory) {}
-        void tick();
+        DmaController(AddressDispatcher& memory);
+        DmaController(const DmaController&) = delete;
+        DmaController& operator=(const DmaController&) = delete;
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 };
 
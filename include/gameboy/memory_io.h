@@ -1,14 +1,33 @@
 #ifndef __MEMORY_IO_H__
 #define __MEMORY_IO_H__
 
+#include <array>
+#include <functional>
 #include <stdint.h>
+#include "gameboy/apu.h"
 #include "gameboy/memory_access.h"
 #include "gameboy/input.h"
+#include "gameboy/scheduler.h"
+#include "gameboy/timer.h"
 
 namespace GAMEBOY
 {
+    class StateWriter;
+    class StateReader;
+
+    // 2 bit shade for each of the 4 colour IDs
+    typedef std::array<uint8_t, 4> PALETTE_LUT;
+
     class IOHandler
     {
+    public:
+        typedef std::function<void(uint8_t)> SERIAL_OUT_CALLBACK;
+        enum class PALETTE
+        {
+            BGP,
+            OBP0,
+            OBP1
+        };
     private:
         uint8_t ioRam[0x80] = {0xFF};
         /*
@@ -18,6 +37,20 @@ namespace GAMEBOY
          */
         uint8_t IE = 0;
         InputHandler& m_input_handler;
+        Scheduler& m_scheduler;
+        Timer m_timer;
+        APU m_apu;
+        /*
+         * Decoded copies of BGP, OBP0 & OBP1, indexed by PALETTE
+         * Rebuilt whenever the register is written so the PPU
+         * doesn't decode the register for every pixel
+         */
+        std::array<PALETTE_LUT, 3> m_palette_luts = {};
+        void m_palette_update(PALETTE palette, uint8_t data);
+        // Serial transfer completes 8 bits at 8192Hz after it is started
+        static constexpr uint64_t m_SERIAL_TRANSFER_CYCLES = 8*512;
+        SERIAL_OUT_CALLBACK m_serial_out;
+        void m_serial_event();
     public:
         static const uint16_t INPUT_JOYP = 0xFF00;
         /*
@@ -156,9 +189,65 @@ namespace GAMEBOY
          */
         static const uint16_t PPU_REG_OBP0 = 0xFF48;
         static const uint16_t PPU_REG_OBP1 = 0xFF49;
-        IOHandler(InputHandler& input_handler);
+        /*
+         * 0xFF4A & 0xFF4B WY & WX
+         * Top left corner of the window, WX is offset by 7
+         */
+        static const uint16_t PPU_REG_WY = 0xFF4A;
+        static const uint16_t PPU_REG_WX = 0xFF4B;
+        IOHandler(InputHandler& input_handler, Scheduler& scheduler);
+        IOHandler(const IOHandler&) = delete;
+        IOHandler& operator=(const IOHandler&) = delete;
+        /*
+         * True for registers which the PPU reads while drawing a line
+         * Writes to these during mode 3 can change the remainder of the line
+         */
+        static bool is_render_register(uint16_t addr)
+        {
+            switch (addr)
+            {
+                case PPU_REG_LCDC:
+                case PPU_REG_SCY:
+                case PPU_REG_SCX:
+                case PPU_REG_BGP:
+                case PPU_REG_OBP0:
+                case PPU_REG_OBP1:
+                    return true;
+                default:
+                    return false;
+            }
+        }
         uint8_t read(uint16_t addr, MemoryAccessSource src);
         void write(uint16_t addr, uint8_t data, MemoryAccessSource src);
+        // Set bits of the interrupt flag register, same bit pattern as IF
+        void request_interrupt(uint8_t mask);
+        // Called with each byte sent, before it is published to the SerialEventSupervisor
+        void on_serial_out(SERIAL_OUT_CALLBACK callback);
+        APU& apu()
+        {
+            return m_apu;
+        }
+        Timer& timer()
+        {
+            return m_timer;
+        }
+        // Shade for each colour ID from a BGP, OBP0 or OBP1 value
+        static PALETTE_LUT decode_palette(uint8_t data)
+        {
+            PALETTE_LUT lut;
+            for (uint8_t color_id=0; color_id<4; color_id++)
+            {
+                lut[color_id] = (data >> (color_id*2)) & 0x03;
+            }
+            return lut;
+        }
+        const PALETTE_LUT& palette(PALETTE palette)
+        {
+            return m_palette_luts[static_cast<size_t>(palette)];
+        }
+        // Registers, the timer, the APU and the input handler's button state
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 }
 
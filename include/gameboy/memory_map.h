@@ -0,0 +1,49 @@
+#ifndef __MEMORY_MAP_H__
+#define __MEMORY_MAP_H__
+
+#include <array>
+#include <stdint.h>
+
+#include "gameboy/memory_cow.h"
+
+// https://gbdev.io/pandocs/Memory_Map.html
+
+namespace GAMEBOY
+{
+    const static uint16_t CART_ROM_LO = 0x0000;
+    const static uint16_t CART_ROM_HI = 0x7FFF;
+    const static uint16_t VRAM_LO = 0x8000;
+    const static uint16_t VRAM_HI = 0x9FFF;
+    const static uint16_t CART_RAM_LO = 0xA000;
+    const static uint16_t CART_RAM_HI = 0xBFFF;
+    const static uint16_t WRAM_LO = 0xC000;
+    const static uint16_t WRAM_HI = 0xDFFF;
+    const static uint16_t OAM_LO = 0xFE00;
+    const static uint16_t OAM_HI = 0xFE9F;
+    const static uint16_t IO_REG_LO = 0xFF00;
+    const static uint16_t INTERRUPT_FLAG = 0xFF0F;
+    const static uint16_t IO_REG_HI = 0xFF7F;
+    const static uint16_t HRAM_LO = 0xFF80;
+    const static uint16_t HRAM_HI = 0xFFFE;
+    const static uint16_t INTERRUPT_ENABLE = 0xFFFF;
+    const static uint16_t CART_ROM_BANK_SIZE = 0x4000;
+    typedef CowMemory<CART_RAM_HI - CART_RAM_LO + 1> CART_RAM_BANK;
+
+    /*
+     * The cartridge memory a mapper has mapped into the address space,
+     * which only changes when its registers are written
+     */
+    struct CartBanks
+    {
+        // 0x0000-0x3FFF & 0x4000-0x7FFF
+        std::array<const uint8_t*, 2> rom;
+        // nullptr while RAM is disabled, or something other than RAM is mapped
+        CART_RAM_BANK* ram;
+        // RAM smaller than the window repeats through it
+        uint16_t ram_mask;
+        // bits of each RAM byte that aren't there, and read as 1
+        uint8_t ram_fill;
+    };
+};
+
+#endif
@@ -1,42 +1,34 @@
 #ifndef __MEMORY_MBC1_H__
 #define __MEMORY_MBC1_H__
 
-#include <array>
 #include <stdint.h>
-#include <cstddef>
-#include <vector>
 
+#include "gameboy/memory_banked.h"
 #include "gameboy/rom.h"
-#include "gameboy/memory.h"
 
 namespace GAMEBOY
 {
     // https://gbdev.io/pandocs/MBC1.html
-    class MapperMbc1 : public CartMapper
+    class MapperMbc1 : public BankedMapper
     {
     private:
-        const static size_t BANK_LO = 0x4000;
-        const static size_t BANK_HI = CART_ROM_HI;
-        const static size_t REG_RAM_ENABLE_LO = 0x0000;
-        const static size_t REG_RAM_ENABLE_HI = 0x1FFF;
-        const static size_t REG_ROM_BANK_LO = 0x2000;
-        const static size_t REG_ROM_BANK_HI = 0x3FFF;
-        const static size_t REG_RAM_BANK_LO = 0x4000;
-        const static size_t REG_RAM_BANK_HI = 0x5FFF;
-        const static size_t REG_BANK_MODE_LO = 0x6000;
-        const static size_t REG_BANK_MODE_HI = 0x7FFF;
-        typedef std::array<uint8_t, 0x4000> RomBank;
-        typedef std::array<uint8_t, 0x2000> RamBank;
-        RomBank fixed_rom;
-        std::vector<RomBank> banked_rom;
-        uint8_t rom_bank_select = 0x00;
-        std::vector<RamBank> banked_ram;
-        uint8_t ram_bank_select = 0x00;
+        const static uint16_t REG_RAM_ENABLE_HI = 0x1FFF;
+        const static uint16_t REG_ROM_BANK_HI = 0x3FFF;
+        const static uint16_t REG_RAM_BANK_HI = 0x5FFF;
+        const static uint16_t REG_BANK_MODE_HI = 0x7FFF;
         bool ram_enabled = false;
+        // lower 5 bits of the ROM bank, never 0
+        uint8_t rom_bank_select = 0x01;
+        // upper 2 bits of the ROM bank, or the RAM bank
+        uint8_t ram_bank_select = 0x00;
+        // the upper bits also bank 0x0000-0x3FFF & RAM in mode 1
+        bool bank_mode = false;
+        void m_update();
     public:
         MapperMbc1(ROMDATA& rom, bool cartRam, bool cartBattery);
-        uint8_t read(uint16_t addr);
         void write(uint16_t addr, uint8_t data);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 };
 
@@ -0,0 +1,30 @@
+#ifndef __MEMORY_MBC2_H__
+#define __MEMORY_MBC2_H__
+
+#include <stdint.h>
+
+#include "gameboy/memory_banked.h"
+#include "gameboy/rom.h"
+
+namespace GAMEBOY
+{
+    /*
+     * https://gbdev.io/pandocs/MBC2.html
+     * 512 half bytes of RAM built in, repeating through 0xA000-0xBFFF
+     */
+    class MapperMbc2 : public BankedMapper
+    {
+    private:
+        const static uint16_t RAM_MASK = 0x01FF;
+        bool m_ram_enable = false;
+        uint8_t m_sel_rom_bank = 1;
+        void m_update();
+    public:
+        MapperMbc2(ROMDATA& rom, bool cartBattery);
+        void write(uint16_t addr, uint8_t data);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+    };
+};
+
+#endif
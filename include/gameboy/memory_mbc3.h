@@ -1,27 +1,35 @@
 #ifndef __MEMORY_MBC3_H__
 #define __MEMORY_MBC3_H__
 
-#include <array>
 #include <stdint.h>
-#include <cstddef>
-#include <vector>
 
-#include "gameboy/memory.h"
+#include "gameboy/memory_banked.h"
+#include "gameboy/memory_rtc.h"
+#include "gameboy/rom.h"
 
 namespace GAMEBOY
 {
-    class MapperMbc3 : public CartMapper
+    // https://gbdev.io/pandocs/MBC3.html
+    class MapperMbc3 : public BankedMapper
     {
     private:
-        std::vector<std::array<uint8_t, 0x2000>> m_rambanks;
-        std::vector<std::array<uint8_t, 0x4000>> m_rombanks;
         bool m_ram_enable = false;
         uint8_t m_sel_rom_bank = 1;
+        // RAM bank 0-3, or RTC register 0x08-0x0C
         uint8_t m_sel_ram_bank = 0;
+        bool m_timer;
+        RealTimeClock m_rtc;
+        void m_update();
     public:
         MapperMbc3(ROMDATA& rom, bool cartRam, bool cartBattery, bool cartTimer);
-        uint8_t read(uint16_t addr);
+        // The clock registers, which are never mapped
+        uint8_t read(uint16_t addr) const;
         void write(uint16_t addr, uint8_t data);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+        // The RAM followed by the clock, when the cartridge has one
+        void save_battery(StateWriter& state, int64_t host_time) const;
+        void load_battery(StateReader& state, int64_t host_time);
     };
 };
 
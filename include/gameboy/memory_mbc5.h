@@ -0,0 +1,31 @@
+#ifndef __MEMORY_MBC5_H__
+#define __MEMORY_MBC5_H__
+
+#include <stdint.h>
+
+#include "gameboy/memory_banked.h"
+#include "gameboy/rom.h"
+
+namespace GAMEBOY
+{
+    /*
+     * https://gbdev.io/pandocs/MBC5.html
+     * Up to 8MB of ROM & 128KB of RAM, bank 0 can be mapped at 0x4000
+     */
+    class MapperMbc5 : public BankedMapper
+    {
+    private:
+        bool m_ram_enable = false;
+        // 9 bits
+        uint16_t m_sel_rom_bank = 1;
+        uint8_t m_sel_ram_bank = 0;
+        void m_update();
+    public:
+        MapperMbc5(ROMDATA& rom, bool cartRam, bool cartBattery);
+        void write(uint16_t addr, uint8_t data);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+    };
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __MEMORY_RTC_H__
+#define __MEMORY_RTC_H__
+
+#include <array>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * https://gbdev.io/pandocs/MBC3.html#the-clock-counter-registers
+     * The MBC3 clock, worked out from the cycle counter when it's
+     * latched or written rather than ticked. It follows emulated time,
+     * so runs faster while fast-forwarding, and catches up on the host
+     * time that passed between saving & loading the battery
+     */
+    class RealTimeClock
+    {
+    public:
+        static constexpr uint64_t CYCLES_PER_SECOND = 4194304;
+        // Selected with 0x4000-0x5FFF, mapped at 0xA000-0xBFFF
+        enum REGISTER: uint8_t
+        {
+            SECONDS = 0x08,
+            MINUTES = 0x09,
+            HOURS = 0x0A,
+            DAY_LOW = 0x0B,
+            // bit 0 day bit 8, bit 6 halt, bit 7 day counter carry
+            DAY_HIGH = 0x0C
+        };
+        // Seconds, minutes, hours, day low & day high
+        typedef std::array<uint8_t, 5> REGISTERS;
+    private:
+        // time counted at m_base_cycle, in cycles to keep the part second
+        uint64_t m_base_time = 0;
+        uint64_t m_base_cycle = 0;
+        bool m_halted = false;
+        // the day counter overflowed, stays set until written
+        bool m_carry = false;
+        REGISTERS m_latched = {0};
+        uint8_t m_latch_write = 0xFF;
+        uint64_t m_time(uint64_t cycle) const;
+        void m_set(const REGISTERS& registers, uint64_t part_second, uint64_t cycle);
+    public:
+        // The clock as of the given cycle
+        REGISTERS registers(uint64_t cycle) const;
+        // Writing 0x00 then 0x01 latches the clock into the registers read
+        void latch(uint8_t data, uint64_t cycle);
+        uint8_t read(uint8_t reg) const;
+        void write(uint8_t reg, uint8_t data, uint64_t cycle);
+        // Time passed on the host while the machine wasn't running
+        void advance(uint64_t seconds);
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+        /*
+         * The 48 byte layout most emulators append to .sav files, the
+         * clock & latched registers as 32 bit values then a 64 bit
+         * host timestamp in seconds
+         */
+        void save_battery(StateWriter& state, uint64_t cycle, int64_t host_time) const;
+        void load_battery(StateReader& state, uint64_t cycle, int64_t host_time);
+    };
+};
+
+#endif
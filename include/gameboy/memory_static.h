@@ -1,23 +1,18 @@
 #ifndef __MEMORY_STATIC_H__
 #define __MEMORY_STATIC_H__
 
-#include <array>
 #include <stdint.h>
-#include <cstddef>
-#include <vector>
 
-#include "gameboy/memory.h"
+#include "gameboy/memory_banked.h"
+#include "gameboy/rom.h"
 
 namespace GAMEBOY
 {
-    class MapperStatic : public CartMapper
+    // 32KB of ROM with 8KB of RAM always mapped, and no registers
+    class MapperStatic : public BankedMapper
     {
-    private:
-        std::array<uint8_t, 0x8000> rom = {};
-        std::array<uint8_t, 0x2000> ram = {};
     public:
-        MapperStatic(ROMDATA& rom);
-        uint8_t read(uint16_t addr);
+        MapperStatic(ROMDATA& rom, bool cartBattery);
         void write(uint16_t addr, uint8_t data);
     };
 };
@@ -0,0 +1,92 @@
+#ifndef __MOVIE_H__
+#define __MOVIE_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/gameboy.h"
+#include "gameboy/input.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Button presses stamped with the machine cycle they were applied on,
+     * along with a hash of every frame shown while recording. Replaying
+     * applies each press on the same cycle, so the machine runs exactly
+     * as it did while recording and the frame hashes detect any desync.
+     */
+    struct Movie
+    {
+        struct Event
+        {
+            uint64_t cycle;
+            InputHandler::BUTTON button;
+            bool pressed;
+        };
+        static const uint16_t VERSION = 1;
+        uint16_t rom_checksum = 0;
+        // save state the movie starts from, empty for power on
+        std::vector<uint8_t> start_state;
+        // in cycle order
+        std::vector<Event> events;
+        std::vector<uint64_t> frame_hashes;
+        /*
+         * Compact binary form, events are stored as the varint cycles
+         * since the previous event followed by a byte for the button
+         */
+        void serialize(std::vector<uint8_t>& out) const;
+        // Throws std::invalid_argument or std::out_of_range for bad movies
+        static Movie deserialize(const std::vector<uint8_t>& in);
+        // FNV-1a of the frame's shades
+        static uint64_t frame_hash(const FRAME_PIXELS& frame);
+    };
+
+    // Records presses as they are applied to the machine's input handler
+    class MovieRecorder
+    {
+    private:
+        Gameboy& m_gameboy;
+        InputHandler& m_input_handler;
+        Movie m_movie;
+    public:
+        // Starts from power on, or a save state of the machine as it is now
+        MovieRecorder(Gameboy& gameboy, InputHandler& input_handler, bool from_current_state = false);
+        // Press or release a button, recording the current cycle
+        void button(InputHandler::BUTTON button, bool pressed);
+        // Called after each frame is run, adding its hash
+        void frame();
+        const Movie& movie() const;
+    };
+
+    class MoviePlayer
+    {
+    private:
+        Gameboy& m_gameboy;
+        InputHandler& m_input_handler;
+        Movie m_movie;
+        size_t m_next_event = 0;
+        size_t m_next_hash = 0;
+        uint64_t m_desyncs = 0;
+        void m_apply_due();
+    public:
+        /*
+         * Loads the movie's start state when it has one, the machine
+         * should otherwise be freshly powered on. Throws
+         * std::invalid_argument when the movie is for a different ROM
+         */
+        MoviePlayer(Gameboy& gameboy, InputHandler& input_handler, Movie movie);
+        /*
+         * Gameboy::run_frame, stopping part way through the frame to
+         * apply presses on the exact cycle they were recorded on
+         */
+        RunResult run_frame();
+        // Called after each frame is run, returns false if the frame
+        // differs from the one recorded
+        bool frame();
+        // True once every event has been applied & every hash checked
+        bool finished() const;
+        uint64_t desyncs() const;
+    };
+};
+
+#endif
@@ -1,11 +1,14 @@
 #ifndef __PPU_H__
 #define __PPU_H__
 
+#include <memory>
 #include <stdint.h>
 #include "gameboy/memory.h"
 #include "gameboy/ppu_def.h"
-#include "gameboy/ppu_tile.h"
-#include "gameboy/ppu_sprite.h"
+#include "gameboy/ppu_framebuffer.h"
+#include "gameboy/ppu_frameskip.h"
+#include "gameboy/ppu_render.h"
+#include "gameboy/ppu_render_state.h"
 
 namespace GAMEBOY
 {
@@ -13,9 +16,19 @@ namespace GAMEBOY
     {
     private:
         AddressDispatcher& memory;
-        PPU_Tilemap tilemap;
-        PPU_Spritemap spritemap;
-        std::shared_ptr<LINE_PIXELS> m_line_buffer;
+        PPU_Framebuffer m_framebuffer;
+        PPU_FrameSkip m_frameskip;
+        // false while the current frame is being skipped
+        bool m_draw_frame = true;
+        /*
+         * Lines are recorded during mode 3 and drawn on entering mode 0,
+         * either straight away or on the render thread when enabled
+         */
+        PPU_LineRenderer m_renderer;
+        PPU_LineRecord m_line;
+        bool m_line_pending = false;
+        // declared after everything it draws into, so it stops first
+        std::unique_ptr<PPU_RenderWorker> m_worker;
         // define mode lengths in terms of dots
         // note: extra ppu behaviour can delay mode 3
         // this is a later low priority TODO
@@ -25,6 +38,8 @@ namespace GAMEBOY
         const int m_LINE_LEN = 456;
         const int m_DRAW_LINES = 144;
         const int m_FRAME_LINES = 154;
+        // dots into mode 3 before the first pixel is shifted out
+        const int m_MODE3_FETCH_DELAY = 12;
         enum class m_PPU_STATE
         {
             MODE0,
@@ -33,23 +48,60 @@ namespace GAMEBOY
             MODE3
         };
         m_PPU_STATE m_state = m_PPU_STATE::MODE2;
+        // Machine cycle the current line began
+        uint64_t m_line_start = 0;
+        // Dot the line was on when the LCD was switched off
         int m_dot_x = 0;
         int m_dot_y = 0;
+        bool m_lcd_enabled = true;
+        // VBlanks entered, including skipped frames
+        uint64_t m_frame_count = 0;
         bool m_int_sel_lyc = false;
         bool m_int_sel_mode2 = false;
         bool m_int_sel_mode1 = false;
         bool m_int_sel_mode0 = false;
         // Stores the current status of all enabled STAT interrupt sources
         bool m_stat_line = false;
+        // Lines are drawn in one go from the start of mode 3, unless the CPU
+        // modifies rendering state during mode 3, in which case the rest of
+        // the line is redrawn dot by dot through the pixel FIFO
+        bool m_fifo_enabled = true;
+        void m_render_write(uint16_t addr, uint8_t data);
+        void m_line_finish();
         // Updates & then returns true on rising edge of STAT interrupt line
         void m_stat_line_update();
-        bool transition(m_PPU_STATE new_mode);
+        void transition(m_PPU_STATE new_mode);
+        // Scheduled mode changes, the PPU does no work between them
+        void m_mode_event(uint64_t time);
+        void m_lcd_toggle_event(uint64_t time);
     public:
-        PPU(AddressDispatcher& memory, std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer);
-        bool tick();
+        PPU(AddressDispatcher& memory);
+        PPU(const PPU&) = delete;
+        PPU& operator=(const PPU&) = delete;
+        // Incremented each time VBlank is entered, even if the frame was skipped
+        uint64_t frame_count();
+        PPU_Framebuffer& framebuffer();
+        PPU_FrameSkip& frameskip();
         uint8_t mode_no();
         uint8_t stat();
         void stat(uint8_t value);
+        bool fifo_enabled();
+        void fifo_enabled(bool enabled);
+        /*
+         * Draw lines on a separate thread, so emulation and pixel work
+         * run on different cores. The output is identical either way
+         */
+        bool render_thread();
+        void render_thread(bool enabled);
+        // Wait for the render thread to draw every line recorded so far
+        void render_sync();
+        /*
+         * Mode & line position, the line being recorded and the
+         * framebuffers. Frame skip, FIFO & render thread settings are
+         * left as they are
+         */
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 };
 
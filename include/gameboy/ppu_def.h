@@ -8,7 +8,23 @@
 
 namespace GAMEBOY
 {
-    typedef std::array<uint8_t, 160> LINE_PIXELS;
+    const static int SCREEN_WIDTH = 160;
+    const static int SCREEN_HEIGHT = 144;
+    // T-cycles from the start of one frame to the next, 154 lines of 456 dots
+    const static uint64_t FRAME_CYCLES = 70224;
+    typedef std::array<uint8_t, SCREEN_WIDTH> LINE_PIXELS;
+    // Rows of pixels, starting from the top left
+    typedef std::array<uint8_t, SCREEN_WIDTH*SCREEN_HEIGHT> FRAME_PIXELS;
+    // Host format RGBA8888 pixels, laid out the same as FRAME_PIXELS
+    typedef std::array<uint32_t, SCREEN_WIDTH*SCREEN_HEIGHT> FRAME_RGBA;
+    // RGBA8888 colour for each 2 bit shade
+    typedef std::array<uint32_t, 4> SHADE_RGBA_LUT;
+    const static SHADE_RGBA_LUT DEFAULT_SHADE_RGBA = {
+        0xFFFFFF88, // white
+        0xB8B8B888, // light gray
+        0x68686888, // dark gray
+        0x00000088  // black
+    };
 }
 
 #endif
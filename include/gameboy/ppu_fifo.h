@@ -0,0 +1,51 @@
+#ifndef __PPU_FIFO_H__
+#define __PPU_FIFO_H__
+
+#include <array>
+#include <stdint.h>
+#include "gameboy/ppu_def.h"
+#include "gameboy/ppu_render_state.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Dot accurate background pixel FIFO
+     * Only used for lines where the CPU modified VRAM or a PPU register
+     * while the line was being drawn, all other lines are drawn in one go
+     * by PPU_Tilemap. Registers are read at the time each tile is fetched
+     * and BGP at the time each pixel is shifted out, so mid-line changes
+     * affect the remainder of the line as they would on hardware.
+     */
+    class PPU_PixelFifo
+    {
+    private:
+        // colour IDs waiting to be shifted out
+        std::array<uint8_t, 16> m_queue;
+        uint8_t m_queue_head = 0;
+        uint8_t m_queue_size = 0;
+        uint8_t m_line = 0;
+        // fine scroll latched from SCX at the start of mode 3
+        uint8_t m_fine_x = 0;
+        // next screen pixel to be shifted out
+        uint8_t m_x = 0;
+        void fetch(const PPU_RenderState& state);
+    public:
+        static const uint8_t SCREEN_SIZE_X = 160;
+        void begin(uint8_t line, uint8_t fine_x, uint8_t start_x);
+        uint8_t x()
+        {
+            return m_x;
+        }
+        bool done()
+        {
+            return m_x >= SCREEN_SIZE_X;
+        }
+        /*
+         * Shift a single pixel out to the line buffer
+         * Fetches the next tile row from the state whenever the FIFO runs empty
+         */
+        void step(const PPU_RenderState& state, LINE_PIXELS& line_buffer);
+    };
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef __PPU_FRAMEBUFFER_H__
+#define __PPU_FRAMEBUFFER_H__
+
+#include <array>
+#include <functional>
+#include <vector>
+#include <stdint.h>
+#include "gameboy/ppu_def.h"
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * Double buffered 160x144 frame of 2 bit shades
+     * The PPU draws each line into the back buffer, on entering VBlank
+     * the buffers are swapped so consumers always see a complete frame
+     */
+    class PPU_Framebuffer
+    {
+    public:
+        typedef std::function<void(const FRAME_PIXELS&, uint64_t)> FRAME_READY_CALLBACK;
+    private:
+        std::array<FRAME_PIXELS, 2> m_buffers = {};
+        uint8_t m_back = 0;
+        // number of drawn frames, incremented on every swap
+        uint64_t m_sequence = 0;
+        FRAME_READY_CALLBACK m_frame_ready;
+        // host format copies of both buffers, only allocated when enabled
+        std::vector<FRAME_RGBA> m_rgba_buffers;
+        SHADE_RGBA_LUT m_shade_rgba = DEFAULT_SHADE_RGBA;
+    public:
+        void write_line(uint8_t line, const LINE_PIXELS& pixels);
+        void swap();
+        const FRAME_PIXELS& front() const;
+        const FRAME_PIXELS& back() const;
+        uint64_t sequence() const;
+        /*
+         * Called with the new front buffer and its sequence number
+         * every time a drawn frame completes
+         */
+        void on_frame_ready(FRAME_READY_CALLBACK callback);
+        /*
+         * Optionally also emit RGBA8888 pixels as each line is written,
+         * translated through the shade table
+         */
+        bool rgba_enabled() const;
+        void rgba_enabled(bool enabled);
+        const SHADE_RGBA_LUT& shade_rgba() const;
+        void shade_rgba(const SHADE_RGBA_LUT& lut);
+        const FRAME_RGBA& front_rgba() const;
+        /*
+         * Both buffers are saved, the back buffer holds the lines already
+         * drawn this frame. RGBA copies are rebuilt when loading
+         */
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+    };
+};
+
+#endif
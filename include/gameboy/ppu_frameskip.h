@@ -0,0 +1,56 @@
+#ifndef __PPU_FRAMESKIP_H__
+#define __PPU_FRAMESKIP_H__
+
+#include <chrono>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    /*
+     * Decides which frames the PPU draws
+     * Skipped frames keep all PPU timing, STAT, interrupts and memory
+     * locking identical, only the pixel work is not done
+     */
+    class PPU_FrameSkip
+    {
+    public:
+        enum class MODE
+        {
+            // draw every frame
+            OFF,
+            // draw 1 in every N frames
+            FIXED,
+            // only draw frames after request() is called
+            ON_REQUEST,
+            // skip frames while the host is behind real time
+            ADAPTIVE
+        };
+    private:
+        typedef std::chrono::steady_clock CLOCK;
+        // 70224 dots at 4194304Hz
+        const std::chrono::nanoseconds m_FRAME_TIME{16742706};
+        // frames skipped in a row before one is drawn regardless
+        const uint32_t m_ADAPTIVE_MAX_SKIP = 8;
+        // falling further behind than this resets the real time reference
+        const uint32_t m_ADAPTIVE_RESYNC_FRAMES = 30;
+        MODE m_mode = MODE::OFF;
+        uint32_t m_interval = 1;
+        uint32_t m_counter = 0;
+        bool m_requested = false;
+        uint32_t m_skipped = 0;
+        CLOCK::time_point m_adaptive_start;
+        uint64_t m_adaptive_frames = 0;
+        bool m_adaptive_behind();
+    public:
+        MODE mode();
+        void mode(MODE mode);
+        // Draw 1 in every interval frames while in FIXED mode
+        void interval(uint32_t interval);
+        // Draw the next frame while in ON_REQUEST mode
+        void request();
+        // Called as each frame begins, returns true if it should be drawn
+        bool next_frame();
+    };
+};
+
+#endif
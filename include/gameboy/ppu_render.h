@@ -0,0 +1,81 @@
+#ifndef __PPU_RENDER_H__
+#define __PPU_RENDER_H__
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "gameboy/ppu_def.h"
+#include "gameboy/ppu_fifo.h"
+#include "gameboy/ppu_framebuffer.h"
+#include "gameboy/ppu_render_state.h"
+#include "gameboy/ppu_sprite.h"
+#include "gameboy/ppu_tile.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Draws lines from the inputs the PPU recorded for them
+     * The tile & sprite caches live here, so every line of a machine has
+     * to be drawn by the same renderer in the order it was recorded,
+     * whichever thread that happens on, for the output to be the same
+     */
+    class PPU_LineRenderer
+    {
+    private:
+        PPU_Tilemap m_tilemap;
+        PPU_Spritemap m_spritemap;
+        PPU_PixelFifo m_fifo;
+        std::shared_ptr<LINE_PIXELS> m_line_buffer = std::make_shared<LINE_PIXELS>();
+        // VRAM with a line's writes replayed, reused from line to line
+        std::shared_ptr<VRAM_DATA> m_vram;
+        void m_write(PPU_RenderState& state, uint16_t addr, uint8_t data);
+    public:
+        PPU_LineRenderer(Stats& stats)
+        : m_tilemap(stats), m_spritemap(stats) {}
+        PPU_LineRenderer(const PPU_LineRenderer&) = delete;
+        PPU_LineRenderer& operator=(const PPU_LineRenderer&) = delete;
+        // Valid until the next line is drawn
+        const LINE_PIXELS& render(const PPU_LineRecord& record);
+    };
+
+    /*
+     * Draws lines on a thread of its own while the machine runs on
+     * Lines are written to the framebuffer's back buffer in the order
+     * they were submitted. Nothing else may touch the renderer or the
+     * framebuffer until wait() has returned
+     */
+    class PPU_RenderWorker
+    {
+    private:
+        PPU_LineRenderer& m_renderer;
+        PPU_Framebuffer& m_framebuffer;
+        std::mutex m_mutex;
+        // signalled when a line is submitted or the worker is stopping
+        std::condition_variable m_work;
+        // signalled when the queue has been drained
+        std::condition_variable m_idle;
+        std::deque<PPU_LineRecord> m_queue;
+        bool m_busy = false;
+        bool m_stop = false;
+        std::exception_ptr m_error;
+        std::thread m_thread;
+        void m_loop();
+    public:
+        PPU_RenderWorker(PPU_LineRenderer& renderer, PPU_Framebuffer& framebuffer);
+        // Draws any lines still queued before returning
+        ~PPU_RenderWorker();
+        PPU_RenderWorker(const PPU_RenderWorker&) = delete;
+        PPU_RenderWorker& operator=(const PPU_RenderWorker&) = delete;
+        void submit(PPU_LineRecord&& record);
+        /*
+         * Returns once every line submitted has been written to the
+         * framebuffer, rethrowing the first exception drawing one threw
+         */
+        void wait();
+    };
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __PPU_RENDER_STATE_H__
+#define __PPU_RENDER_STATE_H__
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "gameboy/memory.h"
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * Everything the PPU reads to draw a line, so lines can be drawn away
+     * from the running machine
+     * VRAM is shared copy on write with the dispatcher rather than copied,
+     * OAM is small enough to copy outright
+     */
+    struct PPU_RenderState
+    {
+        std::shared_ptr<const VRAM_DATA> vram;
+        OAM_DATA oam = {};
+        uint8_t lcdc = 0;
+        uint8_t scy = 0;
+        uint8_t scx = 0;
+        uint8_t wy = 0;
+        uint8_t wx = 0;
+        // indexed by IOHandler::PALETTE
+        std::array<PALETTE_LUT, 3> palettes = {};
+        // VRAM was written since the last line drawn, so cached tiles are stale
+        bool vram_modified = false;
+        // Take the current state, which also pops the dispatcher's VRAM modified flag
+        static PPU_RenderState capture(AddressDispatcher& memory);
+        uint8_t vram_read(uint16_t addr) const
+        {
+            return vram->read(addr - VRAM_LO);
+        }
+        uint8_t oam_read(uint16_t addr) const
+        {
+            return oam[addr - OAM_LO];
+        }
+        const PALETTE_LUT& palette(IOHandler::PALETTE palette) const
+        {
+            return palettes[static_cast<size_t>(palette)];
+        }
+    };
+
+    /*
+     * Inputs for drawing one line, recorded by the PPU during mode 3
+     * When the CPU changes VRAM or a render register part way through
+     * the line each write is listed, with the pixel it was made at, for
+     * the renderer to replay through the pixel FIFO. Sprites for those
+     * lines are drawn from OAM as it was at the end of mode 3
+     */
+    struct PPU_LineRecord
+    {
+        struct Write
+        {
+            // pixels shifted out before the write
+            uint8_t x;
+            uint16_t addr;
+            uint8_t data;
+        };
+        uint8_t line = 0;
+        // at the start of mode 3
+        PPU_RenderState start;
+        std::vector<Write> writes;
+        // at the end of mode 3, only used when there are writes
+        OAM_DATA end_oam = {};
+        bool end_vram_modified = false;
+        /*
+         * The VRAM snapshot is only saved if it differs from the live
+         * VRAM, which is shared again when loading
+         */
+        void save_state(StateWriter& state, const std::shared_ptr<const VRAM_DATA>& live_vram) const;
+        void load_state(StateReader& state, std::shared_ptr<const VRAM_DATA> live_vram);
+    };
+};
+
+#endif
@@ -2,8 +2,9 @@
 #define __PPU_SPRITE_H__
 
 #include <vector>
-#include "gameboy/memory.h"
 #include "gameboy/ppu_def.h"
+#include "gameboy/ppu_render_state.h"
+#include "gameboy/stats.h"
 
 namespace GAMEBOY
 {
@@ -22,27 +23,29 @@ namespace GAMEBOY
          */
         bool m_large_mode;
     public:
-        PPU_Sprite(AddressDispatcher& memory, uint8_t index, bool large_mode);
+        PPU_Sprite(const PPU_RenderState& state, uint8_t index, bool large_mode);
         uint8_t get_pixel(uint8_t x, uint8_t y);
     };
 
     class PPU_Spritecache
     {
     private:
-        AddressDispatcher& memory;
+        Stats& m_stats;
         typedef std::shared_ptr<PPU_Sprite> _PPU_SPRITE_PTR;
         std::array<std::optional<_PPU_SPRITE_PTR>, 256> cache;
+        // sprite size the cached sprites were decoded at
+        bool m_large_mode = false;
     public:
-        PPU_Spritecache(AddressDispatcher& memory)
-        : memory(memory) {}
+        PPU_Spritecache(Stats& stats)
+        : m_stats(stats) {}
         void clear();
-        std::shared_ptr<PPU_Sprite> get(uint8_t index, bool large_mode);
+        std::shared_ptr<PPU_Sprite> get(const PPU_RenderState& state, uint8_t index, bool large_mode);
     };
 
     class PPU_OamEntry
     {
     private:
-        AddressDispatcher& memory;
+        const PPU_RenderState& m_state;
         uint8_t m_x;
         uint8_t m_y;
         uint8_t m_tile_index;
@@ -50,19 +53,18 @@ namespace GAMEBOY
         uint8_t m_attrs;
         bool m_large_mode;
     public:
-        PPU_OamEntry(uint16_t oam_id, AddressDispatcher& memory);
+        PPU_OamEntry(const PPU_RenderState& state, uint16_t oam_id);
         void render_line(uint8_t line, LINE_PIXELS& bg, std::shared_ptr<LINE_PIXELS> line_buffer, PPU_Spritecache& spritecache);
     };
 
     class PPU_Spritemap
     {
     private:
-        AddressDispatcher& memory;
         PPU_Spritecache spritecache;
     public:
-        PPU_Spritemap(AddressDispatcher& memory)
-        : memory(memory), spritecache(memory) {}
-        void render_line(uint8_t line, std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer);
+        PPU_Spritemap(Stats& stats)
+        : spritecache(stats) {}
+        void render_line(const PPU_RenderState& state, uint8_t line, std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer);
     };
 };
 
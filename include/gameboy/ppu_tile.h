@@ -1,8 +1,9 @@
 #ifndef __PPU_TILE_H__
 #define __PPU_TILE_H__
 
-#include "gameboy/memory.h"
 #include "gameboy/ppu_def.h"
+#include "gameboy/ppu_render_state.h"
+#include "gameboy/stats.h"
 
 namespace GAMEBOY
 {
@@ -16,42 +17,36 @@ namespace GAMEBOY
          */
         std::array<uint8_t, 8*8> m_tile_data;
     public:
-        PPU_Tile(AddressDispatcher& memory, uint8_t index);
+        PPU_Tile(const PPU_RenderState& state, uint8_t index);
         uint8_t get_pixel(uint8_t x, uint8_t y);
     };
 
     class PPU_Tilecache
     {
     private:
-        AddressDispatcher& memory;
+        Stats& m_stats;
         typedef std::shared_ptr<PPU_Tile> _PPU_TILE_PTR;
         std::array<std::optional<_PPU_TILE_PTR>, 256> cache;
     public:
-        PPU_Tilecache(AddressDispatcher& memory)
-        : memory(memory) {}
+        PPU_Tilecache(Stats& stats)
+        : m_stats(stats) {}
         void clear();
-        std::shared_ptr<PPU_Tile> get(uint8_t index);
+        std::shared_ptr<PPU_Tile> get(const PPU_RenderState& state, uint8_t index);
     };
 
     class PPU_Tilemap
     {
     private:
-        AddressDispatcher& memory;
         PPU_Tilecache tilecache;
     public:
-        enum class MAP_SELECT
-        {
-            // Use tilemap at 0x9800
-            MAP0,
-            // Use tilemap at 0x9C00
-            MAP1
-        };
-        PPU_Tilemap(AddressDispatcher& memory)
-        : memory(memory), tilecache(memory) {}
+        PPU_Tilemap(Stats& stats)
+        : tilecache(stats) {}
         /*
          * Visible area is 160x144 pixels out of 256x256 tile map
+         * The map & scroll position are taken from the state's LCDC,
+         * SCX & SCY
          */
-        std::shared_ptr<LINE_PIXELS> render_line(MAP_SELECT map, uint8_t scroll_x, uint8_t scroll_y, uint8_t line);
+        std::shared_ptr<LINE_PIXELS> render_line(const PPU_RenderState& state, uint8_t line);
     };
 };
 
@@ -0,0 +1,83 @@
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/gameboy.h"
+
+namespace GAMEBOY
+{
+    /*
+     * Fixed size history of save states for stepping back in time
+     * Only the newest snapshot is kept whole, every older snapshot is
+     * stored as the XOR of it with the snapshot after it, run length
+     * encoded. Frame to frame most of the machine is unchanged, so the
+     * deltas are mostly runs of zeros. Once the ring is full the oldest
+     * snapshots are dropped.
+     */
+    class Rewind
+    {
+    public:
+        struct Stats
+        {
+            // snapshots taken & stepped back through
+            uint64_t captures = 0;
+            uint64_t rewinds = 0;
+            // snapshots currently available to step back to
+            size_t history = 0;
+            // bytes of the ring holding deltas
+            size_t used_bytes = 0;
+            // size of a whole snapshot
+            size_t state_bytes = 0;
+            // time spent saving & encoding snapshots
+            uint64_t capture_ns = 0;
+        };
+    private:
+        struct Entry
+        {
+            size_t offset;
+            size_t size;
+        };
+        std::vector<uint8_t> m_ring;
+        // deltas in the ring, oldest first
+        std::deque<Entry> m_entries;
+        // where the next delta is written
+        size_t m_write = 0;
+        uint32_t m_interval;
+        uint32_t m_frames = 0;
+        // newest snapshot, the base all deltas are applied to
+        std::vector<uint8_t> m_latest;
+        std::vector<uint8_t> m_snapshot;
+        std::vector<uint8_t> m_delta;
+        Stats m_stats;
+        void m_push(const std::vector<uint8_t>& delta);
+        bool m_overlaps(const Entry& entry, size_t offset, size_t size) const;
+    public:
+        // Deltas share a ring of capacity bytes, snapshots are taken
+        // every interval calls to capture()
+        Rewind(size_t capacity, uint32_t interval = 1);
+        // Called once per frame, taking a snapshot every interval frames
+        void capture(Gameboy& gameboy);
+        /*
+         * Load the snapshot before the newest one, which then becomes the
+         * newest. Returns false once there is no older history left
+         */
+        bool step_back(Gameboy& gameboy);
+        // Drop all history, such as after loading an unrelated save state
+        void clear();
+        const Stats& stats() const;
+        /*
+         * XOR delta of two equally sized buffers, run length encoded as
+         * pairs of varint lengths: equal bytes to skip, then that many
+         * XORed bytes follow. Applying a delta to either buffer gives
+         * the other
+         */
+        static void encode_delta(const std::vector<uint8_t>& from, const std::vector<uint8_t>& to,
+            std::vector<uint8_t>& delta);
+        static void apply_delta(const uint8_t* delta, size_t delta_size, std::vector<uint8_t>& state);
+    };
+};
+
+#endif
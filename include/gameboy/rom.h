@@ -3,9 +3,10 @@
 
 #include <optional>
 #include <vector>
-#include <SDL2/SDL.h>
 #include <stdint.h>
 
+#include "gameboy/file.h"
+
 namespace GAMEBOY
 {
     // https://gbdev.io/pandocs/The_Cartridge_Header.html
@@ -17,7 +18,8 @@ namespace GAMEBOY
 };
 
 typedef std::vector<uint8_t> ROMDATA;
-std::optional<ROMDATA> open_rom(char* rom_path);
+std::optional<ROMDATA> open_rom(const char* rom_path,
+        GAMEBOY::FileInterface& files = GAMEBOY::FileInterface::standard());
 int num_rom_banks(ROMDATA& data);
 int num_ram_banks(ROMDATA& data);
 
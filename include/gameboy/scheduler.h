@@ -0,0 +1,121 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <array>
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * Events which components schedule on the machine clock
+     * Listed in priority order, events due on the same cycle are
+     * dispatched in this order
+     */
+    enum class EventType: uint8_t
+    {
+        TIMER,
+        PPU_LCD_TOGGLE,
+        PPU_MODE,
+        DMA_STEP,
+        SERIAL_TRANSFER,
+        APU_FRAME_SEQUENCER,
+        COUNT
+    };
+
+    // Bit for the event type in masks of event types
+    inline constexpr uint32_t event_bit(EventType type)
+    {
+        return 1u << static_cast<uint32_t>(type);
+    }
+
+    /*
+     * Machine wide clock and event queue
+     * The clock counts T-cycles (PPU dots) since power on, with 4 T-cycles
+     * per M-cycle. Rather than every component polling each M-cycle,
+     * components schedule an event for the next cycle their state changes
+     * and are only run then. At most one event of each type is pending,
+     * scheduling a type again replaces the previous event.
+     */
+    class Scheduler
+    {
+    public:
+        static constexpr uint64_t NEVER = UINT64_MAX;
+        // Called with the cycle the event was due
+        typedef std::function<void(uint64_t)> HANDLER;
+    private:
+        static constexpr size_t m_EVENT_COUNT = static_cast<size_t>(EventType::COUNT);
+        struct Event
+        {
+            uint64_t time;
+            EventType type;
+            // events replaced or cancelled since are left in the heap
+            // and skipped once they reach the top
+            uint32_t generation;
+        };
+        uint64_t m_now = 0;
+        uint64_t m_next_due = NEVER;
+        // event_bit of every type dispatched since last popped
+        uint32_t m_dispatched = 0;
+        // min-heap ordered by time then priority
+        std::vector<Event> m_heap;
+        std::array<uint32_t, m_EVENT_COUNT> m_generation = {};
+        std::array<uint64_t, m_EVENT_COUNT> m_due;
+        std::array<HANDLER, m_EVENT_COUNT> m_handlers;
+        static bool m_later(const Event& a, const Event& b);
+        bool m_stale(const Event& event) const;
+        void m_discard_stale();
+    public:
+        Scheduler();
+        uint64_t now() const
+        {
+            return m_now;
+        }
+        // Cycle of the earliest pending event, or NEVER
+        uint64_t next_due() const
+        {
+            return m_next_due;
+        }
+        void handler(EventType type, HANDLER handler);
+        void schedule(EventType type, uint64_t time);
+        void schedule_in(EventType type, uint64_t cycles)
+        {
+            schedule(type, m_now + cycles);
+        }
+        void cancel(EventType type);
+        bool pending(EventType type) const;
+        uint64_t due(EventType type) const;
+        /*
+         * Move the clock forward, running any events which become due
+         * Returns true if any events were run
+         */
+        bool advance(uint64_t cycles)
+        {
+            m_now += cycles;
+            if (m_now >= m_next_due)
+            {
+                dispatch();
+                return true;
+            }
+            return false;
+        }
+        // Mask of event types dispatched since the last call
+        uint32_t pop_dispatched()
+        {
+            uint32_t dispatched = m_dispatched;
+            m_dispatched = 0;
+            return dispatched;
+        }
+        // Run every event due at or before the current cycle
+        void dispatch();
+        // The clock and pending events, handlers are left as they are
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
+    };
+};
+
+#endif
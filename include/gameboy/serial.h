@@ -1,6 +1,7 @@
 #ifndef __SERIAL_H__
 #define __SERIAL_H__
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -18,20 +19,25 @@ namespace GAMEBOY
         virtual void receive(uint8_t data) = 0;
     };
 
+    /*
+     * Process wide serial output, shared by every Gameboy instance
+     * Safe to publish to from several threads, but output from instances
+     * running at the same time is interleaved, so those should use the
+     * per instance Gameboy::on_serial_out instead
+     */
     class SerialEventSupervisor
     {
     private:
-        static SerialEventSupervisor* instance;
+        std::mutex m_mutex;
         std::vector<SerialEventSubscriber*> subscribers;
         SerialEventSupervisor() = default;
         ~SerialEventSupervisor() = default;
     public:
         static SerialEventSupervisor& getInstance()
         {
-            if (!instance) {
-                instance = new SerialEventSupervisor();
-            }
-            return *instance;
+            // initialised once, even when first used from several threads
+            static SerialEventSupervisor instance;
+            return instance;
         }
         void subscribe(SerialEventType event, SerialEventSubscriber* subscriber);
         void publish(SerialEventType event, uint8_t data);
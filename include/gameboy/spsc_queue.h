@@ -0,0 +1,110 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+namespace GAMEBOY
+{
+    /*
+     * Lock-free bounded queue for exactly one producer thread
+     * and one consumer thread
+     * One slot is kept empty to tell a full queue from an empty one,
+     * so at most CAPACITY-1 entries are queued at once
+     */
+    template <typename T, size_t CAPACITY>
+    class SpscQueue
+    {
+    private:
+        static_assert(CAPACITY >= 2, "SpscQueue needs at least 2 slots");
+        std::array<T, CAPACITY> m_slots;
+        // next slot to read, only written by the consumer
+        alignas(64) std::atomic<size_t> m_head{0};
+        // next slot to write, only written by the producer
+        alignas(64) std::atomic<size_t> m_tail{0};
+    public:
+        // Producer only, returns false without copying when full
+        bool push(const T& value)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t next = (tail + 1) % CAPACITY;
+            if (next == m_head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            m_slots[tail] = value;
+            m_tail.store(next, std::memory_order_release);
+            return true;
+        }
+        // Consumer only, returns false when empty
+        bool pop(T& value)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            value = m_slots[head];
+            m_head.store((head + 1) % CAPACITY, std::memory_order_release);
+            return true;
+        }
+        bool empty() const
+        {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+    };
+
+    /*
+     * Lock-free ring for one producer and one consumer thread moving
+     * runs of values at a time, such as audio samples
+     * The read & write counts only ever increase, so every slot is used
+     */
+    template <typename T, size_t CAPACITY>
+    class SpscRing
+    {
+    private:
+        static_assert(CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+            "SpscRing capacity must be a power of 2");
+        std::array<T, CAPACITY> m_slots;
+        // total values read, only written by the consumer
+        alignas(64) std::atomic<size_t> m_read{0};
+        // total values written, only written by the producer
+        alignas(64) std::atomic<size_t> m_write{0};
+    public:
+        // Producer only, copies as many values as fit and returns how many
+        size_t write(const T* values, size_t count)
+        {
+            size_t write = m_write.load(std::memory_order_relaxed);
+            size_t free = CAPACITY - (write - m_read.load(std::memory_order_acquire));
+            count = std::min(count, free);
+            for (size_t i=0; i<count; i++)
+            {
+                m_slots[(write + i) & (CAPACITY - 1)] = values[i];
+            }
+            m_write.store(write + count, std::memory_order_release);
+            return count;
+        }
+        // Consumer only, returns the number of values read
+        size_t read(T* values, size_t count)
+        {
+            size_t read = m_read.load(std::memory_order_relaxed);
+            size_t available = m_write.load(std::memory_order_acquire) - read;
+            count = std::min(count, available);
+            for (size_t i=0; i<count; i++)
+            {
+                values[i] = m_slots[(read + i) & (CAPACITY - 1)];
+            }
+            m_read.store(read + count, std::memory_order_release);
+            return count;
+        }
+        // Values queued, exact from either thread's own side
+        size_t size() const
+        {
+            return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+        }
+    };
+};
+
+#endif
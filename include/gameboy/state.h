@@ -0,0 +1,128 @@
+#ifndef __STATE_H__
+#define __STATE_H__
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace GAMEBOY
+{
+    /*
+     * Appends component state to a save state blob
+     * Integers are stored little endian so blobs can be moved between
+     * hosts, arrays of bytes are copied in one go
+     */
+    class StateWriter
+    {
+    private:
+        std::vector<uint8_t>& m_out;
+    public:
+        StateWriter(std::vector<uint8_t>& out)
+        : m_out(out) {}
+        void write_bytes(const uint8_t* data, size_t size)
+        {
+            size_t offset = m_out.size();
+            m_out.resize(offset + size);
+            std::memcpy(m_out.data() + offset, data, size);
+        }
+        template<typename T>
+        void write(T value)
+        {
+            static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                "Only integers and enums are written directly");
+            uint8_t bytes[sizeof(T)];
+            uint64_t raw = static_cast<uint64_t>(value);
+            for (size_t i=0; i<sizeof(T); i++)
+            {
+                bytes[i] = static_cast<uint8_t>(raw >> (i*8));
+            }
+            write_bytes(bytes, sizeof(T));
+        }
+        template<size_t N>
+        void write(const std::array<uint8_t, N>& data)
+        {
+            write_bytes(data.data(), N);
+        }
+        // 7 bits at a time, for values which are usually small
+        void write_varint(uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_out.push_back(static_cast<uint8_t>(value) | 0x80);
+                value >>= 7;
+            }
+            m_out.push_back(static_cast<uint8_t>(value));
+        }
+        size_t size() const
+        {
+            return m_out.size();
+        }
+    };
+
+    // Reads back state in the order it was written by StateWriter
+    class StateReader
+    {
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+    public:
+        StateReader(const std::vector<uint8_t>& in)
+        : m_data(in.data()), m_size(in.size()) {}
+        void read_bytes(uint8_t* data, size_t size)
+        {
+            if (size > m_size - m_offset)
+            {
+                throw std::out_of_range("Save state truncated");
+            }
+            std::memcpy(data, m_data + m_offset, size);
+            m_offset += size;
+        }
+        template<typename T>
+        T read()
+        {
+            static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                "Only integers and enums are read directly");
+            uint8_t bytes[sizeof(T)];
+            read_bytes(bytes, sizeof(T));
+            uint64_t raw = 0;
+            for (size_t i=0; i<sizeof(T); i++)
+            {
+                raw |= static_cast<uint64_t>(bytes[i]) << (i*8);
+            }
+            return static_cast<T>(raw);
+        }
+        template<size_t N>
+        void read(std::array<uint8_t, N>& data)
+        {
+            read_bytes(data.data(), N);
+        }
+        uint64_t read_varint()
+        {
+            uint64_t value = 0;
+            for (int shift=0; shift<64; shift+=7)
+            {
+                uint8_t byte = read<uint8_t>();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                {
+                    return value;
+                }
+            }
+            throw std::out_of_range("Save state varint too long");
+        }
+        size_t remaining() const
+        {
+            return m_size - m_offset;
+        }
+        bool done() const
+        {
+            return m_offset == m_size;
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <array>
+#include <string>
+#include <stdint.h>
+
+#include "gameboy/memory_access.h"
+
+/*
+ * Counters are compiled in unless built with GBEMU_STATS=0, in which case
+ * every GBEMU_STAT statement is removed and the counters stay at zero
+ */
+#ifndef GBEMU_STATS
+#define GBEMU_STATS 1
+#endif
+
+#if GBEMU_STATS
+#define GBEMU_STAT(statement) statement
+#else
+#define GBEMU_STAT(statement) ((void)0)
+#endif
+
+namespace GAMEBOY
+{
+    /*
+     * Performance counters for a single machine, updated by each component
+     * as it runs. Counters are plain integers owned by the machine, so
+     * instances on different threads never share them
+     */
+    struct Stats
+    {
+        static const bool ENABLED = GBEMU_STATS;
+        enum class REGION: uint8_t
+        {
+            CART_ROM,
+            VRAM,
+            CART_RAM,
+            WRAM,
+            OAM,
+            IO,
+            HRAM,
+            // echo RAM and the unusable area after OAM
+            UNMAPPED
+        };
+        static const size_t REGION_COUNT = 8;
+        static const size_t SOURCE_COUNT = 3;
+        // filled in from the clock when the snapshot is taken
+        uint64_t mcycles = 0;
+        uint64_t instructions = 0;
+        uint64_t interrupts = 0;
+        // M-cycles the CPU spent HALTed or STOPped, including skipped ones
+        uint64_t halt_mcycles = 0;
+        uint64_t stop_mcycles = 0;
+        std::array<uint64_t, 0x100> opcodes = {0};
+        std::array<uint64_t, 0x100> cb_opcodes = {0};
+        std::array<uint64_t, REGION_COUNT> reads = {0};
+        std::array<uint64_t, REGION_COUNT> writes = {0};
+        // reads & writes by each MemoryAccessSource
+        std::array<uint64_t, SOURCE_COUNT> accesses = {0};
+        uint64_t tile_cache_hits = 0;
+        uint64_t tile_cache_misses = 0;
+        uint64_t tile_cache_invalidations = 0;
+        uint64_t sprite_cache_hits = 0;
+        uint64_t sprite_cache_misses = 0;
+        uint64_t sprite_cache_invalidations = 0;
+        uint64_t lines_rendered = 0;
+        // lines switched over to the pixel FIFO by a mid-line write
+        uint64_t fifo_lines = 0;
+        uint64_t dma_transfers = 0;
+        void count_read(REGION region, MemoryAccessSource source)
+        {
+            reads[static_cast<size_t>(region)]++;
+            accesses[static_cast<size_t>(source)]++;
+        }
+        void count_write(REGION region, MemoryAccessSource source)
+        {
+            writes[static_cast<size_t>(region)]++;
+            accesses[static_cast<size_t>(source)]++;
+        }
+        static const char* region_name(REGION region);
+        static const char* source_name(MemoryAccessSource source);
+        // Multi-line human readable dump, listing the top opcodes
+        std::string summary(size_t top_opcodes = 8) const;
+    };
+};
+
+#endif
@@ -3,32 +3,63 @@
 
 #include <stdint.h>
 
-#include "gameboy/memory.h"
+#include "gameboy/scheduler.h"
 
 namespace GAMEBOY
 {
+    class IOHandler;
+    class StateWriter;
+    class StateReader;
+
+    /*
+     * DIV and TIMA are derived from the machine clock when read, from the
+     * cycle the system counter was last reset and the last TIMA write.
+     * The cycle TIMA overflows is worked out ahead of time, so the only
+     * scheduled event is the TMA reload & timer interrupt.
+     */
     class Timer
     {
     private:
-        static Timer* instance;
-        // Increments every 64 M-cycles
-        uint8_t registerDIV = 0;
-        uint8_t registerDIVSubTick = 0;
+        Scheduler& m_scheduler;
+        IOHandler& m_io;
+        // Machine cycle the system counter was last reset
+        uint64_t m_counter_base = 0;
+        // TIMA held registerTIMA at m_tima_time, counting up from there
+        uint64_t m_tima_time = 0;
         uint8_t registerTIMA = 0;
         uint8_t registerTMA = 0;
         uint8_t registerTAC = 0;
-        bool timerBitPrevious = false;
-        bool timaOverflow = false;
-        Timer() = default;
-        ~Timer() = default;
+        /*
+         * Predicted cycle TMA is copied into TIMA, the M-cycle after it
+         * overflows, during which TIMA reads 0. During the M-cycle TMA
+         * is copied TIMA writes are ignored and TMA writes also go to TIMA
+         */
+        uint64_t m_reload_time = Scheduler::NEVER;
+        uint64_t m_reloaded_time = Scheduler::NEVER;
+        // The system counter is held at 0 while the CPU is stopped
+        bool m_stopped = false;
+        bool m_enabled();
+        // T-cycles between falling edges of the bit selected by TAC
+        uint64_t m_period();
+        // State of the system counter bit selected by TAC, ANDed with enable
+        // and never set while stopped
+        bool m_timer_bit(uint64_t time);
+        // Falling edges of the selected bit in the range (from, to]
+        uint64_t m_edges(uint64_t from, uint64_t to);
+        bool m_overflowed(uint64_t time);
+        uint8_t m_tima(uint64_t time);
+        void m_tima_latch(uint64_t time);
+        // Extra increment caused by forcing the selected bit low
+        void m_falling_edge(uint64_t time);
+        // Writing DIV, or STOP
+        void m_reset_counter(uint64_t time);
+        // Predict the next overflow from the latched TIMA
+        void m_schedule_reload(uint64_t time);
+        void m_reload(uint64_t time);
     public:
-        static Timer& getInstance()
-        {
-            if (!instance) {
-                instance = new Timer();
-            }
-            return *instance;
-        }
+        Timer(Scheduler& scheduler, IOHandler& io);
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
         enum class Register
         {
             DIV,
@@ -38,7 +69,12 @@ namespace GAMEBOY
         };
         void write(Register target, uint8_t data);
         uint8_t read(Register target);
-        void tick(AddressDispatcher& memory);
+        // STOP resets the system counter and holds it until the CPU resumes
+        void stop();
+        void resume();
+        // The reload event itself is saved with the scheduler
+        void save_state(StateWriter& state) const;
+        void load_state(StateReader& state);
     };
 };
 
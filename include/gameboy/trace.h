@@ -0,0 +1,194 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "gameboy/spsc_queue.h"
+
+namespace GAMEBOY
+{
+    enum class TraceKind: uint8_t
+    {
+        // an instruction about to execute, with the registers before it
+        INSTRUCTION,
+        // an interrupt being serviced, addr is the vector
+        INTERRUPT,
+        // memory accessed by the instruction before, addr & data are set
+        READ,
+        WRITE,
+        // VBlank began, the start of the next frame in the index
+        FRAME
+    };
+
+    /*
+     * Fixed size record, a trace file is a TraceHeader followed by an
+     * array of these so it can be mapped and indexed directly
+     */
+    struct TraceRecord
+    {
+        // T-cycle the instruction started or the access was made
+        uint64_t cycle;
+        // accesses carry their instruction's PC & bank
+        uint16_t pc;
+        // ROM bank mapped at 0x4000-0x7FFF
+        uint16_t bank;
+        uint16_t af;
+        uint16_t bc;
+        uint16_t de;
+        uint16_t hl;
+        uint16_t sp;
+        TraceKind kind;
+        uint8_t opcode;
+        // the bytes after the opcode, whether the instruction uses them or not
+        std::array<uint8_t, 2> operands;
+        uint16_t addr;
+        uint8_t data;
+        uint8_t ime;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(TraceRecord) == 32, "TraceRecord is part of the trace file format");
+
+    /*
+     * Written in host byte order so records can be used in place once
+     * mapped, byte_order lets readers on other hosts tell
+     * The frame index is an array of uint64_t record indices, one for
+     * each FRAME record, written after the records when the trace closes
+     */
+    struct TraceHeader
+    {
+        std::array<char, 8> magic;
+        uint16_t version;
+        uint16_t record_size;
+        uint16_t byte_order;
+        uint16_t flags;
+        uint64_t record_count;
+        uint64_t frame_count;
+        uint64_t frame_index_offset;
+        std::array<uint64_t, 3> reserved;
+    };
+    static_assert(sizeof(TraceHeader) == 64, "TraceHeader is part of the trace file format");
+
+    const std::array<char, 8> TRACE_MAGIC = {'G', 'B', 'T', 'R', 'A', 'C', 'E', '\0'};
+    const uint16_t TRACE_VERSION = 1;
+    const uint16_t TRACE_BYTE_ORDER = 0x0102;
+    // Header flag, READ & WRITE records were captured
+    const uint16_t TRACE_FLAG_MEMORY = 0x0001;
+
+    /*
+     * Streams records to a trace file without slowing emulation much
+     * The emulation thread fills a batch, handing it to a ring which a
+     * writer thread drains to the file, so the emulation thread only
+     * waits if the disk falls a whole ring behind. A recorder takes
+     * records from one machine, attached with Gameboy::tracer()
+     */
+    class TraceRecorder
+    {
+    public:
+        static const size_t BATCH_RECORDS = 256;
+        static const size_t RING_RECORDS = 1 << 15;
+    private:
+        FILE* m_file;
+        bool m_memory_accesses;
+        std::array<TraceRecord, BATCH_RECORDS> m_batch;
+        size_t m_batch_size = 0;
+        std::unique_ptr<SpscRing<TraceRecord, RING_RECORDS>> m_ring;
+        // the instruction accesses are attributed to
+        uint16_t m_pc = 0;
+        uint16_t m_bank = 0;
+        uint64_t m_stalls = 0;
+        std::atomic<bool> m_stop{false};
+        // only used by the writer thread until it has been joined
+        uint64_t m_written = 0;
+        std::vector<uint64_t> m_frame_index;
+        bool m_write_failed = false;
+        std::thread m_writer;
+        void m_flush();
+        void m_write_loop();
+        void m_write_header();
+    public:
+        // Throws std::runtime_error if the file can't be created
+        TraceRecorder(const std::string& path, bool memory_accesses = false);
+        // Closes the trace if close() wasn't called
+        ~TraceRecorder();
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+        // Record READ & WRITE accesses made by instructions
+        bool memory_accesses() const
+        {
+            return m_memory_accesses;
+        }
+        void push(const TraceRecord& record)
+        {
+            m_batch[m_batch_size++] = record;
+            if (m_batch_size == BATCH_RECORDS)
+            {
+                m_flush();
+            }
+        }
+        void instruction(const TraceRecord& record)
+        {
+            m_pc = record.pc;
+            m_bank = record.bank;
+            push(record);
+        }
+        void access(TraceKind kind, uint64_t cycle, uint16_t addr, uint8_t data);
+        void frame(uint64_t cycle);
+        // Times the emulation thread waited for the writer
+        uint64_t stalls() const
+        {
+            return m_stalls;
+        }
+        /*
+         * Writes everything recorded, then the frame index & header
+         * Returns false if any of the trace failed to write
+         */
+        bool close();
+    };
+
+    /*
+     * Reads a whole trace, mapped or loaded into memory, which must
+     * outlive the reader. Traces cut short before they were closed
+     * still read, without a frame index
+     */
+    class TraceReader
+    {
+    private:
+        const uint8_t* m_data;
+        TraceHeader m_header;
+        uint64_t m_record_count;
+    public:
+        // Throws std::invalid_argument if the data isn't a trace from this host
+        TraceReader(const uint8_t* data, size_t size);
+        const TraceHeader& header() const
+        {
+            return m_header;
+        }
+        bool memory_accesses() const
+        {
+            return m_header.flags & TRACE_FLAG_MEMORY;
+        }
+        uint64_t size() const
+        {
+            return m_record_count;
+        }
+        const TraceRecord& operator[](uint64_t index) const
+        {
+            return reinterpret_cast<const TraceRecord*>(m_data + sizeof(TraceHeader))[index];
+        }
+        uint64_t frames() const
+        {
+            return m_header.frame_count;
+        }
+        // Index of the frame's FRAME record
+        uint64_t frame_start(uint64_t frame) const;
+    };
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __PACER_H__
+#define __PACER_H__
+
+#include <chrono>
+#include <stdint.h>
+
+/*
+ * Paces emulated frames against real time
+ * Each deadline is the previous deadline plus one frame, rather than
+ * measured from when the last wait returned, so time lost oversleeping is
+ * made back on the next frame and the rate doesn't drift. Waits sleep
+ * until shortly before the deadline then spin for the rest, since the OS
+ * only wakes threads to within a millisecond or so
+ */
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock CLOCK;
+    // 70224 dots at 4194304Hz, 59.73Hz
+    static constexpr std::chrono::nanoseconds FRAME_TIME{16742706};
+private:
+    // sleeps end this long before the deadline
+    static constexpr std::chrono::nanoseconds m_SPIN_TAIL{1500000};
+    // falling further behind than this starts again from now, rather
+    // than running flat out to catch up
+    static constexpr uint32_t m_RESYNC_FRAMES = 8;
+    CLOCK::time_point m_deadline;
+    double m_speed = 1.0;
+    bool m_uncapped = false;
+    uint64_t m_resyncs = 0;
+public:
+    FramePacer();
+    // Wait until the next frame is due, returns immediately when uncapped
+    void wait();
+    // Start pacing again from now, such as after the emulator was paused
+    void reset();
+    /*
+     * Multiplier on the emulated frame rate, clamped to 1/16 to 16
+     * Changing speed takes effect from the next frame
+     */
+    void speed(double multiplier);
+    double speed();
+    // Run as fast as the host allows, for fast-forward
+    void uncapped(bool uncapped);
+    bool uncapped();
+    // Times the emulator fell too far behind and pacing restarted
+    uint64_t resyncs();
+};
+
+#endif
@@ -1,25 +1,51 @@
 #ifndef __DRAW_FRAME_H__
 #define __DRAW_FRAME_H__
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <SDL2/SDL.h>
 #include "gameboy/ppu_def.h"
+#include "gameboy/spsc_queue.h"
 
+/*
+ * Presents frames from the thread which created the window, as SDL
+ * requires. The emulator thread hands frames over through a lock-free
+ * queue, posting frame_event() to wake the window's thread, and only the
+ * newest is uploaded to the texture. Presenting doesn't wait on vsync,
+ * the frame pacer already keeps time
+ */
 class Renderer
 {
 private:
-    const int GB_W = 160;
-    const int GB_H = 144;
-    std::shared_ptr<GAMEBOY::LINE_PIXELS> m_line_buffer;
-    uint32_t* m_screen_buffer;
-    int m_buffer_pitch; // number of bytes per row, set by sdl
-    int m_current_line = 0;
+    const int GB_W = GAMEBOY::SCREEN_WIDTH;
+    const int GB_H = GAMEBOY::SCREEN_HEIGHT;
+    const GAMEBOY::SHADE_RGBA_LUT m_SHADE_RGBA = GAMEBOY::DEFAULT_SHADE_RGBA;
     SDL_Renderer* m_sdl_renderer;
     SDL_Texture* m_sdl_texture;
+    Uint32 m_frame_event;
+    GAMEBOY::SpscQueue<GAMEBOY::FRAME_PIXELS, 4> m_frames;
+    GAMEBOY::FRAME_PIXELS m_frame;
+    std::vector<uint32_t> m_screen_buffer;
+    // frames dropped because presenting fell behind
+    std::atomic<uint64_t> m_dropped{0};
 public:
-    Renderer(std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer, SDL_Window* win);
+    // Created on the thread owning the window
+    Renderer(SDL_Window* win);
     ~Renderer();
-    bool add_line();
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+    // Queue a frame for display from any one thread, dropped if the queue is full
+    bool submit_frame(const GAMEBOY::FRAME_PIXELS& frame);
+    // SDL event type posted for each frame queued
+    Uint32 frame_event() const
+    {
+        return m_frame_event;
+    }
+    // Show the newest frame queued, if any, on the window's thread
+    bool present();
+    uint64_t dropped_frames();
 };
 
 #endif
@@ -0,0 +1,70 @@
+#include "audio.h"
+#include <algorithm>
+
+AudioOutput::~AudioOutput()
+{
+    if (m_device != 0)
+    {
+        SDL_CloseAudioDevice(m_device);
+    }
+}
+
+bool AudioOutput::open()
+{
+    SDL_AudioSpec want;
+    SDL_AudioSpec have;
+    memset(&want, 0, sizeof(want));
+    want.freq = m_sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = 512;
+    want.callback = m_callback;
+    want.userdata = this;
+    m_device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (m_device == 0)
+    {
+        return false;
+    }
+    m_sample_rate = have.freq;
+    SDL_PauseAudioDevice(m_device, 0);
+    return true;
+}
+
+uint32_t AudioOutput::sample_rate()
+{
+    return m_sample_rate;
+}
+
+void AudioOutput::submit(const int16_t* samples, size_t frames)
+{
+    if (m_ring.size() > m_MAX_QUEUED)
+    {
+        m_dropped += frames;
+        return;
+    }
+    size_t written = m_ring.write(samples, frames*2);
+    m_dropped += frames - written/2;
+}
+
+void AudioOutput::m_callback(void* userdata, Uint8* stream, int len)
+{
+    AudioOutput* audio = static_cast<AudioOutput*>(userdata);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    size_t count = len/sizeof(int16_t);
+    size_t read = audio->m_ring.read(out, count);
+    if (read < count)
+    {
+        std::fill(out + read, out + count, 0);
+        audio->m_underruns++;
+    }
+}
+
+uint64_t AudioOutput::underruns()
+{
+    return m_underruns;
+}
+
+uint64_t AudioOutput::dropped_frames()
+{
+    return m_dropped;
+}
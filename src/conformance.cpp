@@ -0,0 +1,370 @@
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gameboy/batch.h"
+#include "gameboy/conformance.h"
+#include "gameboy/file.h"
+#include "gameboy/log.h"
+#include "gameboy/rom.h"
+
+/*
+ * Runs a suite of test ROMs concurrently, one instance per ROM on the
+ * batch runner, reporting which passed along with how fast each ran
+ */
+
+struct Options
+{
+    std::vector<std::string> paths;
+    // 120 emulated seconds, enough for Blargg's cpu_instrs
+    uint64_t cycles = 120ull*4194304;
+    uint64_t threads = 0;
+    const char* json_path = nullptr;
+    const char* junit_path = nullptr;
+};
+
+struct Result
+{
+    std::string path;
+    std::optional<size_t> instance;
+    std::string status = "error";
+    std::string source = "none";
+    std::string error;
+    uint64_t cycles = 0;
+    uint64_t cycles_run = 0;
+    double seconds = 0;
+    std::string serial;
+    double mhz() const
+    {
+        return seconds > 0 ? cycles_run/seconds/1e6 : 0.0;
+    }
+};
+
+void display_help(char* exec_name)
+{
+    printf("Missing or incorrect launch parameters.\n\n");
+    printf("Usage: %s [options] rom_or_directory...\n", exec_name);
+    printf("  --cycles N    T-cycles each ROM may run before timing out (default 120 seconds' worth)\n");
+    printf("  --threads N   worker threads (default one per core)\n");
+    printf("  --json FILE   write the results as JSON\n");
+    printf("  --junit FILE  write the results as a JUnit XML report\n");
+}
+
+std::optional<Options> parse_args(int argc, char** argv)
+{
+    Options options;
+    for (int i=1; i<argc; i++)
+    {
+        bool has_value = i+1 < argc;
+        if (!strcmp(argv[i], "--cycles") && has_value)
+        {
+            options.cycles = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value)
+        {
+            options.threads = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--json") && has_value)
+        {
+            options.json_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--junit") && has_value)
+        {
+            options.junit_path = argv[++i];
+        }
+        else if (argv[i][0] != '-')
+        {
+            options.paths.push_back(argv[i]);
+        }
+        else
+        {
+            return {};
+        }
+    }
+    if (options.paths.empty() || options.cycles == 0)
+    {
+        return {};
+    }
+    return options;
+}
+
+// ROMs given directly, and every .gb & .gbc file under directories
+std::vector<std::string> find_roms(const std::vector<std::string>& paths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> roms;
+    for (const std::string& path : paths)
+    {
+        std::error_code error;
+        if (!fs::is_directory(path, error))
+        {
+            roms.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto& entry : fs::recursive_directory_iterator(path, error))
+        {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file(error) && (extension == ".gb" || extension == ".gbc"))
+            {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        roms.insert(roms.end(), found.cbegin(), found.cend());
+    }
+    return roms;
+}
+
+std::string json_escape(const std::string& text)
+{
+    std::string escaped;
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (c < ' ' || c > '~')
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string xml_escape(const std::string& text)
+{
+    std::string escaped;
+    for (unsigned char c : text)
+    {
+        switch (c)
+        {
+            case '&':
+                escaped += "&amp;";
+                break;
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            case '"':
+                escaped += "&quot;";
+                break;
+            case '\n':
+            case '\t':
+                escaped += c;
+                break;
+            default:
+                // XML 1.0 can't hold most control characters at all
+                escaped += c < ' ' || c > '~' ? '?' : c;
+                break;
+        }
+    }
+    return escaped;
+}
+
+std::string results_json(const std::vector<Result>& results, const Options& options, double seconds)
+{
+    std::string json = "{\n";
+    char line[256];
+    snprintf(line, sizeof(line),
+        "  \"budget_cycles\": %lu,\n"
+        "  \"seconds\": %.6f,\n"
+        "  \"roms\": [",
+        (unsigned long)options.cycles, seconds);
+    json += line;
+    for (size_t i=0; i<results.size(); i++)
+    {
+        const Result& result = results[i];
+        json += i == 0 ? "\n" : ",\n";
+        json += "    {\n      \"path\": \"" + json_escape(result.path) + "\",\n";
+        json += "      \"status\": \"" + result.status + "\",\n";
+        json += "      \"source\": \"" + result.source + "\",\n";
+        snprintf(line, sizeof(line),
+            "      \"cycles\": %lu,\n"
+            "      \"cycles_run\": %lu,\n"
+            "      \"seconds\": %.6f,\n"
+            "      \"mhz\": %.2f,\n",
+            (unsigned long)result.cycles,
+            (unsigned long)result.cycles_run,
+            result.seconds,
+            result.mhz());
+        json += line;
+        if (!result.error.empty())
+        {
+            json += "      \"error\": \"" + json_escape(result.error) + "\",\n";
+        }
+        json += "      \"serial\": \"" + json_escape(result.serial) + "\"\n    }";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+std::string results_junit(const std::vector<Result>& results, double seconds)
+{
+    size_t failures = 0;
+    size_t errors = 0;
+    for (const Result& result : results)
+    {
+        failures += result.status == "failed" || result.status == "timeout";
+        errors += result.status == "error";
+    }
+    char line[256];
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    snprintf(line, sizeof(line),
+        "<testsuite name=\"gbemu_conformance\" tests=\"%zu\" failures=\"%zu\" errors=\"%zu\" time=\"%.3f\">\n",
+        results.size(), failures, errors, seconds);
+    xml += line;
+    for (const Result& result : results)
+    {
+        std::filesystem::path path(result.path);
+        snprintf(line, sizeof(line), "\" time=\"%.3f\">\n", result.seconds);
+        xml += "  <testcase classname=\"" + xml_escape(path.parent_path().string()) +
+            "\" name=\"" + xml_escape(path.filename().string()) + line;
+        snprintf(line, sizeof(line), "%s by %s after %lu cycles, %.2f MHz",
+            result.status.c_str(), result.source.c_str(), (unsigned long)result.cycles, result.mhz());
+        if (result.status == "failed" || result.status == "timeout")
+        {
+            xml += "    <failure type=\"" + result.status + "\" message=\"" + line + "\"/>\n";
+        }
+        else if (result.status == "error")
+        {
+            xml += "    <error message=\"" + xml_escape(result.error) + "\"/>\n";
+        }
+        if (!result.serial.empty())
+        {
+            xml += "    <system-out>" + xml_escape(result.serial) + "</system-out>\n";
+        }
+        xml += "  </testcase>\n";
+    }
+    xml += "</testsuite>\n";
+    return xml;
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<Options> optionsopt = parse_args(argc, argv);
+    if (!optionsopt.has_value())
+    {
+        display_help(argv[0]);
+        return 1;
+    }
+    Options options = optionsopt.value();
+    // keep the results readable, loading a ROM logs at INFO
+    GAMEBOY::log_level(std::getenv("DEBUG") != nullptr ? GAMEBOY::LOG_LEVEL::DEBUG : GAMEBOY::LOG_LEVEL::ERROR);
+    GAMEBOY::FileInterface& files = GAMEBOY::FileInterface::standard();
+    std::vector<Result> results;
+    for (const std::string& path : find_roms(options.paths))
+    {
+        results.push_back(Result());
+        results.back().path = path;
+    }
+    if (results.empty())
+    {
+        fprintf(stderr, "No ROMs found\n");
+        return 1;
+    }
+    GAMEBOY::BatchRunner runner(options.threads);
+    // one ROM failing mustn't stop the rest of the suite
+    runner.isolate_errors(true);
+    std::vector<std::unique_ptr<GAMEBOY::ConformanceMonitor>> monitors;
+    for (Result& result : results)
+    {
+        std::optional<ROMDATA> rom = open_rom(result.path.c_str(), files);
+        if (!rom.has_value())
+        {
+            result.error = "ROM could not be read";
+            continue;
+        }
+        size_t index = runner.size();
+        try
+        {
+            // the monitor enforces the budget
+            runner.add(rom.value(), std::numeric_limits<uint64_t>::max(),
+                [&runner, &monitors, index](GAMEBOY::Gameboy&, GAMEBOY::InputHandler&) {
+                    return monitors[index]->check(runner.serial(index)) == GAMEBOY::ConformanceMonitor::STATUS::RUNNING;
+                });
+        }
+        catch (const std::exception& error)
+        {
+            result.error = error.what();
+            continue;
+        }
+        monitors.push_back(std::make_unique<GAMEBOY::ConformanceMonitor>(runner.gameboy(index), options.cycles));
+        result.instance = index;
+    }
+    auto start = std::chrono::steady_clock::now();
+    runner.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t passed = 0;
+    for (Result& result : results)
+    {
+        if (result.instance.has_value())
+        {
+            size_t index = result.instance.value();
+            GAMEBOY::ConformanceMonitor& monitor = *monitors[index];
+            result.cycles_run = runner.gameboy(index).cycles();
+            result.seconds = runner.seconds(index);
+            result.serial.assign(runner.serial(index).cbegin(), runner.serial(index).cend());
+            if (runner.error(index))
+            {
+                try
+                {
+                    std::rethrow_exception(runner.error(index));
+                }
+                catch (const std::exception& error)
+                {
+                    result.error = error.what();
+                }
+                result.cycles = result.cycles_run;
+            }
+            else
+            {
+                result.status = GAMEBOY::ConformanceMonitor::name(monitor.status());
+                result.source = GAMEBOY::ConformanceMonitor::name(monitor.source());
+                result.cycles = monitor.cycles();
+            }
+        }
+        passed += result.status == "passed";
+        printf("%-8s %-10s %12lu cycles %8.2f MHz  %s%s%s\n",
+            result.status.c_str(), result.source.c_str(),
+            (unsigned long)result.cycles, result.mhz(), result.path.c_str(),
+            result.error.empty() ? "" : ": ", result.error.c_str());
+    }
+    printf("%zu of %zu passed in %.2f seconds\n", passed, results.size(), seconds);
+    bool write_failed = false;
+    if (options.json_path != nullptr)
+    {
+        std::string json = results_json(results, options, seconds);
+        write_failed |= !files.write(options.json_path, std::vector<uint8_t>(json.cbegin(), json.cend()));
+    }
+    if (options.junit_path != nullptr)
+    {
+        std::string xml = results_junit(results, seconds);
+        write_failed |= !files.write(options.junit_path, std::vector<uint8_t>(xml.cbegin(), xml.cend()));
+    }
+    if (write_failed)
+    {
+        GBEMU_LOG_ERROR("Failed to write the results\n");
+        return 1;
+    }
+    return passed == results.size() ? 0 : 1;
+}
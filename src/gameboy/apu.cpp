@@ -0,0 +1,502 @@
+#include "gameboy/apu.h"
+#include "gameboy/state.h"
+
+namespace
+{
+    // bits set in registers which always read back as 1, from NR10 to 0xFF2F
+    const std::array<uint8_t, 0x20> READ_MASK = {
+        0x80, 0x3F, 0x00, 0xFF, 0xBF,
+        0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+        0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+        0xFF, 0xFF, 0x00, 0x00, 0xBF,
+        0x00, 0x00, 0x70,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    // output for each of the 8 steps, 12.5%, 25%, 50% & 75%
+    const std::array<uint8_t, 4> DUTY = {0x80, 0x81, 0xE1, 0x7E};
+    // the four channels mixed at full volume reach about half of full scale
+    const float GAIN = 32.0f;
+    // frequencies are 11 bits, sweeping past this turns channel 1 off
+    const uint16_t MAX_FREQUENCY = 2047;
+}
+
+GAMEBOY::APU::APU(Scheduler& scheduler)
+: m_scheduler(scheduler)
+{
+    // as left by the boot ROM
+    const std::array<uint8_t, 0x17> initial = {
+        0x80, 0xBF, 0xF3, 0xFF, 0xBF,
+        0x00, 0x3F, 0x00, 0xFF, 0xBF,
+        0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+        0x00, 0xFF, 0x00, 0x00, 0xBF,
+        0x77, 0xF3, 0x80};
+    std::copy(initial.cbegin(), initial.cend(), m_regs.begin());
+    // the boot chime has faded out, but channel 1 is still on
+    m_channels[0].enabled = true;
+    m_channels[3].phase = 0x7FFF;
+    m_synth_time = m_scheduler.now();
+    for (Channel& channel : m_channels)
+    {
+        channel.next_step = m_synth_time;
+    }
+    m_scheduler.handler(EventType::APU_FRAME_SEQUENCER, [this](uint64_t time) {
+        m_sequencer_event(time);
+    });
+    m_scheduler.schedule(EventType::APU_FRAME_SEQUENCER,
+        (m_synth_time/m_FRAME_SEQUENCER_CYCLES + 1)*m_FRAME_SEQUENCER_CYCLES);
+}
+
+uint16_t GAMEBOY::APU::m_frequency(size_t channel)
+{
+    uint16_t base = REG_LO + channel*5;
+    return ((m_reg(base + 4) & 0x07) << 8) | m_reg(base + 3);
+}
+
+void GAMEBOY::APU::m_frequency(size_t channel, uint16_t frequency)
+{
+    uint16_t base = REG_LO + channel*5;
+    m_reg(base + 3) = frequency & 0xFF;
+    m_reg(base + 4) = (m_reg(base + 4) & 0xF8) | ((frequency >> 8) & 0x07);
+}
+
+/**
+ * @brief Dots between steps of the channel's waveform, 0 when the
+ * noise channel's clock is stopped
+ */
+uint64_t GAMEBOY::APU::m_period(size_t channel)
+{
+    switch (channel)
+    {
+        case 0:
+        case 1:
+            return (2048 - m_frequency(channel))*4;
+        case 2:
+            return (2048 - m_frequency(channel))*2;
+        default:
+        {
+            uint8_t nr43 = m_reg(NR43);
+            uint8_t shift = nr43 >> 4;
+            if (shift >= 14)
+            {
+                return 0;
+            }
+            uint64_t divider = nr43 & 0x07 ? (nr43 & 0x07)*16 : 8;
+            return divider << shift;
+        }
+    }
+}
+
+bool GAMEBOY::APU::m_dac(size_t channel)
+{
+    if (channel == 2)
+    {
+        return m_reg(NR30) & 0x80;
+    }
+    return m_reg(REG_LO + channel*5 + 2) & 0xF8;
+}
+
+void GAMEBOY::APU::m_trigger(size_t channel, uint64_t time)
+{
+    Channel& ch = m_channels[channel];
+    ch.enabled = m_dac(channel);
+    if (ch.length == 0)
+    {
+        ch.length = channel == 2 ? 256 : 64;
+    }
+    ch.next_step = time + m_period(channel);
+    uint8_t envelope = m_reg(REG_LO + channel*5 + 2);
+    ch.envelope.volume = envelope >> 4;
+    ch.envelope.timer = envelope & 0x07;
+    if (channel == 2)
+    {
+        ch.phase = 0;
+    }
+    else if (channel == 3)
+    {
+        ch.phase = 0x7FFF;
+    }
+    else if (channel == 0)
+    {
+        uint8_t pace = (m_reg(NR10) >> 4) & 0x07;
+        uint8_t step = m_reg(NR10) & 0x07;
+        m_sweep_shadow = m_frequency(0);
+        m_sweep_timer = pace ? pace : 8;
+        m_sweep_enabled = pace || step;
+        if (step)
+        {
+            // overflowing straight away disables the channel
+            m_sweep_next();
+        }
+    }
+}
+
+uint8_t GAMEBOY::APU::m_output(size_t channel)
+{
+    const Channel& ch = m_channels[channel];
+    if (!ch.enabled)
+    {
+        return 0;
+    }
+    switch (channel)
+    {
+        case 0:
+        case 1:
+        {
+            uint8_t duty = DUTY[m_reg(REG_LO + channel*5 + 1) >> 6];
+            return (duty >> (7 - ch.phase)) & 0x01 ? ch.envelope.volume : 0;
+        }
+        case 2:
+        {
+            uint8_t samples = m_reg(WAVE_RAM_LO + ch.phase/2);
+            uint8_t sample = ch.phase & 0x01 ? samples & 0x0F : samples >> 4;
+            uint8_t level = (m_reg(NR32) >> 5) & 0x03;
+            return level ? sample >> (level - 1) : 0;
+        }
+        default:
+            return ch.phase & 0x01 ? 0 : ch.envelope.volume;
+    }
+}
+
+void GAMEBOY::APU::m_step(size_t channel)
+{
+    Channel& ch = m_channels[channel];
+    switch (channel)
+    {
+        case 0:
+        case 1:
+            ch.phase = (ch.phase + 1) & 0x07;
+            break;
+        case 2:
+            ch.phase = (ch.phase + 1) & 0x1F;
+            break;
+        default:
+        {
+            uint16_t feedback = (ch.phase ^ (ch.phase >> 1)) & 0x01;
+            ch.phase = (ch.phase >> 1) | (feedback << 14);
+            if (m_reg(NR43) & 0x08)
+            {
+                ch.phase = (ch.phase & ~0x40) | (feedback << 6);
+            }
+            break;
+        }
+    }
+}
+
+void GAMEBOY::APU::m_run(uint64_t time)
+{
+    if (time <= m_synth_time)
+    {
+        return;
+    }
+    for (size_t channel=0; channel<m_channels.size(); channel++)
+    {
+        Channel& ch = m_channels[channel];
+        uint64_t period = m_period(channel);
+        if (period == 0)
+        {
+            ch.next_step = time;
+            continue;
+        }
+        if (!m_sample_callback || !ch.enabled)
+        {
+            // nothing is heard, so only keep the waveform's position
+            if (ch.next_step <= time)
+            {
+                uint64_t steps = (time - ch.next_step)/period + 1;
+                ch.next_step += steps*period;
+                if (channel < 3)
+                {
+                    ch.phase = (ch.phase + steps) & (channel == 2 ? 0x1F : 0x07);
+                }
+            }
+            continue;
+        }
+        while (ch.next_step <= time)
+        {
+            m_step(channel);
+            m_update(channel, ch.next_step);
+            ch.next_step += period;
+        }
+    }
+    m_synth_time = time;
+}
+
+void GAMEBOY::APU::m_update(size_t channel, uint64_t time)
+{
+    if (!m_sample_callback)
+    {
+        return;
+    }
+    Channel& ch = m_channels[channel];
+    uint8_t level = m_output(channel);
+    uint8_t nr50 = m_reg(NR50);
+    uint8_t nr51 = m_reg(NR51);
+    float left = (nr51 >> (channel + 4)) & 0x01 ? level*(((nr50 >> 4) & 0x07) + 1) : 0;
+    float right = (nr51 >> channel) & 0x01 ? level*((nr50 & 0x07) + 1) : 0;
+    uint32_t offset = time - m_frame_start;
+    if (left != ch.left)
+    {
+        m_left->add_delta(offset, left - ch.left);
+        ch.left = left;
+    }
+    if (right != ch.right)
+    {
+        m_right->add_delta(offset, right - ch.right);
+        ch.right = right;
+    }
+}
+
+uint16_t GAMEBOY::APU::m_sweep_next()
+{
+    uint16_t delta = m_sweep_shadow >> (m_reg(NR10) & 0x07);
+    uint16_t frequency = m_reg(NR10) & 0x08 ? m_sweep_shadow - delta : m_sweep_shadow + delta;
+    if (frequency > MAX_FREQUENCY)
+    {
+        m_channels[0].enabled = false;
+    }
+    return frequency;
+}
+
+void GAMEBOY::APU::m_sequencer_event(uint64_t time)
+{
+    m_run(time);
+    m_scheduler.schedule(EventType::APU_FRAME_SEQUENCER, time + m_FRAME_SEQUENCER_CYCLES);
+    if (m_powered())
+    {
+        // lengths at 256Hz
+        if (m_sequencer_step % 2 == 0)
+        {
+            for (size_t channel=0; channel<m_channels.size(); channel++)
+            {
+                Channel& ch = m_channels[channel];
+                if ((m_reg(REG_LO + channel*5 + 4) & 0x40) && ch.length > 0 && --ch.length == 0)
+                {
+                    ch.enabled = false;
+                }
+            }
+        }
+        // sweep at 128Hz
+        if ((m_sequencer_step == 2 || m_sequencer_step == 6) && m_sweep_timer > 0 && --m_sweep_timer == 0)
+        {
+            uint8_t pace = (m_reg(NR10) >> 4) & 0x07;
+            m_sweep_timer = pace ? pace : 8;
+            if (m_sweep_enabled && pace)
+            {
+                uint16_t frequency = m_sweep_next();
+                if (frequency <= MAX_FREQUENCY && (m_reg(NR10) & 0x07))
+                {
+                    m_sweep_shadow = frequency;
+                    m_frequency(0, frequency);
+                    m_sweep_next();
+                }
+            }
+        }
+        // envelopes at 64Hz
+        if (m_sequencer_step == 7)
+        {
+            for (size_t channel : {0, 1, 3})
+            {
+                uint8_t envelope = m_reg(REG_LO + channel*5 + 2);
+                Envelope& env = m_channels[channel].envelope;
+                uint8_t pace = envelope & 0x07;
+                if (pace == 0 || (env.timer > 0 && --env.timer > 0))
+                {
+                    continue;
+                }
+                env.timer = pace;
+                if ((envelope & 0x08) && env.volume < 15)
+                {
+                    env.volume++;
+                }
+                else if (!(envelope & 0x08) && env.volume > 0)
+                {
+                    env.volume--;
+                }
+            }
+        }
+        for (size_t channel=0; channel<m_channels.size(); channel++)
+        {
+            m_update(channel, time);
+        }
+    }
+    m_sequencer_step = (m_sequencer_step + 1) & 0x07;
+    m_emit(time);
+}
+
+void GAMEBOY::APU::m_emit(uint64_t time)
+{
+    if (!m_sample_callback)
+    {
+        return;
+    }
+    m_left->end_frame(time - m_frame_start);
+    m_right->end_frame(time - m_frame_start);
+    m_frame_start = time;
+    size_t frames = m_left->available();
+    if (frames == 0)
+    {
+        return;
+    }
+    m_out.resize(frames*2);
+    m_left->read(m_out.data(), frames, 2, GAIN);
+    m_right->read(m_out.data() + 1, frames, 2, GAIN);
+    m_sample_callback(m_out.data(), frames);
+}
+
+uint8_t GAMEBOY::APU::read(uint16_t addr)
+{
+    if (addr >= WAVE_RAM_LO)
+    {
+        return m_reg(addr);
+    }
+    if (addr == NR52)
+    {
+        uint8_t status = (m_reg(NR52) & 0x80) | READ_MASK[NR52 - REG_LO];
+        for (size_t channel=0; channel<m_channels.size(); channel++)
+        {
+            status |= m_channels[channel].enabled << channel;
+        }
+        return status;
+    }
+    return m_reg(addr) | READ_MASK[addr - REG_LO];
+}
+
+void GAMEBOY::APU::write(uint16_t addr, uint8_t data)
+{
+    uint64_t now = m_scheduler.now();
+    // the waveform so far was made with the old settings
+    m_run(now);
+    if (addr >= WAVE_RAM_LO)
+    {
+        m_reg(addr) = data;
+    }
+    else if (addr == NR52)
+    {
+        if (m_powered() && !(data & 0x80))
+        {
+            // powering off clears every register
+            std::fill(m_regs.begin(), m_regs.begin() + (NR52 - REG_LO), 0);
+            for (Channel& ch : m_channels)
+            {
+                ch.enabled = false;
+            }
+        }
+        else if (!m_powered() && (data & 0x80))
+        {
+            m_sequencer_step = 0;
+        }
+        m_reg(NR52) = data & 0x80;
+    }
+    else if (m_powered() && addr < NR52)
+    {
+        m_reg(addr) = data;
+        if (addr < NR50)
+        {
+            size_t channel = (addr - REG_LO)/5;
+            Channel& ch = m_channels[channel];
+            switch ((addr - REG_LO) % 5)
+            {
+                case 0:
+                case 2:
+                    // DAC off, which also turns the channel off
+                    if (!m_dac(channel))
+                    {
+                        ch.enabled = false;
+                    }
+                    break;
+                case 1:
+                    ch.length = channel == 2 ? 256 - data : 64 - (data & 0x3F);
+                    break;
+                case 4:
+                    if (data & 0x80)
+                    {
+                        m_trigger(channel, now);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    for (size_t channel=0; channel<m_channels.size(); channel++)
+    {
+        m_update(channel, now);
+    }
+}
+
+void GAMEBOY::APU::on_samples(SAMPLE_CALLBACK callback, uint32_t sample_rate)
+{
+    uint64_t now = m_scheduler.now();
+    m_run(now);
+    m_sample_callback = callback;
+    m_sample_rate = sample_rate;
+    m_frame_start = now;
+    for (Channel& ch : m_channels)
+    {
+        ch.left = 0;
+        ch.right = 0;
+    }
+    if (!callback)
+    {
+        m_left.reset();
+        m_right.reset();
+        return;
+    }
+    // room for a couple of batches
+    size_t capacity = sample_rate*m_FRAME_SEQUENCER_CYCLES/CLOCK_RATE*2 + BandlimitedBuffer::TAPS;
+    m_left = std::make_unique<BandlimitedBuffer>(CLOCK_RATE, sample_rate, capacity);
+    m_right = std::make_unique<BandlimitedBuffer>(CLOCK_RATE, sample_rate, capacity);
+    for (size_t channel=0; channel<m_channels.size(); channel++)
+    {
+        m_update(channel, now);
+    }
+}
+
+void GAMEBOY::APU::flush()
+{
+    uint64_t now = m_scheduler.now();
+    m_run(now);
+    m_emit(now);
+}
+
+void GAMEBOY::APU::save_state(StateWriter& state) const
+{
+    state.write(m_regs);
+    for (const Channel& ch : m_channels)
+    {
+        state.write(ch.enabled);
+        state.write(ch.length);
+        state.write(ch.next_step);
+        state.write(ch.phase);
+        state.write(ch.envelope.volume);
+        state.write(ch.envelope.timer);
+    }
+    state.write(m_sequencer_step);
+    state.write(m_sweep_shadow);
+    state.write(m_sweep_timer);
+    state.write(m_sweep_enabled);
+    state.write(m_synth_time);
+}
+
+void GAMEBOY::APU::load_state(StateReader& state)
+{
+    state.read(m_regs);
+    for (Channel& ch : m_channels)
+    {
+        ch.enabled = state.read<bool>();
+        ch.length = state.read<uint16_t>();
+        ch.next_step = state.read<uint64_t>();
+        ch.phase = state.read<uint16_t>();
+        ch.envelope.volume = state.read<uint8_t>();
+        ch.envelope.timer = state.read<uint8_t>();
+    }
+    m_sequencer_step = state.read<uint8_t>();
+    m_sweep_shadow = state.read<uint16_t>();
+    m_sweep_timer = state.read<uint8_t>();
+    m_sweep_enabled = state.read<bool>();
+    m_synth_time = state.read<uint64_t>();
+    // synthesis starts over from the loaded cycle
+    if (m_sample_callback)
+    {
+        on_samples(m_sample_callback, m_sample_rate);
+    }
+}
@@ -0,0 +1,78 @@
+#include "gameboy/apu_synth.h"
+#include <algorithm>
+#include <cmath>
+
+GAMEBOY::BandlimitedBuffer::BandlimitedBuffer(uint32_t clock_rate, uint32_t sample_rate, size_t capacity)
+: m_samples(capacity + TAPS, 0.0f)
+{
+    m_factor = (static_cast<uint64_t>(sample_rate) << 32)/clock_rate;
+    // cut off a little below Nyquist, so the window's roll off is inaudible
+    const double CUTOFF = 0.9;
+    const double PI = 3.14159265358979323846;
+    for (size_t phase=0; phase<PHASES; phase++)
+    {
+        KERNEL& kernel = m_kernels[phase];
+        double sum = 0;
+        for (size_t tap=0; tap<TAPS; tap++)
+        {
+            // distance from the impulse, centred between the middle taps
+            double x = tap - (TAPS/2 - 1) - static_cast<double>(phase)/PHASES;
+            double sinc = x == 0 ? 1.0 : std::sin(PI*CUTOFF*x)/(PI*CUTOFF*x);
+            // Blackman window over the kernel's width
+            double w = (x + TAPS/2)/TAPS;
+            double window = 0.42 - 0.5*std::cos(2*PI*w) + 0.08*std::cos(4*PI*w);
+            kernel[tap] = sinc*window;
+            sum += kernel[tap];
+        }
+        // each impulse adds exactly its delta once summed
+        for (float& value : kernel)
+        {
+            value /= sum;
+        }
+    }
+}
+
+void GAMEBOY::BandlimitedBuffer::end_frame(uint32_t time)
+{
+    m_offset += time*m_factor;
+    m_available = m_offset >> 32;
+    if (m_available + TAPS > m_samples.size())
+    {
+        m_grow(m_available + TAPS);
+    }
+}
+
+void GAMEBOY::BandlimitedBuffer::m_grow(size_t size)
+{
+    // doubling keeps repeated long frames from reallocating every time
+    m_samples.resize(std::max(size, m_samples.size()*2), 0.0f);
+}
+
+size_t GAMEBOY::BandlimitedBuffer::read(int16_t* out, size_t count, size_t stride, float gain)
+{
+    count = std::min(count, m_available);
+    // roughly a 20Hz cut off at common sample rates
+    const float DC_RATE = 0.003f;
+    for (size_t i=0; i<count; i++)
+    {
+        m_sum += m_samples[i];
+        m_dc += (m_sum - m_dc)*DC_RATE;
+        float sample = std::clamp((m_sum - m_dc)*gain, -32768.0f, 32767.0f);
+        out[i*stride] = static_cast<int16_t>(sample);
+    }
+    // keep the tails of impulses not yet read
+    std::copy(m_samples.begin() + count, m_samples.end(), m_samples.begin());
+    std::fill(m_samples.end() - count, m_samples.end(), 0.0f);
+    m_available -= count;
+    m_offset -= static_cast<uint64_t>(count) << 32;
+    return count;
+}
+
+void GAMEBOY::BandlimitedBuffer::clear()
+{
+    std::fill(m_samples.begin(), m_samples.end(), 0.0f);
+    m_available = 0;
+    m_offset &= 0xFFFFFFFF;
+    m_sum = 0;
+    m_dc = 0;
+}
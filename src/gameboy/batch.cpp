@@ -0,0 +1,251 @@
+#include "gameboy/batch.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    // Keep a worker on one core, so its instances stay in that core's cache
+    void pin_thread([[maybe_unused]] std::thread& thread, [[maybe_unused]] size_t core)
+    {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#endif
+    }
+}
+
+GAMEBOY::BatchRunner::BatchRunner(size_t threads)
+: m_threads(threads)
+{
+    if (m_threads == 0)
+    {
+        m_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+}
+
+size_t GAMEBOY::BatchRunner::add(ROMDATA& rom, uint64_t frames, QUANTUM_CALLBACK callback)
+{
+    size_t index = m_instances.size();
+    auto instance = std::make_unique<Instance>();
+    instance->gameboy = std::make_unique<Gameboy>(rom, instance->input_handler);
+    instance->frames = frames;
+    instance->finished = frames == 0;
+    instance->callback = callback;
+    Instance* instance_ptr = instance.get();
+    instance->gameboy->on_serial_out([instance_ptr](uint8_t data) {
+        instance_ptr->serial.push_back(data);
+    });
+    m_instances.push_back(std::move(instance));
+    return index;
+}
+
+size_t GAMEBOY::BatchRunner::size() const
+{
+    return m_instances.size();
+}
+
+GAMEBOY::Gameboy& GAMEBOY::BatchRunner::gameboy(size_t index)
+{
+    return *m_instances.at(index)->gameboy;
+}
+
+GAMEBOY::InputHandler& GAMEBOY::BatchRunner::input_handler(size_t index)
+{
+    return m_instances.at(index)->input_handler;
+}
+
+const std::vector<uint8_t>& GAMEBOY::BatchRunner::serial(size_t index) const
+{
+    return m_instances.at(index)->serial;
+}
+
+uint64_t GAMEBOY::BatchRunner::frames_run(size_t index) const
+{
+    return m_instances.at(index)->frames_run;
+}
+
+double GAMEBOY::BatchRunner::seconds(size_t index) const
+{
+    return m_instances.at(index)->run_ns/1e9;
+}
+
+void GAMEBOY::BatchRunner::isolate_errors(bool isolate)
+{
+    m_isolate_errors = isolate;
+}
+
+std::exception_ptr GAMEBOY::BatchRunner::error(size_t index) const
+{
+    return m_instances.at(index)->error;
+}
+
+/**
+ * @brief Take the next instance from the worker's own queue, otherwise
+ * steal the instance least recently queued on another worker
+ */
+bool GAMEBOY::BatchRunner::m_next(size_t worker, size_t& index)
+{
+    {
+        Worker& own = *m_workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.queue.empty())
+        {
+            index = own.queue.front();
+            own.queue.pop_front();
+            return true;
+        }
+    }
+    for (size_t i=1; i<m_workers.size(); i++)
+    {
+        Worker& victim = *m_workers[(worker + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty())
+        {
+            index = victim.queue.front();
+            victim.queue.pop_front();
+            m_steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void GAMEBOY::BatchRunner::m_work(size_t worker, uint32_t quantum_frames)
+{
+    size_t index;
+    while (m_remaining > 0 && !m_failed)
+    {
+        if (!m_next(worker, index))
+        {
+            // the remaining instances are being run by other workers
+            std::this_thread::yield();
+            continue;
+        }
+        Instance& instance = *m_instances[index];
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            for (uint32_t frame=0; frame<quantum_frames && instance.frames_run<instance.frames; frame++)
+            {
+                instance.gameboy->run_frame();
+                instance.frames_run++;
+            }
+            if (instance.callback && !instance.callback(*instance.gameboy, instance.input_handler))
+            {
+                instance.finished = true;
+            }
+        }
+        catch (...)
+        {
+            if (!m_isolate_errors)
+            {
+                throw;
+            }
+            instance.error = std::current_exception();
+            instance.finished = true;
+        }
+        instance.run_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (instance.frames_run >= instance.frames)
+        {
+            instance.finished = true;
+        }
+        if (instance.finished)
+        {
+            m_remaining--;
+            continue;
+        }
+        // requeued on the same worker
+        Worker& own = *m_workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.queue.push_back(index);
+    }
+}
+
+GAMEBOY::BatchRunner::Stats GAMEBOY::BatchRunner::run(uint32_t quantum_frames)
+{
+    if (quantum_frames == 0)
+    {
+        throw std::invalid_argument("Batch quantum must be at least 1 frame");
+    }
+    Stats stats;
+    stats.instances = m_instances.size();
+    stats.threads = std::max<size_t>(std::min(m_threads, m_instances.size()), 1);
+    std::vector<uint64_t> start_frames, start_cycles;
+    for (auto& instance : m_instances)
+    {
+        start_frames.push_back(instance->frames_run);
+        start_cycles.push_back(instance->gameboy->cycles());
+    }
+    m_workers.clear();
+    for (size_t i=0; i<stats.threads; i++)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    size_t remaining = 0;
+    for (size_t index=0; index<m_instances.size(); index++)
+    {
+        if (!m_instances[index]->finished)
+        {
+            m_workers[remaining++ % stats.threads]->queue.push_back(index);
+        }
+    }
+    m_remaining = remaining;
+    m_steals = 0;
+    m_failed = false;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t worker=0; worker<stats.threads; worker++)
+    {
+        threads.emplace_back([this, worker, quantum_frames, &error, &error_mutex]() {
+            try
+            {
+                m_work(worker, quantum_frames);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                m_failed = true;
+            }
+        });
+        // sharing cores between workers would only add migrations
+        if (stats.threads <= cores)
+        {
+            pin_thread(threads.back(), worker);
+        }
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    for (size_t index=0; index<m_instances.size(); index++)
+    {
+        stats.frames += m_instances[index]->frames_run - start_frames[index];
+        stats.cycles += m_instances[index]->gameboy->cycles() - start_cycles[index];
+    }
+    stats.steals = m_steals;
+    stats.frames_per_second = stats.seconds > 0 ? stats.frames/stats.seconds : 0.0;
+    return stats;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "gameboy/conformance.h"
+
+namespace
+{
+    // mooneye tests also send the registers they check over serial
+    const std::array<uint8_t, 6> FIBONACCI = {3, 5, 8, 13, 21, 34};
+    const std::array<uint8_t, 6> FIBONACCI_FAILED = {0x42, 0x42, 0x42, 0x42, 0x42, 0x42};
+
+    bool contains(const std::vector<uint8_t>& serial, const uint8_t* pattern, size_t size)
+    {
+        return std::search(serial.cbegin(), serial.cend(), pattern, pattern + size) != serial.cend();
+    }
+
+    bool contains(const std::vector<uint8_t>& serial, const char* text)
+    {
+        return contains(serial, reinterpret_cast<const uint8_t*>(text), strlen(text));
+    }
+}
+
+GAMEBOY::ConformanceMonitor::ConformanceMonitor(Gameboy& gameboy, uint64_t cycle_budget)
+: m_gameboy(gameboy), m_budget(cycle_budget)
+{
+    m_gameboy.on_breakpoint([this](const CpuRegisters& registers, uint8_t opcode) {
+        m_breakpoint(registers, opcode);
+    });
+}
+
+void GAMEBOY::ConformanceMonitor::m_finish(STATUS status, SOURCE source, uint64_t cycles)
+{
+    if (m_status != STATUS::RUNNING)
+    {
+        return;
+    }
+    m_status = status;
+    m_source = source;
+    m_cycles = cycles;
+}
+
+void GAMEBOY::ConformanceMonitor::m_breakpoint(const CpuRegisters& registers, uint8_t opcode)
+{
+    if (opcode == 0x40)
+    {
+        bool passed = *registers.B == 3 && *registers.C == 5 && *registers.D == 8 &&
+            *registers.E == 13 && *registers.H == 21 && *registers.L == 34;
+        m_finish(passed ? STATUS::PASSED : STATUS::FAILED, SOURCE::BREAKPOINT, m_gameboy.cycles());
+        return;
+    }
+    // waiting for an interrupt isn't the end
+    if (!m_looped && (!registers.IME || (m_gameboy.peek(INTERRUPT_ENABLE) & 0x1F) == 0))
+    {
+        m_looped = true;
+        m_loop_cycles = m_gameboy.cycles();
+    }
+}
+
+GAMEBOY::ConformanceMonitor::STATUS GAMEBOY::ConformanceMonitor::check(const std::vector<uint8_t>& serial)
+{
+    if (m_status != STATUS::RUNNING)
+    {
+        return m_status;
+    }
+    // Blargg's tests print their result, then loop
+    if (contains(serial, "Failed") || contains(serial, FIBONACCI_FAILED.data(), FIBONACCI_FAILED.size()))
+    {
+        m_finish(STATUS::FAILED, SOURCE::SERIAL, m_gameboy.cycles());
+    }
+    else if (contains(serial, "Passed") || contains(serial, FIBONACCI.data(), FIBONACCI.size()))
+    {
+        m_finish(STATUS::PASSED, SOURCE::SERIAL, m_gameboy.cycles());
+    }
+    else if (m_looped)
+    {
+        // stuck without giving a result
+        m_finish(STATUS::FAILED, SOURCE::LOOP, m_loop_cycles);
+    }
+    else if (m_gameboy.cycles() >= m_budget)
+    {
+        m_finish(STATUS::TIMEOUT, SOURCE::BUDGET, m_gameboy.cycles());
+    }
+    return m_status;
+}
+
+const char* GAMEBOY::ConformanceMonitor::name(STATUS status)
+{
+    switch (status)
+    {
+        case STATUS::RUNNING:
+            return "running";
+        case STATUS::PASSED:
+            return "passed";
+        case STATUS::FAILED:
+            return "failed";
+        case STATUS::TIMEOUT:
+            return "timeout";
+    }
+    return "unknown";
+}
+
+const char* GAMEBOY::ConformanceMonitor::name(SOURCE source)
+{
+    switch (source)
+    {
+        case SOURCE::NONE:
+            return "none";
+        case SOURCE::SERIAL:
+            return "serial";
+        case SOURCE::BREAKPOINT:
+            return "breakpoint";
+        case SOURCE::LOOP:
+            return "loop";
+        case SOURCE::BUDGET:
+            return "budget";
+    }
+    return "unknown";
+}
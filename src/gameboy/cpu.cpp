@@ -1,6 +1,10 @@
 #include "gameboy/cpu.h"
+#include "gameboy/cpu_instruction_control.h"
 #include "gameboy/cpu_instruction_decode.h"
+#include "gameboy/log.h"
 #include "gameboy/memory_io.h"
+#include "gameboy/state.h"
+#include <stdexcept>
 
 /**
  * @brief Advance 1 M-Cycle
@@ -25,43 +29,142 @@ const GAMEBOY::CpuRegisters& GAMEBOY::Cpu::tick()
                     memory,
                     interruptType
                 );
+            GBEMU_STAT(memory.stats().interrupts++);
+            if (memory.tracer())
+            {
+                uint16_t vector = 0x40;
+                for (uint8_t mask = interruptTypeMask; mask > 1; mask >>= 1)
+                {
+                    vector += 8;
+                }
+                m_trace(*memory.tracer(), TraceKind::INTERRUPT, 0, vector);
+            }
         }
     }
     if (currentInstruction == nullptr)
     {
         uint8_t opcode = memory.read(*registers.PC);
-        SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "opcode: %02X\n", opcode);
+        GBEMU_LOG_DEBUG("opcode: %02X\n", opcode);
         currentInstruction = decode_opcode(opcode, registers, memory);
+        GBEMU_STAT(memory.stats().instructions++);
+        GBEMU_STAT(memory.stats().opcodes[opcode]++);
+        if (memory.tracer())
+        {
+            m_trace(*memory.tracer(), TraceKind::INSTRUCTION, opcode, 0);
+        }
+        if (m_breakpoint && (opcode == 0x40 || (opcode == 0x18 && memory.peek(*registers.PC + 1) == 0xFE)))
+        {
+            m_breakpoint(registers, opcode);
+        }
     }
+    bool trace_accesses = memory.tracer() && memory.tracer()->memory_accesses();
+    memory.trace_accesses(trace_accesses);
     InstructionResult instruction_result = currentInstruction->tick();
+    memory.trace_accesses(false);
     if (instruction_result == InstructionResult::FINISHED)
     {
         delete currentInstruction;
         currentInstruction = nullptr;
     }
-    if (instruction_result != InstructionResult::STOP)
-    {
-        Timer::getInstance().tick(memory);
-    }
     // Exit HALT on interrupt
-    if (instruction_result == InstructionResult::HALT)
+    m_halted = instruction_result == InstructionResult::HALT;
+    if (m_halted)
     {
+        GBEMU_STAT(memory.stats().halt_mcycles++);
         if (interruptHandler.isQueued(memory))
         {
             delete currentInstruction;
             currentInstruction = nullptr;
+            m_halted = false;
         }
     }
     // Exit STOP on button press
-    if (instruction_result == InstructionResult::STOP)
+    m_stopped = instruction_result == InstructionResult::STOP;
+    if (m_stopped)
     {
+        GBEMU_STAT(memory.stats().stop_mcycles++);
         uint8_t joypad = memory.read(IOHandler::INPUT_JOYP);
         if ((joypad & 0xF) == 0x0)
         {
             delete currentInstruction;
             currentInstruction = nullptr;
+            m_stopped = false;
+            memory.timer().resume();
         }
     }
     return registers;
 }
 
+void GAMEBOY::Cpu::m_trace(TraceRecorder& tracer, TraceKind kind, uint8_t opcode, uint16_t addr)
+{
+    TraceRecord record = {};
+    record.cycle = memory.scheduler().now();
+    record.pc = *registers.PC;
+    record.bank = memory.rom_bank();
+    record.af = *registers.AF;
+    record.bc = *registers.BC;
+    record.de = *registers.DE;
+    record.hl = *registers.HL;
+    record.sp = *registers.SP;
+    record.kind = kind;
+    record.opcode = opcode;
+    if (kind == TraceKind::INSTRUCTION)
+    {
+        record.operands = {memory.peek(*registers.PC + 1), memory.peek(*registers.PC + 2)};
+    }
+    record.addr = addr;
+    record.ime = registers.IME;
+    tracer.instruction(record);
+}
+
+bool GAMEBOY::Cpu::halted()
+{
+    return m_halted && !interruptHandler.isQueued(memory);
+}
+
+
+bool GAMEBOY::Cpu::instruction_boundary()
+{
+    return currentInstruction == nullptr || m_halted || m_stopped;
+}
+
+void GAMEBOY::Cpu::save_state(StateWriter& state)
+{
+    if (!instruction_boundary())
+    {
+        throw std::logic_error("CPU state saved part way through an instruction");
+    }
+    state.write(*registers.AF);
+    state.write(*registers.BC);
+    state.write(*registers.DE);
+    state.write(*registers.HL);
+    state.write(*registers.SP);
+    state.write(*registers.PC);
+    state.write(registers.IME);
+    state.write(m_halted);
+    state.write(m_stopped);
+}
+
+void GAMEBOY::Cpu::load_state(StateReader& state)
+{
+    *registers.AF = state.read<uint16_t>();
+    *registers.BC = state.read<uint16_t>();
+    *registers.DE = state.read<uint16_t>();
+    *registers.HL = state.read<uint16_t>();
+    *registers.SP = state.read<uint16_t>();
+    *registers.PC = state.read<uint16_t>();
+    registers.IME = state.read<bool>();
+    m_halted = state.read<bool>();
+    m_stopped = state.read<bool>();
+    delete currentInstruction;
+    currentInstruction = nullptr;
+    // PC has already moved past the HALT or STOP opcode
+    if (m_halted)
+    {
+        currentInstruction = new HALT(registers, memory, 1);
+    }
+    else if (m_stopped)
+    {
+        currentInstruction = new STOP(registers, memory, 1);
+    }
+}
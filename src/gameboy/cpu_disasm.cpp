@@ -0,0 +1,164 @@
+#include <array>
+#include <stdio.h>
+#include <string.h>
+
+#include "gameboy/cpu_disasm.h"
+
+namespace
+{
+    /*
+     * Operand tokens are replaced when disassembling
+     * d8/d16 immediate data, a8 an offset from 0xFF00, a16 an address,
+     * r8 a signed offset
+     */
+    const std::array<const char*, 0x40> OPCODES_LO = {
+        "NOP", "LD BC,d16", "LD (BC),A", "INC BC", "INC B", "DEC B", "LD B,d8", "RLCA",
+        "LD (a16),SP", "ADD HL,BC", "LD A,(BC)", "DEC BC", "INC C", "DEC C", "LD C,d8", "RRCA",
+        "STOP", "LD DE,d16", "LD (DE),A", "INC DE", "INC D", "DEC D", "LD D,d8", "RLA",
+        "JR r8", "ADD HL,DE", "LD A,(DE)", "DEC DE", "INC E", "DEC E", "LD E,d8", "RRA",
+        "JR NZ,r8", "LD HL,d16", "LD (HL+),A", "INC HL", "INC H", "DEC H", "LD H,d8", "DAA",
+        "JR Z,r8", "ADD HL,HL", "LD A,(HL+)", "DEC HL", "INC L", "DEC L", "LD L,d8", "CPL",
+        "JR NC,r8", "LD SP,d16", "LD (HL-),A", "INC SP", "INC (HL)", "DEC (HL)", "LD (HL),d8", "SCF",
+        "JR C,r8", "ADD HL,SP", "LD A,(HL-)", "DEC SP", "INC A", "DEC A", "LD A,d8", "CCF"
+    };
+    // nullptr for opcodes the CPU doesn't have
+    const std::array<const char*, 0x40> OPCODES_HI = {
+        "RET NZ", "POP BC", "JP NZ,a16", "JP a16", "CALL NZ,a16", "PUSH BC", "ADD A,d8", "RST $00",
+        "RET Z", "RET", "JP Z,a16", nullptr, "CALL Z,a16", "CALL a16", "ADC A,d8", "RST $08",
+        "RET NC", "POP DE", "JP NC,a16", nullptr, "CALL NC,a16", "PUSH DE", "SUB d8", "RST $10",
+        "RET C", "RETI", "JP C,a16", nullptr, "CALL C,a16", nullptr, "SBC A,d8", "RST $18",
+        "LDH (a8),A", "POP HL", "LD (C),A", nullptr, nullptr, "PUSH HL", "AND d8", "RST $20",
+        "ADD SP,r8", "JP (HL)", "LD (a16),A", nullptr, nullptr, nullptr, "XOR d8", "RST $28",
+        "LDH A,(a8)", "POP AF", "LD A,(C)", "DI", nullptr, "PUSH AF", "OR d8", "RST $30",
+        "LD HL,SP+r8", "LD SP,HL", "LD A,(a16)", "EI", nullptr, nullptr, "CP d8", "RST $38"
+    };
+    // the operand encoded in the low 3 bits of the register to register opcodes
+    const std::array<const char*, 8> REGISTERS = {"B", "C", "D", "E", "H", "L", "(HL)", "A"};
+    const std::array<const char*, 8> ALU = {"ADD A,", "ADC A,", "SUB ", "SBC A,", "AND ", "XOR ", "OR ", "CP "};
+    const std::array<const char*, 8> ROTATES = {"RLC", "RRC", "RL", "RR", "SLA", "SRA", "SWAP", "SRL"};
+    const std::array<const char*, 3> BITS = {"BIT", "RES", "SET"};
+
+    const char* opcode_template(uint8_t opcode)
+    {
+        if (opcode < 0x40)
+        {
+            return OPCODES_LO[opcode];
+        }
+        if (opcode >= 0xC0)
+        {
+            return OPCODES_HI[opcode - 0xC0];
+        }
+        return nullptr;
+    }
+
+    std::string prefixed(uint8_t opcode)
+    {
+        const char* reg = REGISTERS[opcode & 0x07];
+        char text[16];
+        if (opcode < 0x40)
+        {
+            snprintf(text, sizeof(text), "%s %s", ROTATES[opcode >> 3], reg);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%s %d,%s", BITS[(opcode >> 6) - 1], (opcode >> 3) & 0x07, reg);
+        }
+        return text;
+    }
+}
+
+uint8_t GAMEBOY::instruction_length(uint8_t opcode)
+{
+    // STOP is followed by a byte it ignores
+    if (opcode == 0xCB || opcode == 0x10)
+    {
+        return 2;
+    }
+    const char* text = opcode_template(opcode);
+    if (text == nullptr)
+    {
+        return 1;
+    }
+    if (strstr(text, "16"))
+    {
+        return 3;
+    }
+    if (strstr(text, "d8") || strstr(text, "a8") || strstr(text, "r8"))
+    {
+        return 2;
+    }
+    return 1;
+}
+
+std::string GAMEBOY::disassemble(uint16_t pc, uint8_t opcode, uint8_t op0, uint8_t op1)
+{
+    char operand[16];
+    if (opcode >= 0x40 && opcode < 0xC0)
+    {
+        const char* src = REGISTERS[opcode & 0x07];
+        if (opcode == 0x76)
+        {
+            return "HALT";
+        }
+        if (opcode < 0x80)
+        {
+            snprintf(operand, sizeof(operand), "LD %s,%s", REGISTERS[(opcode >> 3) & 0x07], src);
+            return operand;
+        }
+        return std::string(ALU[(opcode >> 3) & 0x07]) + src;
+    }
+    if (opcode == 0xCB)
+    {
+        return prefixed(op0);
+    }
+    const char* text = opcode_template(opcode);
+    if (text == nullptr)
+    {
+        snprintf(operand, sizeof(operand), "DB $%02X", opcode);
+        return operand;
+    }
+    std::string result = text;
+    size_t token;
+    size_t length = 0;
+    int8_t offset = static_cast<int8_t>(op0);
+    if ((token = result.find("16")) != std::string::npos)
+    {
+        token--;
+        length = 3;
+        snprintf(operand, sizeof(operand), "$%04X", op1 << 8 | op0);
+    }
+    else if ((token = result.find("d8")) != std::string::npos)
+    {
+        length = 2;
+        snprintf(operand, sizeof(operand), "$%02X", op0);
+    }
+    else if ((token = result.find("a8")) != std::string::npos)
+    {
+        length = 2;
+        snprintf(operand, sizeof(operand), "$FF%02X", op0);
+    }
+    else if ((token = result.find("r8")) != std::string::npos)
+    {
+        length = 2;
+        if (result.compare(0, 2, "JR") == 0)
+        {
+            snprintf(operand, sizeof(operand), "$%04X", static_cast<uint16_t>(pc + 2 + offset));
+        }
+        else if (result[token - 1] == '+')
+        {
+            // SP+r8 shows SP-2 rather than SP+-2
+            token--;
+            length = 3;
+            snprintf(operand, sizeof(operand), "%+d", offset);
+        }
+        else
+        {
+            snprintf(operand, sizeof(operand), "%d", offset);
+        }
+    }
+    if (length != 0)
+    {
+        result.replace(token, length, operand);
+    }
+    return result;
+}
@@ -16,7 +16,7 @@ GAMEBOY::InstructionResult GAMEBOY::STOP::tick()
     if (step == 0)
     {
         ++*registers.PC;
-        memory.write(GAMEBOY::IOHandler::TIMER_REG_DIV, 0);
+        memory.timer().stop();
         step++;
     }
     return InstructionResult::STOP;
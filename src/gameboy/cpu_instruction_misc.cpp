@@ -14,6 +14,7 @@ GAMEBOY::InstructionResult GAMEBOY::CB_PREFIX::tick()
     {
         uint8_t opcode = memory.read(++*registers.PC);
         instruction = decode_opcode_prefix(opcode, registers, memory);
+        GBEMU_STAT(memory.stats().cb_opcodes[opcode]++);
         return InstructionResult::RUNNING;
     }
     else
@@ -0,0 +1,38 @@
+#include <fstream>
+#include <iterator>
+
+#include "gameboy/file.h"
+
+GAMEBOY::FileInterface& GAMEBOY::FileInterface::standard()
+{
+    static StdFileInterface files;
+    return files;
+}
+
+std::optional<std::vector<uint8_t>> GAMEBOY::StdFileInterface::read(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return {};
+    }
+    std::vector<uint8_t> data(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    if (file.bad())
+    {
+        return {};
+    }
+    return data;
+}
+
+bool GAMEBOY::StdFileInterface::write(const std::string& path, const std::vector<uint8_t>& data)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return file.good();
+}
@@ -1,16 +1,284 @@
 #include "gameboy/gameboy.h"
+#include "gameboy/state.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const std::array<uint8_t, 4> STATE_MAGIC = {'G', 'B', 'S', 'T'};
+    // https://gbdev.io/pandocs/The_Cartridge_Header.html#014e-014f--global-checksum
+    const size_t GLOBAL_CHECKSUM = 0x014E;
+}
+
+GAMEBOY::Gameboy::Gameboy(ROMDATA& rom, InputHandler& input_handler)
+: memory(rom, input_handler), cpu(memory), ppu(memory), dma(memory)
+{
+    m_rom_checksum = rom.size() > GLOBAL_CHECKSUM + 1
+        ? (rom[GLOBAL_CHECKSUM] << 8) | rom[GLOBAL_CHECKSUM + 1]
+        : 0;
+}
+
+GAMEBOY::Gameboy::Gameboy(Gameboy& parent, InputHandler& input_handler)
+: memory(parent.memory, input_handler), cpu(memory), ppu(memory), dma(memory),
+  m_rom_checksum(parent.m_rom_checksum)
+{
+}
 
 bool GAMEBOY::Gameboy::tick()
 {
-    bool drawn_to_buffer = false;
+    uint64_t frame_count = ppu.frame_count();
     cpu.tick();
-    for (uint8_t i=0; i<4; i++)
+    memory.scheduler().advance(4);
+    return ppu.frame_count() != frame_count;
+}
+
+/**
+ * @brief Jump the clock forward while nothing can happen, stopping
+ * short of the M-cycle the next event is due or the end of the run
+ */
+void GAMEBOY::Gameboy::m_skip_halt(uint64_t end)
+{
+    Scheduler& scheduler = memory.scheduler();
+    uint64_t limit = std::min(scheduler.next_due(), end);
+    uint64_t now = scheduler.now();
+    if (limit > now + 4)
     {
-        if (ppu.tick())
+        uint64_t skipped = ((limit - now - 1)/4)*4;
+        GBEMU_STAT(memory.stats().halt_mcycles += skipped/4);
+        scheduler.advance(skipped);
+    }
+}
+
+GAMEBOY::RunResult GAMEBOY::Gameboy::m_run(uint64_t max_cycles, uint32_t event_mask, bool stop_on_frame)
+{
+    Scheduler& scheduler = memory.scheduler();
+    uint64_t start = scheduler.now();
+    uint64_t end = max_cycles > Scheduler::NEVER - start ? Scheduler::NEVER : start + max_cycles;
+    uint64_t frame_count = ppu.frame_count();
+    scheduler.pop_dispatched();
+    while (scheduler.now() < end)
+    {
+        if (cpu.halted())
+        {
+            m_skip_halt(end);
+        }
+        cpu.tick();
+        // the CPU runs unchecked until an event is due
+        if (!scheduler.advance(4))
+        {
+            continue;
+        }
+        if (stop_on_frame && ppu.frame_count() != frame_count)
+        {
+            return {RunResult::STOP_REASON::FRAME, scheduler.now() - start};
+        }
+        if (scheduler.pop_dispatched() & event_mask)
         {
-            drawn_to_buffer = true;
+            return {RunResult::STOP_REASON::EVENT, scheduler.now() - start};
         }
     }
-    dma.tick();
-    return drawn_to_buffer;
+    return {RunResult::STOP_REASON::CYCLES, scheduler.now() - start};
+}
+
+GAMEBOY::RunResult GAMEBOY::Gameboy::run_frame(uint64_t max_cycles)
+{
+    return m_run(max_cycles, 0, true);
+}
+
+GAMEBOY::RunResult GAMEBOY::Gameboy::run_cycles(uint64_t cycles)
+{
+    return m_run(cycles, 0, false);
+}
+
+GAMEBOY::RunResult GAMEBOY::Gameboy::run_until_event(uint32_t event_mask, uint64_t max_cycles)
+{
+    return m_run(max_cycles, event_mask, false);
+}
+
+uint64_t GAMEBOY::Gameboy::cycles()
+{
+    return memory.scheduler().now();
+}
+
+const GAMEBOY::FRAME_PIXELS& GAMEBOY::Gameboy::frame()
+{
+    return ppu.framebuffer().front();
+}
+
+uint64_t GAMEBOY::Gameboy::frame_sequence()
+{
+    return ppu.framebuffer().sequence();
+}
+
+void GAMEBOY::Gameboy::on_frame_ready(PPU_Framebuffer::FRAME_READY_CALLBACK callback)
+{
+    ppu.framebuffer().on_frame_ready(callback);
+}
+
+void GAMEBOY::Gameboy::on_serial_out(IOHandler::SERIAL_OUT_CALLBACK callback)
+{
+    memory.on_serial_out(callback);
+}
+
+GAMEBOY::Stats GAMEBOY::Gameboy::stats()
+{
+    // the render thread counts the tile & sprite caches
+    ppu.render_sync();
+    Stats stats = memory.stats();
+    stats.mcycles = memory.scheduler().now()/4;
+    return stats;
+}
+
+GAMEBOY::APU& GAMEBOY::Gameboy::apu()
+{
+    return memory.apu();
+}
+
+GAMEBOY::PPU_FrameSkip& GAMEBOY::Gameboy::frameskip()
+{
+    return ppu.frameskip();
+}
+
+bool GAMEBOY::Gameboy::render_thread()
+{
+    return ppu.render_thread();
+}
+
+void GAMEBOY::Gameboy::render_thread(bool enabled)
+{
+    ppu.render_thread(enabled);
+}
+
+GAMEBOY::TraceRecorder* GAMEBOY::Gameboy::tracer()
+{
+    return memory.tracer();
+}
+
+void GAMEBOY::Gameboy::tracer(TraceRecorder* tracer)
+{
+    memory.tracer(tracer);
+}
+
+void GAMEBOY::Gameboy::on_breakpoint(Cpu::BREAKPOINT_CALLBACK callback)
+{
+    cpu.on_breakpoint(callback);
+}
+
+uint8_t GAMEBOY::Gameboy::peek(uint16_t addr)
+{
+    return memory.peek(addr);
+}
+
+GAMEBOY::PPU_Framebuffer& GAMEBOY::Gameboy::framebuffer()
+{
+    return ppu.framebuffer();
+}
+
+uint16_t GAMEBOY::Gameboy::rom_checksum()
+{
+    return m_rom_checksum;
+}
+
+void GAMEBOY::Gameboy::m_finish_instruction()
+{
+    Scheduler& scheduler = memory.scheduler();
+    while (!cpu.instruction_boundary())
+    {
+        cpu.tick();
+        scheduler.advance(4);
+    }
+}
+
+void GAMEBOY::Gameboy::save_state(std::vector<uint8_t>& out)
+{
+    Scheduler& scheduler = memory.scheduler();
+    m_finish_instruction();
+    out.clear();
+    StateWriter state(out);
+    state.write(STATE_MAGIC);
+    state.write(STATE_VERSION);
+    state.write(m_rom_checksum);
+    scheduler.save_state(state);
+    cpu.save_state(state);
+    memory.save_state(state);
+    ppu.save_state(state);
+    dma.save_state(state);
+}
+
+std::vector<uint8_t> GAMEBOY::Gameboy::save_state()
+{
+    std::vector<uint8_t> out;
+    save_state(out);
+    return out;
+}
+
+void GAMEBOY::Gameboy::load_state(const std::vector<uint8_t>& in)
+{
+    // loaded into a scratch machine sharing this one's memory first,
+    // so a state which fails part way through changes nothing here
+    {
+        InputHandler scratch_input_handler;
+        Gameboy scratch(*this, scratch_input_handler);
+        scratch.m_load_state(in);
+    }
+    m_load_state(in);
+}
+
+void GAMEBOY::Gameboy::m_load_state(const std::vector<uint8_t>& in)
+{
+    StateReader state(in);
+    std::array<uint8_t, 4> magic;
+    state.read(magic);
+    if (magic != STATE_MAGIC)
+    {
+        throw std::invalid_argument("Not a save state");
+    }
+    if (state.read<uint16_t>() != STATE_VERSION)
+    {
+        throw std::invalid_argument("Unsupported save state version");
+    }
+    if (state.read<uint16_t>() != m_rom_checksum)
+    {
+        throw std::invalid_argument("Save state is for a different ROM");
+    }
+    memory.scheduler().load_state(state);
+    cpu.load_state(state);
+    memory.load_state(state);
+    ppu.load_state(state);
+    dma.load_state(state);
+    if (!state.done())
+    {
+        throw std::invalid_argument("Unexpected data after save state");
+    }
+}
+
+std::unique_ptr<GAMEBOY::Gameboy> GAMEBOY::Gameboy::fork(InputHandler& input_handler)
+{
+    m_finish_instruction();
+    std::unique_ptr<Gameboy> child(new Gameboy(*this, input_handler));
+    // memory is shared by the dispatcher, the rest is small enough to copy
+    std::vector<uint8_t> buffer;
+    StateWriter writer(buffer);
+    memory.scheduler().save_state(writer);
+    cpu.save_state(writer);
+    memory.save_registers(writer);
+    ppu.save_state(writer);
+    dma.save_state(writer);
+    StateReader reader(buffer);
+    child->memory.scheduler().load_state(reader);
+    child->cpu.load_state(reader);
+    child->memory.load_registers(reader);
+    child->ppu.load_state(reader);
+    child->dma.load_state(reader);
+    return child;
+}
+
+std::vector<uint8_t> GAMEBOY::Gameboy::save_battery(int64_t host_time)
+{
+    return memory.save_battery(host_time);
+}
+
+void GAMEBOY::Gameboy::load_battery(const std::vector<uint8_t>& in, int64_t host_time)
+{
+    memory.load_battery(in, host_time);
 }
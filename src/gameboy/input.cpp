@@ -1,4 +1,5 @@
 #include "gameboy/input.h"
+#include "gameboy/state.h"
 
 uint8_t GAMEBOY::InputHandler::joyp(bool btn_sel, bool dpad_sel)
 {
@@ -91,3 +92,17 @@ void GAMEBOY::InputHandler::set_irq(uint8_t state)
 {
     m_input_irq = state & 0x10;
 }
+
+void GAMEBOY::InputHandler::save_state(StateWriter& state) const
+{
+    state.write(m_dpad_state);
+    state.write(m_btn_state);
+    state.write(m_input_irq);
+}
+
+void GAMEBOY::InputHandler::load_state(StateReader& state)
+{
+    m_dpad_state = state.read<uint8_t>();
+    m_btn_state = state.read<uint8_t>();
+    m_input_irq = state.read<bool>();
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gameboy/log.h"
+
+std::atomic<GAMEBOY::LOG_LEVEL> GAMEBOY::log_runtime_level(GAMEBOY::LOG_LEVEL::INFO);
+
+namespace
+{
+    GAMEBOY::LOG_SINK g_log_sink;
+
+    void default_sink(GAMEBOY::LOG_LEVEL level, const char* message)
+    {
+        size_t length = strlen(message);
+        bool newline = length > 0 && message[length - 1] == '\n';
+        fprintf(stderr, "%s: %s%s", GAMEBOY::log_level_name(level), message, newline ? "" : "\n");
+    }
+
+    void emit(GAMEBOY::LOG_LEVEL level, const char* message)
+    {
+        if (g_log_sink)
+        {
+            g_log_sink(level, message);
+        }
+        else
+        {
+            default_sink(level, message);
+        }
+    }
+}
+
+void GAMEBOY::log_sink(LOG_SINK sink)
+{
+    g_log_sink = sink;
+}
+
+void GAMEBOY::log_level(LOG_LEVEL level)
+{
+    log_runtime_level = level;
+}
+
+GAMEBOY::LOG_LEVEL GAMEBOY::log_level()
+{
+    return log_runtime_level;
+}
+
+const char* GAMEBOY::log_level_name(LOG_LEVEL level)
+{
+    switch (level)
+    {
+        case LOG_LEVEL::DEBUG:
+            return "DEBUG";
+        case LOG_LEVEL::INFO:
+            return "INFO";
+        case LOG_LEVEL::WARN:
+            return "WARN";
+        case LOG_LEVEL::ERROR:
+            return "ERROR";
+        case LOG_LEVEL::CRITICAL:
+            return "CRITICAL";
+        default:
+            return "";
+    }
+}
+
+void GAMEBOY::log(LOG_LEVEL level, const char* format, ...)
+{
+    if (!log_enabled(level))
+    {
+        return;
+    }
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    emit(level, message);
+}
+
+GAMEBOY::LogLimiter::LogLimiter(uint32_t max_per_window, std::chrono::steady_clock::duration window)
+: m_max_per_window(max_per_window), m_window(window)
+{
+    m_window_start = std::chrono::steady_clock::now();
+}
+
+void GAMEBOY::LogLimiter::m_flush()
+{
+    char message[128];
+    if (m_repeats > 0)
+    {
+        snprintf(message, sizeof(message), "Previous message repeated %u times\n", m_repeats);
+        emit(m_last_level, message);
+        m_repeats = 0;
+    }
+    if (m_suppressed > 0)
+    {
+        snprintf(message, sizeof(message), "Suppressed %u messages\n", m_suppressed);
+        emit(m_last_level, message);
+        m_suppressed = 0;
+    }
+}
+
+void GAMEBOY::LogLimiter::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_flush();
+}
+
+void GAMEBOY::LogLimiter::log(LOG_LEVEL level, const char* format, ...)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_window_start >= m_window)
+    {
+        m_flush();
+        m_window_start = now;
+        m_window_count = 0;
+    }
+    if (m_window_count >= m_max_per_window)
+    {
+        // over budget, not even formatted
+        ++m_suppressed;
+        return;
+    }
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (level == m_last_level && m_last == message)
+    {
+        ++m_repeats;
+        return;
+    }
+    m_flush();
+    ++m_window_count;
+    m_last_level = level;
+    m_last = message;
+    emit(level, message);
+}
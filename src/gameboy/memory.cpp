@@ -1,62 +1,35 @@
 #include <stdexcept>
 
+#include "gameboy/log.h"
 #include "gameboy/memory.h"
-#include "gameboy/memory_static.h"
-#include "gameboy/memory_mbc1.h"
-#include "gameboy/memory_mbc3.h"
 #include "gameboy/cpu_interrupt.h"
+#include "gameboy/state.h"
+#include "gameboy/trace.h"
 
-GAMEBOY::CartMapper* GAMEBOY::CartMapper::create_mapper(ROMDATA& rom)
-{
-    uint8_t mapper_type = rom[CART_TYPE];
-    bool cartRam = false;
-    bool cartBattery = false;
-    bool cartTimer = false;
-    switch (mapper_type)
-    {
-    case 0x00:
-        return new MapperStatic(rom);
-    case 0x03:
-        cartBattery = true;
-        [[fallthrough]];
-    case 0x02:
-        cartRam = true;
-        [[fallthrough]];
-    case 0x01:
-        return new MapperMbc1(rom, cartRam, cartBattery);
-    case 0x10:
-        cartRam = true;
-        [[fallthrough]];
-    case 0x0F:
-        cartTimer = true;
-        cartBattery = true;
-        [[fallthrough]];
-    case 0x11:
-        return new GAMEBOY::MapperMbc3(rom, cartRam, cartBattery, cartTimer);
-    case 0x13:
-        cartBattery = true;
-        [[fallthrough]];
-    case 0x12:
-        cartRam = true;
-        return new GAMEBOY::MapperMbc3(rom, cartRam, cartBattery, cartTimer);
-    default:
-        SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Unsupported mapper type: %d\n", mapper_type);
-        throw std::logic_error("Unsupported mapped type");
+uint8_t GAMEBOY::AddressDispatcher::read(uint16_t addr, MemoryAccessSource src)
+{
+    uint8_t data = m_read(addr, src);
+    if (m_trace_accesses)
+    {
+        m_tracer->access(TraceKind::READ, m_scheduler.now(), addr, data);
     }
+    return data;
 }
 
-uint8_t GAMEBOY::AddressDispatcher::read(uint16_t addr, MemoryAccessSource src)
+uint8_t GAMEBOY::AddressDispatcher::m_read(uint16_t addr, MemoryAccessSource src)
 {
     if (addr >= CART_ROM_LO && addr <= CART_ROM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::CART_ROM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return 0xFF;
         }
-        return cartMapper->read(addr);
+        return cartridge.read_rom(addr);
     }
     else if (addr >= VRAM_LO && addr <= VRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::VRAM, src));
         if (vramLocked && src!=MemoryAccessSource::PPU)
         {
             return 0xFF; // return garbage
@@ -65,26 +38,29 @@ uint8_t GAMEBOY::AddressDispatcher::read(uint16_t addr, MemoryAccessSource src)
         {
             return 0xFF;
         }
-        return videoRam[addr - VRAM_LO];
+        return videoRam->read(addr - VRAM_LO);
     }
     else if (addr >= CART_RAM_LO && addr <= CART_RAM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::CART_RAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return 0xFF;
         }
-        return cartMapper->read(addr);
+        return cartridge.read_ram(addr);
     }
     else if (addr >= WRAM_LO && addr <= WRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::WRAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return 0xFF;
         }
-        return workRam[addr - WRAM_LO];
+        return workRam.read(addr - WRAM_LO);
     }
     else if (addr >= OAM_LO && addr <= OAM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::OAM, src));
         if (dmaLocked && src !=MemoryAccessSource::DMA)
         {
             return 0xFF;
@@ -93,60 +69,81 @@ uint8_t GAMEBOY::AddressDispatcher::read(uint16_t addr, MemoryAccessSource src)
         {
             return 0xFF; // return garbage
         }
-        return oam[addr - OAM_LO];
+        return oam.read(addr - OAM_LO);
     }
     else if (addr >= IO_REG_LO && addr <= IO_REG_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::IO, src));
         return ioHandler.read(addr, src);
     }
     else if (addr >= HRAM_LO && addr <= HRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::HRAM, src));
         return highRam[addr - HRAM_LO];
     }
     else if (addr == INTERRUPT_ENABLE)
     {
+        GBEMU_STAT(m_stats.count_read(Stats::REGION::IO, src));
         return ioHandler.read(addr, src);
     }
+    GBEMU_STAT(m_stats.count_read(Stats::REGION::UNMAPPED, src));
     return 0x00;
 }
 
 void GAMEBOY::AddressDispatcher::write(uint16_t addr, uint8_t data, MemoryAccessSource src)
 {
+    if (m_trace_accesses)
+    {
+        m_tracer->access(TraceKind::WRITE, m_scheduler.now(), addr, data);
+    }
     if (addr >= CART_ROM_LO && addr <= CART_ROM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::CART_ROM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return;
         }
-        cartMapper->write(addr, data);
+        cartridge.write(addr, data);
     }
     else if (addr >= VRAM_LO && addr <= VRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::VRAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return; // ignore write
         }
+        if (m_render_write_hook)
+        {
+            m_render_write_hook(addr, data);
+        }
         vramModified = true;
-        videoRam[addr - VRAM_LO] = data;
+        if (videoRam.use_count() > 1)
+        {
+            videoRam = std::make_shared<VRAM_DATA>(*videoRam);
+        }
+        videoRam->write(addr - VRAM_LO, data);
     }
     else if (addr >= CART_RAM_LO && addr <= CART_RAM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::CART_RAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return;
         }
-        cartMapper->write(addr, data);
+        cartridge.write(addr, data);
     }
     else if (addr >= WRAM_LO && addr <= WRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::WRAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return;
         }
-        workRam[addr - WRAM_LO] = data;
+        workRam.write(addr - WRAM_LO, data);
     }
     else if (addr >= OAM_LO && addr <= OAM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::OAM, src));
         if (dmaLocked && src!=MemoryAccessSource::DMA)
         {
             return;
@@ -155,26 +152,79 @@ void GAMEBOY::AddressDispatcher::write(uint16_t addr, uint8_t data, MemoryAccess
         {
             return; // ignore write
         }
-        oam[addr - OAM_LO] = data;
+        oam.write(addr - OAM_LO, data);
     }
     else if (addr >= IO_REG_LO && addr <= IO_REG_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::IO, src));
+        if (src==MemoryAccessSource::CPU && IOHandler::is_render_register(addr)
+            && m_render_write_hook)
+        {
+            m_render_write_hook(addr, data);
+        }
         ioHandler.write(addr, data, src);
     }
     else if (addr >= HRAM_LO && addr <= HRAM_HI)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::HRAM, src));
         highRam[addr - HRAM_LO] = data;
     }
     else if (addr == INTERRUPT_ENABLE)
     {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::IO, src));
         ioHandler.write(addr, data, src);
     }
+    else
+    {
+        GBEMU_STAT(m_stats.count_write(Stats::REGION::UNMAPPED, src));
+    }
+}
+
+uint8_t GAMEBOY::AddressDispatcher::peek(uint16_t addr)
+{
+    if (addr >= CART_ROM_LO && addr <= CART_ROM_HI)
+    {
+        return cartridge.read_rom(addr);
+    }
+    else if (addr >= CART_RAM_LO && addr <= CART_RAM_HI)
+    {
+        return cartridge.read_ram(addr);
+    }
+    else if (addr >= VRAM_LO && addr <= VRAM_HI)
+    {
+        return videoRam->read(addr - VRAM_LO);
+    }
+    else if (addr >= WRAM_LO && addr <= WRAM_HI)
+    {
+        return workRam.read(addr - WRAM_LO);
+    }
+    else if (addr >= OAM_LO && addr <= OAM_HI)
+    {
+        return oam.read(addr - OAM_LO);
+    }
+    else if (addr >= HRAM_LO && addr <= HRAM_HI)
+    {
+        return highRam[addr - HRAM_LO];
+    }
+    else if (addr == INTERRUPT_ENABLE)
+    {
+        return ioHandler.read(addr, MemoryAccessSource::CPU);
+    }
+    // reading some IO registers changes them
+    return 0xFF;
 }
 
 GAMEBOY::AddressDispatcher::AddressDispatcher(ROMDATA& rom, InputHandler& input_handler)
-: ioHandler(input_handler)
+: cartridge(rom, m_scheduler), ioHandler(input_handler, m_scheduler)
+{
+}
+
+GAMEBOY::AddressDispatcher::AddressDispatcher(const AddressDispatcher& parent, InputHandler& input_handler)
+: cartridge(parent.cartridge, m_scheduler), ioHandler(input_handler, m_scheduler),
+  videoRam(parent.videoRam), workRam(parent.workRam), oam(parent.oam)
 {
-    cartMapper = CartMapper::create_mapper(rom);
+    // the child's PPU starts with empty tile & sprite caches
+    vramModified = true;
 }
 
 void GAMEBOY::AddressDispatcher::lock(GAMEBOY::AddressDispatcher::LOCKABLE target)
@@ -212,11 +262,6 @@ void GAMEBOY::AddressDispatcher::unlock(GAMEBOY::AddressDispatcher::LOCKABLE tar
     }
 }
 
-bool GAMEBOY::AddressDispatcher::vram_poll_modified()
-{
-    return vramModified;
-}
-
 bool GAMEBOY::AddressDispatcher::vram_pop_modified()
 {
     if (vramModified)
@@ -226,3 +271,58 @@ bool GAMEBOY::AddressDispatcher::vram_pop_modified()
     }
     return false;
 }
+
+void GAMEBOY::AddressDispatcher::on_render_write(RENDER_WRITE_HOOK hook)
+{
+    m_render_write_hook = hook;
+}
+
+void GAMEBOY::AddressDispatcher::on_serial_out(IOHandler::SERIAL_OUT_CALLBACK callback)
+{
+    ioHandler.on_serial_out(callback);
+}
+
+const GAMEBOY::PALETTE_LUT& GAMEBOY::AddressDispatcher::palette(IOHandler::PALETTE palette)
+{
+    return ioHandler.palette(palette);
+}
+
+void GAMEBOY::AddressDispatcher::save_state(StateWriter& state) const
+{
+    videoRam->save_state(state);
+    workRam.save_state(state);
+    oam.save_state(state);
+    save_registers(state);
+    cartridge.save_state(state);
+}
+
+void GAMEBOY::AddressDispatcher::load_state(StateReader& state)
+{
+    // snapshots still being drawn from keep the old contents
+    videoRam = std::make_shared<VRAM_DATA>();
+    videoRam->load_state(state);
+    workRam.load_state(state);
+    oam.load_state(state);
+    load_registers(state);
+    cartridge.load_state(state);
+    // tiles & sprites cached from the old VRAM are rebuilt
+    vramModified = true;
+}
+
+void GAMEBOY::AddressDispatcher::save_registers(StateWriter& state) const
+{
+    state.write(highRam);
+    state.write(vramLocked);
+    state.write(oamLocked);
+    state.write(dmaLocked);
+    ioHandler.save_state(state);
+}
+
+void GAMEBOY::AddressDispatcher::load_registers(StateReader& state)
+{
+    state.read(highRam);
+    vramLocked = state.read<bool>();
+    oamLocked = state.read<bool>();
+    dmaLocked = state.read<bool>();
+    ioHandler.load_state(state);
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "gameboy/log.h"
+#include "gameboy/memory_banked.h"
+#include "gameboy/scheduler.h"
+#include "gameboy/state.h"
+
+GAMEBOY::BankedMapper::BankedMapper(ROMDATA& rom, size_t ram_banks, bool battery, uint16_t ram_mask, uint8_t ram_fill)
+: m_ram(ram_banks), m_battery(battery), m_ram_mask(ram_mask), m_ram_fill(ram_fill)
+{
+    // at least both halves of the ROM area, and never less than the file
+    m_rom_banks = std::max<size_t>(2, (rom.size() + CART_ROM_BANK_SIZE - 1) / CART_ROM_BANK_SIZE);
+    if (rom.size() > ROM_SIZE && rom[ROM_SIZE] <= 0x08)
+    {
+        m_rom_banks = std::max<size_t>(m_rom_banks, num_rom_banks(rom));
+    }
+    auto image = std::make_shared<std::vector<uint8_t>>(m_rom_banks * CART_ROM_BANK_SIZE, 0x00);
+    std::copy(rom.cbegin(), rom.cend(), image->begin());
+    m_rom = image;
+}
+
+uint64_t GAMEBOY::BankedMapper::m_now() const
+{
+    return m_scheduler != nullptr ? m_scheduler->now() : 0;
+}
+
+void GAMEBOY::BankedMapper::m_map_rom(uint16_t lo_bank, uint16_t hi_bank)
+{
+    m_rom_map = {static_cast<uint16_t>(lo_bank % m_rom_banks), static_cast<uint16_t>(hi_bank % m_rom_banks)};
+}
+
+void GAMEBOY::BankedMapper::m_map_ram(uint8_t bank)
+{
+    if (m_ram.empty())
+    {
+        m_unmap_ram();
+        return;
+    }
+    m_ram_mapped = true;
+    m_ram_map = bank % m_ram.size();
+}
+
+void GAMEBOY::BankedMapper::m_unmap_ram()
+{
+    m_ram_mapped = false;
+}
+
+uint8_t GAMEBOY::BankedMapper::read([[maybe_unused]] uint16_t addr) const
+{
+    GBEMU_LOG_WARN_LIMITED("Attempted to read from ram while disabled\n");
+    return 0xFF;
+}
+
+GAMEBOY::CartBanks GAMEBOY::BankedMapper::banks()
+{
+    CartBanks banks;
+    banks.rom = {
+        m_rom->data() + m_rom_map[0] * CART_ROM_BANK_SIZE,
+        m_rom->data() + m_rom_map[1] * CART_ROM_BANK_SIZE
+    };
+    banks.ram = m_ram_mapped ? &m_ram[m_ram_map] : nullptr;
+    banks.ram_mask = m_ram_mask;
+    banks.ram_fill = m_ram_fill;
+    return banks;
+}
+
+void GAMEBOY::BankedMapper::save_state(StateWriter& state) const
+{
+    state.write(m_rom_map[0]);
+    state.write(m_rom_map[1]);
+    state.write(m_ram_mapped);
+    state.write(m_ram_map);
+    for (const CART_RAM_BANK& bank : m_ram)
+    {
+        bank.save_state(state);
+    }
+}
+
+void GAMEBOY::BankedMapper::load_state(StateReader& state)
+{
+    m_rom_map[0] = state.read<uint16_t>();
+    m_rom_map[1] = state.read<uint16_t>();
+    m_ram_mapped = state.read<bool>();
+    m_ram_map = state.read<uint8_t>();
+    for (CART_RAM_BANK& bank : m_ram)
+    {
+        bank.load_state(state);
+    }
+    // a state from another cartridge mustn't map past the end
+    m_map_rom(m_rom_map[0], m_rom_map[1]);
+    if (m_ram_mapped)
+    {
+        m_map_ram(m_ram_map);
+    }
+}
+
+void GAMEBOY::BankedMapper::save_battery(StateWriter& state, [[maybe_unused]] int64_t host_time) const
+{
+    if (!m_battery)
+    {
+        return;
+    }
+    // only the bytes the RAM has, MBC2's 512 rather than the whole window
+    size_t size = std::min<size_t>(m_ram_mask + 1, CART_RAM_HI - CART_RAM_LO + 1);
+    for (const CART_RAM_BANK& bank : m_ram)
+    {
+        for (size_t i=0; i<size; i++)
+        {
+            state.write(bank.read(i));
+        }
+    }
+}
+
+void GAMEBOY::BankedMapper::load_battery(StateReader& state, [[maybe_unused]] int64_t host_time)
+{
+    if (!m_battery)
+    {
+        return;
+    }
+    size_t size = std::min<size_t>(m_ram_mask + 1, CART_RAM_HI - CART_RAM_LO + 1);
+    for (CART_RAM_BANK& bank : m_ram)
+    {
+        for (size_t i=0; i<size; i++)
+        {
+            bank.write(i, state.read<uint8_t>());
+        }
+    }
+}
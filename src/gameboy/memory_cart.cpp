@@ -0,0 +1,129 @@
+#include <stdexcept>
+
+#include "gameboy/log.h"
+#include "gameboy/memory_cart.h"
+#include "gameboy/state.h"
+
+GAMEBOY::Cartridge::MAPPER GAMEBOY::Cartridge::m_create_mapper(ROMDATA& rom)
+{
+    uint8_t mapper_type = rom[CART_TYPE];
+    bool cartRam = false;
+    bool cartBattery = false;
+    bool cartTimer = false;
+    switch (mapper_type)
+    {
+    case 0x09:
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x00:
+    case 0x08:
+        return MapperStatic(rom, cartBattery);
+    case 0x03:
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x02:
+        cartRam = true;
+        [[fallthrough]];
+    case 0x01:
+        return MapperMbc1(rom, cartRam, cartBattery);
+    case 0x06:
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x05:
+        return MapperMbc2(rom, cartBattery);
+    case 0x10:
+        cartRam = true;
+        [[fallthrough]];
+    case 0x0F:
+        cartTimer = true;
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x11:
+        return MapperMbc3(rom, cartRam, cartBattery, cartTimer);
+    case 0x13:
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x12:
+        cartRam = true;
+        return MapperMbc3(rom, cartRam, cartBattery, cartTimer);
+    case 0x1B:
+    case 0x1E:
+        cartBattery = true;
+        [[fallthrough]];
+    case 0x1A:
+    case 0x1D:
+        cartRam = true;
+        [[fallthrough]];
+    case 0x19:
+    case 0x1C:
+        return MapperMbc5(rom, cartRam, cartBattery);
+    default:
+        GBEMU_LOG_CRITICAL("Unsupported mapper type: %d\n", mapper_type);
+        throw std::logic_error("Unsupported mapped type");
+    }
+}
+
+GAMEBOY::Cartridge::Cartridge(ROMDATA& rom, const Scheduler& scheduler)
+: m_mapper(m_create_mapper(rom))
+{
+    std::visit([&scheduler](auto& mapper) { mapper.clock(scheduler); }, m_mapper);
+    m_refresh();
+}
+
+GAMEBOY::Cartridge::Cartridge(const Cartridge& other, const Scheduler& scheduler)
+: m_mapper(other.m_mapper)
+{
+    std::visit([&scheduler](auto& mapper) { mapper.clock(scheduler); }, m_mapper);
+    // the banks point into the other cartridge's RAM
+    m_refresh();
+}
+
+void GAMEBOY::Cartridge::m_refresh()
+{
+    m_banks = std::visit([](auto& mapper) { return mapper.banks(); }, m_mapper);
+}
+
+uint16_t GAMEBOY::Cartridge::rom_bank() const
+{
+    return std::visit([](const auto& mapper) { return mapper.rom_bank(); }, m_mapper);
+}
+
+void GAMEBOY::Cartridge::save_state(StateWriter& state) const
+{
+    std::visit([&state](const auto& mapper) { mapper.save_state(state); }, m_mapper);
+}
+
+void GAMEBOY::Cartridge::load_state(StateReader& state)
+{
+    std::visit([&state](auto& mapper) { mapper.load_state(state); }, m_mapper);
+    m_refresh();
+}
+
+std::vector<uint8_t> GAMEBOY::Cartridge::save_battery(int64_t host_time) const
+{
+    std::vector<uint8_t> out;
+    StateWriter state(out);
+    std::visit([&state, host_time](const auto& mapper) { mapper.save_battery(state, host_time); }, m_mapper);
+    return out;
+}
+
+void GAMEBOY::Cartridge::load_battery(const std::vector<uint8_t>& in, int64_t host_time)
+{
+    // loaded into a copy, which only shares the RAM, so a bad save changes nothing
+    MAPPER loaded = m_mapper;
+    StateReader state(in);
+    try
+    {
+        std::visit([&state, host_time](auto& mapper) { mapper.load_battery(state, host_time); }, loaded);
+    }
+    catch (const std::out_of_range&)
+    {
+        throw std::invalid_argument("Battery save is too small for the cartridge");
+    }
+    if (!state.done())
+    {
+        throw std::invalid_argument("Battery save is too large for the cartridge");
+    }
+    m_mapper = loaded;
+    m_refresh();
+}
@@ -1,8 +1,17 @@
 #include "gameboy/memory.h"
 #include "gameboy/memory_dma.h"
 #include "gameboy/memory_io.h"
+#include "gameboy/state.h"
 
-void GAMEBOY::DmaController::tick()
+GAMEBOY::DmaController::DmaController(AddressDispatcher& memory)
+: memory(memory)
+{
+    memory.scheduler().handler(EventType::DMA_STEP, [this](uint64_t time) {
+        m_step(time);
+    });
+}
+
+void GAMEBOY::DmaController::m_step(uint64_t time)
 {
     if (step==0)
     {
@@ -10,8 +19,10 @@ void GAMEBOY::DmaController::tick()
         if (dma_addr != 0)
         {
             m_dma_addr = dma_addr;
+            GBEMU_STAT(memory.stats().dma_transfers++);
             memory.lock(AddressDispatcher::LOCKABLE::ALL_DMA);
             step++;
+            memory.scheduler().schedule(EventType::DMA_STEP, time + 4);
         }
     }
     else
@@ -29,5 +40,18 @@ void GAMEBOY::DmaController::tick()
         uint8_t data = memory.read(src_addr, MemoryAccessSource::DMA);
         memory.write(dest_addr, data, MemoryAccessSource::DMA);
         step++;
+        memory.scheduler().schedule(EventType::DMA_STEP, time + 4);
     }
 }
+
+void GAMEBOY::DmaController::save_state(StateWriter& state) const
+{
+    state.write(step);
+    state.write(m_dma_addr);
+}
+
+void GAMEBOY::DmaController::load_state(StateReader& state)
+{
+    step = state.read<uint8_t>();
+    m_dma_addr = state.read<uint8_t>();
+}
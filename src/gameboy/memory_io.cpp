@@ -1,15 +1,53 @@
 #include "gameboy/memory.h"
 #include "gameboy/cpu_interrupt.h"
 #include "gameboy/serial.h"
+#include "gameboy/state.h"
 #include "gameboy/timer.h"
 
-GAMEBOY::IOHandler::IOHandler(InputHandler& input_handler)
-: m_input_handler(input_handler)
+GAMEBOY::IOHandler::IOHandler(InputHandler& input_handler, Scheduler& scheduler)
+: m_input_handler(input_handler), m_scheduler(scheduler), m_timer(scheduler, *this),
+  m_apu(scheduler)
 {
     ioRam[0x0F] = 0xE1;
     ioRam[0x40] = 0x91;
     ioRam[0x41] = 0x85;
     ioRam[0x47] = 0xFC;
+    m_palette_update(PALETTE::BGP, ioRam[PPU_REG_BGP - 0xFF00]);
+    m_palette_update(PALETTE::OBP0, ioRam[PPU_REG_OBP0 - 0xFF00]);
+    m_palette_update(PALETTE::OBP1, ioRam[PPU_REG_OBP1 - 0xFF00]);
+    m_scheduler.handler(EventType::SERIAL_TRANSFER, [this](uint64_t) {
+        m_serial_event();
+    });
+}
+
+void GAMEBOY::IOHandler::m_serial_event()
+{
+    uint8_t data = ioRam[SERIAL_DATA - 0xFF00];
+    if (m_serial_out)
+    {
+        m_serial_out(data);
+    }
+    GAMEBOY::SerialEventSupervisor& events = GAMEBOY::SerialEventSupervisor::getInstance();
+    events.publish(GAMEBOY::SerialEventType::SERIAL_OUT, data);
+    // no link partner, so all bits shifted in are 1
+    ioRam[SERIAL_DATA - 0xFF00] = 0xFF;
+    ioRam[SERIAL_CONTROL - 0xFF00] &= 0x7F;
+    request_interrupt(0x08);
+}
+
+void GAMEBOY::IOHandler::request_interrupt(uint8_t mask)
+{
+    ioRam[INTERRUPT_REG_IF - 0xFF00] |= mask;
+}
+
+void GAMEBOY::IOHandler::on_serial_out(SERIAL_OUT_CALLBACK callback)
+{
+    m_serial_out = callback;
+}
+
+void GAMEBOY::IOHandler::m_palette_update(PALETTE palette, uint8_t data)
+{
+    m_palette_luts[static_cast<size_t>(palette)] = decode_palette(data);
 }
 
 uint8_t GAMEBOY::IOHandler::read(uint16_t addr, MemoryAccessSource src)
@@ -21,13 +59,13 @@ uint8_t GAMEBOY::IOHandler::read(uint16_t addr, MemoryAccessSource src)
                     ~ioRam[0] & 0x20,
                     ~ioRam[0] & 0x10);
         case TIMER_REG_DIV:
-            return Timer::getInstance().read(Timer::Register::DIV);
+            return m_timer.read(Timer::Register::DIV);
         case TIMER_REG_TIMA:
-            return Timer::getInstance().read(Timer::Register::TIMA);
+            return m_timer.read(Timer::Register::TIMA);
         case TIMER_REG_TMA:
-            return Timer::getInstance().read(Timer::Register::TMA);
+            return m_timer.read(Timer::Register::TMA);
         case TIMER_REG_TAC:
-            return Timer::getInstance().read(Timer::Register::TAC);
+            return m_timer.read(Timer::Register::TAC);
         case INTERRUPT_REG_IF:
         {
             uint8_t joyp_irq = m_input_handler.poll_irq();
@@ -43,6 +81,10 @@ uint8_t GAMEBOY::IOHandler::read(uint16_t addr, MemoryAccessSource src)
         case 0xFFFF:
             return IE;
         default:
+            if (addr >= APU::REG_LO && addr <= APU::REG_HI)
+            {
+                return m_apu.read(addr);
+            }
             if (addr < 0xFF00 || addr > 0xFF80)
             {
                 return 0xFF;
@@ -56,27 +98,28 @@ void GAMEBOY::IOHandler::write(uint16_t addr, uint8_t data, MemoryAccessSource s
     switch (addr)
     {
         case SERIAL_CONTROL:
-            if (data&0x80)
+            if ((data&0x80) && !m_scheduler.pending(EventType::SERIAL_TRANSFER))
             {
-                // TODO: delay output, trigger interrupt, collect input (very low priority)
-                // begin transfer
-                GAMEBOY::SerialEventSupervisor& events = GAMEBOY::SerialEventSupervisor::getInstance();
-                events.publish(GAMEBOY::SerialEventType::SERIAL_OUT, ioRam[SERIAL_DATA - 0xFF00]);
-                data &= 0x7F;
+                // begin transfer, bit 7 stays set until it completes
+                m_scheduler.schedule_in(EventType::SERIAL_TRANSFER, m_SERIAL_TRANSFER_CYCLES);
+            }
+            else if (!(data&0x80))
+            {
+                m_scheduler.cancel(EventType::SERIAL_TRANSFER);
             }
             ioRam[SERIAL_CONTROL - 0xFF00] = data;
             break;
         case TIMER_REG_DIV:
-            Timer::getInstance().write(Timer::Register::DIV, data);
+            m_timer.write(Timer::Register::DIV, data);
             break;
         case TIMER_REG_TIMA:
-            Timer::getInstance().write(Timer::Register::TIMA, data);
+            m_timer.write(Timer::Register::TIMA, data);
             break;
         case TIMER_REG_TMA:
-            Timer::getInstance().write(Timer::Register::TMA, data);
+            m_timer.write(Timer::Register::TMA, data);
             break;
         case TIMER_REG_TAC:
-            Timer::getInstance().write(Timer::Register::TAC, data);
+            m_timer.write(Timer::Register::TAC, data);
             break;
         case PPU_REG_LY:
             if (src==MemoryAccessSource::PPU)
@@ -108,17 +151,67 @@ void GAMEBOY::IOHandler::write(uint16_t addr, uint8_t data, MemoryAccessSource s
         // explicitly define writable addresses
         case INPUT_JOYP:
         case SERIAL_DATA:
-        case PPU_REG_LCDC:
         case PPU_REG_SCY:
         case PPU_REG_SCX:
         case PPU_REG_LYC:
+        case PPU_REG_WY:
+        case PPU_REG_WX:
+            ioRam[addr - 0xFF00] = data;
+            break;
+        case PPU_REG_LCDC:
+            if ((ioRam[addr - 0xFF00] ^ data) & 0x80)
+            {
+                // PPU switches on/off from this cycle
+                m_scheduler.schedule(EventType::PPU_LCD_TOGGLE, m_scheduler.now());
+            }
+            ioRam[addr - 0xFF00] = data;
+            break;
         case PPU_REG_DMA:
+            if (src==MemoryAccessSource::CPU && !m_scheduler.pending(EventType::DMA_STEP))
+            {
+                // transfer starts at the end of this M-cycle
+                m_scheduler.schedule_in(EventType::DMA_STEP, 4);
+            }
+            ioRam[addr - 0xFF00] = data;
+            break;
         case PPU_REG_BGP:
+            m_palette_update(PALETTE::BGP, data);
+            ioRam[addr - 0xFF00] = data;
+            break;
         case PPU_REG_OBP0:
+            m_palette_update(PALETTE::OBP0, data);
+            ioRam[addr - 0xFF00] = data;
+            break;
         case PPU_REG_OBP1:
+            m_palette_update(PALETTE::OBP1, data);
             ioRam[addr - 0xFF00] = data;
             break;
         default:
+            if (addr >= APU::REG_LO && addr <= APU::REG_HI)
+            {
+                m_apu.write(addr, data);
+            }
             break;
     }
 }
+
+void GAMEBOY::IOHandler::save_state(StateWriter& state) const
+{
+    state.write_bytes(ioRam, sizeof(ioRam));
+    state.write(IE);
+    m_timer.save_state(state);
+    m_apu.save_state(state);
+    m_input_handler.save_state(state);
+}
+
+void GAMEBOY::IOHandler::load_state(StateReader& state)
+{
+    state.read_bytes(ioRam, sizeof(ioRam));
+    IE = state.read<uint8_t>();
+    m_timer.load_state(state);
+    m_apu.load_state(state);
+    m_input_handler.load_state(state);
+    m_palette_update(PALETTE::BGP, ioRam[PPU_REG_BGP - 0xFF00]);
+    m_palette_update(PALETTE::OBP0, ioRam[PPU_REG_OBP0 - 0xFF00]);
+    m_palette_update(PALETTE::OBP1, ioRam[PPU_REG_OBP1 - 0xFF00]);
+}
@@ -1,91 +1,68 @@
-#include <math.h>
-
+#include "gameboy/log.h"
 #include "gameboy/memory_mbc1.h"
+#include "gameboy/state.h"
 
 GAMEBOY::MapperMbc1::MapperMbc1(ROMDATA& rom, bool cartRam, bool cartBattery)
-    : banked_rom(num_rom_banks(rom))
-    , banked_ram(num_ram_banks(rom))
+    : BankedMapper(rom, cartRam ? num_ram_banks(rom) : 0, cartBattery)
 {
-    auto src_it = rom.cbegin();
-    auto src_end = rom.cend();
-    // Fill fixed bank
-    auto dest_it = fixed_rom.begin();
-    auto dest_end = fixed_rom.end();
-    while (src_it != src_end && dest_it != dest_end) // while neither end reached
-    {
-        *dest_it = *src_it;
-        src_it++;
-        dest_it++;
-    }
-    // Fill each banked rom
-    int banks = banked_rom.size();
-    for (int i=1; i<banks; i++)
-    {
-        dest_it = banked_rom[i-1].begin();
-        dest_end = banked_rom[i-1].end();
-        while (src_it != src_end && dest_it != dest_end) // while neither end reached
-        {
-            *dest_it = *src_it;
-            src_it++;
-            dest_it++;
-        }
-    }
+    m_update();
 }
 
-uint8_t GAMEBOY::MapperMbc1::read(uint16_t addr)
+void GAMEBOY::MapperMbc1::m_update()
 {
-    if (addr < BANK_LO) // lower fixed bank
-    {
-        return fixed_rom[addr];
-    }
-    else if (addr >= BANK_LO && addr <= BANK_HI)
+    uint16_t upper = ram_bank_select << 5;
+    m_map_rom(bank_mode ? upper : 0, upper | rom_bank_select);
+    if (ram_enabled)
     {
-        uint16_t index = rom_bank_select - 1;
-        if (rom_bank_select == 0) index = 0;
-        return banked_rom[index][addr - BANK_LO];
+        m_map_ram(bank_mode ? ram_bank_select : 0);
     }
-    else if (addr >= CART_RAM_LO && addr <= CART_RAM_HI)
+    else
     {
-        if (!ram_enabled)
-        {
-            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Attempted to read from ram while disabled\n");
-            return 0x00;
-        }
-        return banked_ram[ram_bank_select][addr - CART_RAM_LO];
+        m_unmap_ram();
     }
-    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Attempted to read memory address not mapped by cart %#04hx\n", addr);
-    return 0x00;
 }
 
 void GAMEBOY::MapperMbc1::write(uint16_t addr, uint8_t data)
 {
     if (addr <= REG_RAM_ENABLE_HI)
     {
-        ram_enabled = (data & 0x0A) == 0x0A;
+        ram_enabled = (data & 0x0F) == 0x0A;
     }
-    else if (addr >= REG_ROM_BANK_LO && addr <= REG_ROM_BANK_HI)
+    else if (addr <= REG_ROM_BANK_HI)
     {
-        uint8_t selection = data & 0x1F;
-        if (selection == 0) {selection = 1;}
-        rom_bank_select = selection;
-        // TODO: Limit selection to required number of banks
+        rom_bank_select = data & 0x1F;
+        if (rom_bank_select == 0) {rom_bank_select = 1;}
     }
-    else if (addr >= REG_RAM_BANK_LO && addr <= REG_RAM_BANK_HI)
+    else if (addr <= REG_RAM_BANK_HI)
     {
         ram_bank_select = data & 0x03;
     }
-    else if (addr >= REG_BANK_MODE_LO && addr <= REG_BANK_MODE_HI)
+    else if (addr <= REG_BANK_MODE_HI)
     {
-        SDL_LogWarn(SDL_LOG_CATEGORY_ERROR, "Bank mode selection not implemented\n");
+        bank_mode = data & 0x01;
     }
-    else if (addr >= CART_RAM_LO && addr <= CART_RAM_HI)
+    else
     {
-        if (!ram_enabled)
-        {
-            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Attempted to write to ram while disabled\n");
-            return;
-        }
-        banked_ram[ram_bank_select][addr - CART_RAM_LO] = data;
+        GBEMU_LOG_WARN_LIMITED("Attempted to write to ram while disabled\n");
+        return;
     }
-    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Attemted to write memory address not mapped by cart %#04hx\n", addr);
+    m_update();
+}
+
+void GAMEBOY::MapperMbc1::save_state(StateWriter& state) const
+{
+    BankedMapper::save_state(state);
+    state.write(ram_enabled);
+    state.write(rom_bank_select);
+    state.write(ram_bank_select);
+    state.write(bank_mode);
+}
+
+void GAMEBOY::MapperMbc1::load_state(StateReader& state)
+{
+    BankedMapper::load_state(state);
+    ram_enabled = state.read<bool>();
+    rom_bank_select = state.read<uint8_t>();
+    ram_bank_select = state.read<uint8_t>();
+    bank_mode = state.read<bool>();
 }
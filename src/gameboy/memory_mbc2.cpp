@@ -0,0 +1,57 @@
+#include "gameboy/memory_mbc2.h"
+#include "gameboy/state.h"
+
+GAMEBOY::MapperMbc2::MapperMbc2(ROMDATA& rom, bool cartBattery)
+    : BankedMapper(rom, 1, cartBattery, RAM_MASK, 0xF0)
+{
+    m_update();
+}
+
+void GAMEBOY::MapperMbc2::m_update()
+{
+    m_map_rom(0, m_sel_rom_bank);
+    if (m_ram_enable)
+    {
+        m_map_ram(0);
+    }
+    else
+    {
+        m_unmap_ram();
+    }
+}
+
+void GAMEBOY::MapperMbc2::write(uint16_t addr, uint8_t data)
+{
+    if (addr > 0x3FFF)
+    {
+        return;
+    }
+    // bit 8 of the address picks the register
+    if (addr & 0x0100)
+    {
+        m_sel_rom_bank = data & 0x0F;
+        if (m_sel_rom_bank == 0)
+        {
+            m_sel_rom_bank = 1;
+        }
+    }
+    else
+    {
+        m_ram_enable = 0x0A == (data & 0x0F);
+    }
+    m_update();
+}
+
+void GAMEBOY::MapperMbc2::save_state(StateWriter& state) const
+{
+    BankedMapper::save_state(state);
+    state.write(m_ram_enable);
+    state.write(m_sel_rom_bank);
+}
+
+void GAMEBOY::MapperMbc2::load_state(StateReader& state)
+{
+    BankedMapper::load_state(state);
+    m_ram_enable = state.read<bool>();
+    m_sel_rom_bank = state.read<uint8_t>();
+}
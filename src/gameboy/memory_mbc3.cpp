@@ -1,99 +1,32 @@
 #include "gameboy/memory_mbc3.h"
+#include "gameboy/state.h"
 
-GAMEBOY::MapperMbc3::MapperMbc3(ROMDATA& rom, bool cartRam, [[maybe_unused]] bool cartBattery, [[maybe_unused]] bool cartTimer)
+GAMEBOY::MapperMbc3::MapperMbc3(ROMDATA& rom, bool cartRam, bool cartBattery, bool cartTimer)
+    : BankedMapper(rom, cartRam ? num_ram_banks(rom) : 0, cartBattery), m_timer(cartTimer)
 {
-    uint8_t ram_bank_count = 0;
-    uint8_t rom_bank_count = 2;
-    if (cartRam)
-    {
-        // detect amount of ram
-        uint8_t ram_size_index = rom[0x0149];
-        switch (ram_size_index)
-        {
-            case 0x00:
-                ram_bank_count = 0;
-                break;
-            case 0x02:
-                ram_bank_count = 1;
-                break;
-            case 0x03:
-                ram_bank_count = 4;
-                break;
-            case 0x04:
-                ram_bank_count = 16;
-                break;
-            case 0x05:
-                ram_bank_count = 8;
-                break;
-            default:
-                // invalid
-                ram_bank_count = 0;
-        }
-    }
-    uint8_t rom_size_index = rom[0x0148];
-    switch (rom_size_index)
-    {
-        case 0x00:
-            rom_bank_count = 2;
-            break;
-        case 0x01:
-            rom_bank_count = 4;
-            break;
-        case 0x02:
-            rom_bank_count = 8;
-            break;
-        case 0x03:
-            rom_bank_count = 16;
-            break;
-        case 0x04:
-            rom_bank_count = 32;
-            break;
-        case 0x05:
-            rom_bank_count = 64;
-            break;
-        case 0x06:
-            rom_bank_count = 128;
-            break;
-    }
-    m_rambanks = std::vector<std::array<uint8_t, 0x2000>>(ram_bank_count);
-    m_rombanks = std::vector<std::array<uint8_t, 0x4000>>(rom_bank_count);
-    // init rom banks
-    auto src_it = rom.cbegin();
-    auto src_end = rom.cend();
-    for (uint8_t i=0; i<m_rombanks.size(); i++)
-    {
-        auto& rom_bank = m_rombanks[i];
-        auto dest_it = rom_bank.begin();
-        auto dest_end = rom_bank.end();
-        while (src_it != src_end && dest_it != dest_end) // while neither end reached
-        {
-            *dest_it = *src_it;
-            src_it++;
-            dest_it++;
-        }
-    }
+    m_update();
 }
 
-uint8_t GAMEBOY::MapperMbc3::read(uint16_t addr)
+void GAMEBOY::MapperMbc3::m_update()
 {
-    if (addr <= 0x3FFF)
+    m_map_rom(0, m_sel_rom_bank);
+    if (m_ram_enable && m_sel_ram_bank <= 0x03)
     {
-        // ROM bank 0
-        auto rom_bank = m_rombanks[0];
-        return rom_bank[addr];
+        m_map_ram(m_sel_ram_bank);
     }
-    else if (addr >= 0x4000 && addr <= 0x7FFF)
+    else
     {
-        // Selected ROM bank
-        auto rom_bank = m_rombanks[m_sel_rom_bank];
-        return rom_bank[addr - 0x4000];
+        m_unmap_ram();
     }
-    else if (m_ram_enable && addr >= 0xA000 && addr <= 0xBFFF)
+}
+
+uint8_t GAMEBOY::MapperMbc3::read(uint16_t addr) const
+{
+    if (m_timer && m_ram_enable && m_sel_ram_bank >= RealTimeClock::SECONDS)
     {
-        auto ram_bank = m_rambanks[m_sel_ram_bank];
-        return ram_bank[addr - 0xA000];
+        return m_rtc.read(m_sel_ram_bank);
     }
-    return 0;
+    return BankedMapper::read(addr);
 }
 
 void GAMEBOY::MapperMbc3::write(uint16_t addr, uint8_t data)
@@ -108,8 +41,7 @@ void GAMEBOY::MapperMbc3::write(uint16_t addr, uint8_t data)
     else if (addr >= 0x2000 && addr <= 0x3FFF)
     {
         // ROM bank select
-        uint8_t rom_bank_max = m_rombanks.size();
-        m_sel_rom_bank = data % rom_bank_max;
+        m_sel_rom_bank = data & 0x7F;
         if (m_sel_rom_bank == 0)
         {
             m_sel_rom_bank = 1;
@@ -118,21 +50,62 @@ void GAMEBOY::MapperMbc3::write(uint16_t addr, uint8_t data)
     else if (addr >= 0x4000 && addr <= 0x5FFF)
     {
         // RAM bank select (or RTC select)
-        if (data <= 0x03)
+        if (data <= 0x03 || (data >= 0x08 && data <= 0x0C))
         {
-            // RAM bank select
-            uint8_t ram_bank_max = m_rambanks.size();
-            m_sel_ram_bank = data % ram_bank_max;
+            m_sel_ram_bank = data;
         }
-        else if (data >= 0x08 && data <= 0x0C)
+    }
+    else if (addr >= 0x6000 && addr <= 0x7FFF)
+    {
+        // RTC latch
+        m_rtc.latch(data, m_now());
+        return;
+    }
+    else
+    {
+        // RTC registers
+        if (m_timer && m_ram_enable && m_sel_ram_bank >= RealTimeClock::SECONDS)
         {
-            // RTC select
-            // TODO
+            m_rtc.write(m_sel_ram_bank, data, m_now());
         }
+        return;
     }
-    else if (m_ram_enable && addr >= 0xA000 && addr <= 0xBFFF)
+    m_update();
+}
+
+void GAMEBOY::MapperMbc3::save_state(StateWriter& state) const
+{
+    BankedMapper::save_state(state);
+    state.write(m_ram_enable);
+    state.write(m_sel_rom_bank);
+    state.write(m_sel_ram_bank);
+    m_rtc.save_state(state);
+}
+
+void GAMEBOY::MapperMbc3::load_state(StateReader& state)
+{
+    BankedMapper::load_state(state);
+    m_ram_enable = state.read<bool>();
+    m_sel_rom_bank = state.read<uint8_t>();
+    m_sel_ram_bank = state.read<uint8_t>();
+    m_rtc.load_state(state);
+}
+
+void GAMEBOY::MapperMbc3::save_battery(StateWriter& state, int64_t host_time) const
+{
+    BankedMapper::save_battery(state, host_time);
+    if (m_timer)
+    {
+        m_rtc.save_battery(state, m_now(), host_time);
+    }
+}
+
+void GAMEBOY::MapperMbc3::load_battery(StateReader& state, int64_t host_time)
+{
+    BankedMapper::load_battery(state, host_time);
+    // saves from emulators without a clock leave it running from zero
+    if (m_timer && !state.done())
     {
-        auto ram_bank = m_rambanks[m_sel_ram_bank];
-        ram_bank[addr - 0xA000] = data;
+        m_rtc.load_battery(state, m_now(), host_time);
     }
 }
@@ -0,0 +1,65 @@
+#include "gameboy/memory_mbc5.h"
+#include "gameboy/state.h"
+
+GAMEBOY::MapperMbc5::MapperMbc5(ROMDATA& rom, bool cartRam, bool cartBattery)
+    : BankedMapper(rom, cartRam ? num_ram_banks(rom) : 0, cartBattery)
+{
+    m_update();
+}
+
+void GAMEBOY::MapperMbc5::m_update()
+{
+    m_map_rom(0, m_sel_rom_bank);
+    if (m_ram_enable)
+    {
+        m_map_ram(m_sel_ram_bank);
+    }
+    else
+    {
+        m_unmap_ram();
+    }
+}
+
+void GAMEBOY::MapperMbc5::write(uint16_t addr, uint8_t data)
+{
+    if (addr <= 0x1FFF)
+    {
+        m_ram_enable = 0x0A == (data & 0x0F);
+    }
+    else if (addr <= 0x2FFF)
+    {
+        // lower 8 bits of the ROM bank
+        m_sel_rom_bank = (m_sel_rom_bank & 0x100) | data;
+    }
+    else if (addr <= 0x3FFF)
+    {
+        // 9th bit of the ROM bank
+        m_sel_rom_bank = (m_sel_rom_bank & 0xFF) | ((data & 0x01) << 8);
+    }
+    else if (addr <= 0x5FFF)
+    {
+        // bit 3 drives the motor on rumble carts
+        m_sel_ram_bank = data & 0x0F;
+    }
+    else
+    {
+        return;
+    }
+    m_update();
+}
+
+void GAMEBOY::MapperMbc5::save_state(StateWriter& state) const
+{
+    BankedMapper::save_state(state);
+    state.write(m_ram_enable);
+    state.write(m_sel_rom_bank);
+    state.write(m_sel_ram_bank);
+}
+
+void GAMEBOY::MapperMbc5::load_state(StateReader& state)
+{
+    BankedMapper::load_state(state);
+    m_ram_enable = state.read<bool>();
+    m_sel_rom_bank = state.read<uint16_t>();
+    m_sel_ram_bank = state.read<uint8_t>();
+}
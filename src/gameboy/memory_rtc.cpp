@@ -0,0 +1,134 @@
+#include "gameboy/memory_rtc.h"
+#include "gameboy/state.h"
+
+namespace
+{
+    // bits of each register which exist, the seconds first
+    const GAMEBOY::RealTimeClock::REGISTERS MASKS = {0x3F, 0x3F, 0x1F, 0xFF, 0xC1};
+    const uint8_t HALT = 0x40;
+    const uint8_t CARRY = 0x80;
+}
+
+uint64_t GAMEBOY::RealTimeClock::m_time(uint64_t cycle) const
+{
+    return m_halted ? m_base_time : m_base_time + (cycle - m_base_cycle);
+}
+
+void GAMEBOY::RealTimeClock::m_set(const REGISTERS& registers, uint64_t part_second, uint64_t cycle)
+{
+    uint64_t days = registers[3] | (registers[4] & 0x01) << 8;
+    uint64_t hours = days*24 + registers[2];
+    uint64_t minutes = hours*60 + registers[1];
+    uint64_t seconds = minutes*60 + registers[0];
+    m_base_time = seconds*CYCLES_PER_SECOND + part_second;
+    m_base_cycle = cycle;
+    m_halted = registers[4] & HALT;
+    m_carry = registers[4] & CARRY;
+}
+
+GAMEBOY::RealTimeClock::REGISTERS GAMEBOY::RealTimeClock::registers(uint64_t cycle) const
+{
+    uint64_t seconds = m_time(cycle) / CYCLES_PER_SECOND;
+    uint64_t days = seconds / 86400;
+    bool carry = m_carry || days > 0x1FF;
+    days &= 0x1FF;
+    REGISTERS registers;
+    registers[0] = seconds % 60;
+    registers[1] = seconds / 60 % 60;
+    registers[2] = seconds / 3600 % 24;
+    registers[3] = days & 0xFF;
+    registers[4] = (days >> 8) | (m_halted ? HALT : 0) | (carry ? CARRY : 0);
+    return registers;
+}
+
+void GAMEBOY::RealTimeClock::latch(uint8_t data, uint64_t cycle)
+{
+    if (m_latch_write == 0x00 && data == 0x01)
+    {
+        m_latched = registers(cycle);
+    }
+    m_latch_write = data;
+}
+
+uint8_t GAMEBOY::RealTimeClock::read(uint8_t reg) const
+{
+    if (reg < SECONDS || reg > DAY_HIGH)
+    {
+        return 0xFF;
+    }
+    return m_latched[reg - SECONDS];
+}
+
+void GAMEBOY::RealTimeClock::write(uint8_t reg, uint8_t data, uint64_t cycle)
+{
+    if (reg < SECONDS || reg > DAY_HIGH)
+    {
+        return;
+    }
+    REGISTERS current = registers(cycle);
+    uint64_t part_second = m_time(cycle) % CYCLES_PER_SECOND;
+    current[reg - SECONDS] = data & MASKS[reg - SECONDS];
+    // writing the seconds resets the divider counting them
+    m_set(current, reg == SECONDS ? 0 : part_second, cycle);
+}
+
+void GAMEBOY::RealTimeClock::advance(uint64_t seconds)
+{
+    if (!m_halted)
+    {
+        m_base_time += seconds*CYCLES_PER_SECOND;
+    }
+}
+
+void GAMEBOY::RealTimeClock::save_state(StateWriter& state) const
+{
+    state.write(m_base_time);
+    state.write(m_base_cycle);
+    state.write(m_halted);
+    state.write(m_carry);
+    state.write(m_latched);
+    state.write(m_latch_write);
+}
+
+void GAMEBOY::RealTimeClock::load_state(StateReader& state)
+{
+    m_base_time = state.read<uint64_t>();
+    m_base_cycle = state.read<uint64_t>();
+    m_halted = state.read<bool>();
+    m_carry = state.read<bool>();
+    state.read(m_latched);
+    m_latch_write = state.read<uint8_t>();
+}
+
+void GAMEBOY::RealTimeClock::save_battery(StateWriter& state, uint64_t cycle, int64_t host_time) const
+{
+    for (uint8_t reg : registers(cycle))
+    {
+        state.write<uint32_t>(reg);
+    }
+    for (uint8_t reg : m_latched)
+    {
+        state.write<uint32_t>(reg);
+    }
+    state.write<int64_t>(host_time);
+}
+
+void GAMEBOY::RealTimeClock::load_battery(StateReader& state, uint64_t cycle, int64_t host_time)
+{
+    REGISTERS current;
+    for (size_t i=0; i<current.size(); i++)
+    {
+        current[i] = state.read<uint32_t>() & MASKS[i];
+    }
+    for (size_t i=0; i<m_latched.size(); i++)
+    {
+        m_latched[i] = state.read<uint32_t>() & MASKS[i];
+    }
+    // some emulators only keep a 32 bit timestamp
+    int64_t saved = state.remaining() >= 8 ? state.read<int64_t>() : state.read<uint32_t>();
+    m_set(current, 0, cycle);
+    if (host_time > saved)
+    {
+        advance(host_time - saved);
+    }
+}
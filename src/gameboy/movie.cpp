@@ -0,0 +1,209 @@
+#include "gameboy/movie.h"
+#include "gameboy/state.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const std::array<uint8_t, 4> MOVIE_MAGIC = {'G', 'B', 'M', 'V'};
+    const uint8_t EVENT_PRESSED = 0x80;
+}
+
+void GAMEBOY::Movie::serialize(std::vector<uint8_t>& out) const
+{
+    out.clear();
+    StateWriter movie(out);
+    movie.write(MOVIE_MAGIC);
+    movie.write(VERSION);
+    movie.write(rom_checksum);
+    movie.write_varint(start_state.size());
+    movie.write_bytes(start_state.data(), start_state.size());
+    movie.write_varint(events.size());
+    uint64_t cycle = 0;
+    for (const Event& event : events)
+    {
+        movie.write_varint(event.cycle - cycle);
+        cycle = event.cycle;
+        movie.write<uint8_t>(static_cast<uint8_t>(event.button) | (event.pressed ? EVENT_PRESSED : 0));
+    }
+    movie.write_varint(frame_hashes.size());
+    for (uint64_t hash : frame_hashes)
+    {
+        movie.write(hash);
+    }
+}
+
+GAMEBOY::Movie GAMEBOY::Movie::deserialize(const std::vector<uint8_t>& in)
+{
+    Movie movie;
+    StateReader reader(in);
+    std::array<uint8_t, 4> magic;
+    reader.read(magic);
+    if (magic != MOVIE_MAGIC)
+    {
+        throw std::invalid_argument("Not a movie");
+    }
+    if (reader.read<uint16_t>() != VERSION)
+    {
+        throw std::invalid_argument("Unsupported movie version");
+    }
+    movie.rom_checksum = reader.read<uint16_t>();
+    uint64_t state_size = reader.read_varint();
+    if (state_size > reader.remaining())
+    {
+        throw std::out_of_range("Movie truncated");
+    }
+    movie.start_state.resize(state_size);
+    reader.read_bytes(movie.start_state.data(), state_size);
+    uint64_t event_count = reader.read_varint();
+    // each event takes at least 2 bytes
+    if (event_count > reader.remaining()/2)
+    {
+        throw std::out_of_range("Movie truncated");
+    }
+    movie.events.reserve(event_count);
+    uint64_t cycle = 0;
+    for (uint64_t i=0; i<event_count; i++)
+    {
+        cycle += reader.read_varint();
+        uint8_t data = reader.read<uint8_t>();
+        uint8_t button = data & ~EVENT_PRESSED;
+        if (button > static_cast<uint8_t>(InputHandler::BUTTON::SELECT))
+        {
+            throw std::invalid_argument("Movie has an invalid button");
+        }
+        movie.events.push_back({cycle, static_cast<InputHandler::BUTTON>(button), (data & EVENT_PRESSED) != 0});
+    }
+    uint64_t hash_count = reader.read_varint();
+    if (hash_count > reader.remaining()/8)
+    {
+        throw std::out_of_range("Movie truncated");
+    }
+    movie.frame_hashes.reserve(hash_count);
+    for (uint64_t i=0; i<hash_count; i++)
+    {
+        movie.frame_hashes.push_back(reader.read<uint64_t>());
+    }
+    return movie;
+}
+
+uint64_t GAMEBOY::Movie::frame_hash(const FRAME_PIXELS& frame)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint8_t shade : frame)
+    {
+        hash ^= shade;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+GAMEBOY::MovieRecorder::MovieRecorder(Gameboy& gameboy, InputHandler& input_handler, bool from_current_state)
+: m_gameboy(gameboy), m_input_handler(input_handler)
+{
+    m_movie.rom_checksum = gameboy.rom_checksum();
+    if (from_current_state)
+    {
+        gameboy.save_state(m_movie.start_state);
+    }
+}
+
+void GAMEBOY::MovieRecorder::button(InputHandler::BUTTON button, bool pressed)
+{
+    m_movie.events.push_back({m_gameboy.cycles(), button, pressed});
+    if (pressed)
+    {
+        m_input_handler.btn_down(button);
+    }
+    else
+    {
+        m_input_handler.btn_up(button);
+    }
+}
+
+void GAMEBOY::MovieRecorder::frame()
+{
+    m_movie.frame_hashes.push_back(Movie::frame_hash(m_gameboy.frame()));
+}
+
+const GAMEBOY::Movie& GAMEBOY::MovieRecorder::movie() const
+{
+    return m_movie;
+}
+
+GAMEBOY::MoviePlayer::MoviePlayer(Gameboy& gameboy, InputHandler& input_handler, Movie movie)
+: m_gameboy(gameboy), m_input_handler(input_handler), m_movie(std::move(movie))
+{
+    if (m_movie.rom_checksum != gameboy.rom_checksum())
+    {
+        throw std::invalid_argument("Movie is for a different ROM");
+    }
+    if (!m_movie.start_state.empty())
+    {
+        gameboy.load_state(m_movie.start_state);
+    }
+}
+
+void GAMEBOY::MoviePlayer::m_apply_due()
+{
+    while (m_next_event < m_movie.events.size() &&
+        m_movie.events[m_next_event].cycle <= m_gameboy.cycles())
+    {
+        const Movie::Event& event = m_movie.events[m_next_event++];
+        if (event.pressed)
+        {
+            m_input_handler.btn_down(event.button);
+        }
+        else
+        {
+            m_input_handler.btn_up(event.button);
+        }
+    }
+}
+
+GAMEBOY::RunResult GAMEBOY::MoviePlayer::run_frame()
+{
+    uint64_t start = m_gameboy.cycles();
+    m_apply_due();
+    while (true)
+    {
+        uint64_t run = m_gameboy.cycles() - start;
+        uint64_t max_cycles = FRAME_CYCLES - run;
+        if (m_next_event < m_movie.events.size())
+        {
+            uint64_t until_event = m_movie.events[m_next_event].cycle - m_gameboy.cycles();
+            max_cycles = std::min(max_cycles, until_event);
+        }
+        RunResult result = m_gameboy.run_frame(max_cycles);
+        result.cycles = m_gameboy.cycles() - start;
+        m_apply_due();
+        if (result.reason == RunResult::STOP_REASON::FRAME || result.cycles >= FRAME_CYCLES)
+        {
+            return result;
+        }
+    }
+}
+
+bool GAMEBOY::MoviePlayer::frame()
+{
+    if (m_next_hash >= m_movie.frame_hashes.size())
+    {
+        return true;
+    }
+    if (Movie::frame_hash(m_gameboy.frame()) != m_movie.frame_hashes[m_next_hash++])
+    {
+        m_desyncs++;
+        return false;
+    }
+    return true;
+}
+
+bool GAMEBOY::MoviePlayer::finished() const
+{
+    return m_next_event >= m_movie.events.size() && m_next_hash >= m_movie.frame_hashes.size();
+}
+
+uint64_t GAMEBOY::MoviePlayer::desyncs() const
+{
+    return m_desyncs;
+}
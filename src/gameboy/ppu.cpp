@@ -1,20 +1,40 @@
 #include "gameboy/ppu.h"
 #include "gameboy/cpu_interrupt.h"
+#include "gameboy/state.h"
+#include "gameboy/trace.h"
+#include <algorithm>
 #include <stdexcept>
 
-GAMEBOY::PPU::PPU(AddressDispatcher& memory, std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer)
-: memory(memory), tilemap(memory), spritemap(memory), m_line_buffer(line_buffer)
+GAMEBOY::PPU::PPU(AddressDispatcher& memory)
+: memory(memory), m_renderer(memory.stats())
 {
+    Scheduler& scheduler = memory.scheduler();
+    scheduler.handler(EventType::PPU_MODE, [this](uint64_t time) {
+        m_mode_event(time);
+    });
+    scheduler.handler(EventType::PPU_LCD_TOGGLE, [this](uint64_t time) {
+        m_lcd_toggle_event(time);
+    });
+    memory.on_render_write([this](uint16_t addr, uint8_t data) {
+        m_render_write(addr, data);
+    });
+    m_line_start = scheduler.now();
     transition(m_PPU_STATE::MODE2);
+    scheduler.schedule(EventType::PPU_MODE, m_line_start + m_MODE2_LEN);
+    // the LCD may already have been switched off
+    m_lcd_toggle_event(scheduler.now());
 }
 
-bool GAMEBOY::PPU::transition(m_PPU_STATE new_mode)
+void GAMEBOY::PPU::transition(m_PPU_STATE new_mode)
 {
-    bool drawn_to_buffer = false;
     switch (new_mode)
     {
         case m_PPU_STATE::MODE0:
         {
+            if (m_line_pending)
+            {
+                m_line_finish();
+            }
             memory.unlock(AddressDispatcher::LOCKABLE::OAM);
             memory.unlock(AddressDispatcher::LOCKABLE::VRAM);
             break;
@@ -25,29 +45,41 @@ bool GAMEBOY::PPU::transition(m_PPU_STATE new_mode)
             uint8_t interrupts = memory.read(INTERRUPT_FLAG);
             interrupts |= (uint8_t)InterruptType::VBLANK;
             memory.write(INTERRUPT_FLAG, interrupts);
+            // skipped frames leave the last drawn frame in the front buffer
+            if (m_draw_frame)
+            {
+                render_sync();
+                m_framebuffer.swap();
+            }
+            ++m_frame_count;
+            if (memory.tracer())
+            {
+                memory.tracer()->frame(m_line_start);
+            }
             break;
         }
         case m_PPU_STATE::MODE2:
         {
             memory.lock(AddressDispatcher::LOCKABLE::OAM);
+            if (m_dot_y == 0)
+            {
+                m_draw_frame = m_frameskip.next_frame();
+            }
             break;
         }
         case m_PPU_STATE::MODE3:
         {
             memory.lock(AddressDispatcher::LOCKABLE::VRAM);
-            // draw line
-            // background
-            uint8_t scy = memory.read(IOHandler::PPU_REG_SCY);
-            uint8_t scx = memory.read(IOHandler::PPU_REG_SCX);
-            uint8_t lcdc = memory.read(IOHandler::PPU_REG_LCDC);
-            // bit 3 low = MAP0, high = MAP1
-            auto map = lcdc & 0x08 ? PPU_Tilemap::MAP_SELECT::MAP1 : PPU_Tilemap::MAP_SELECT::MAP0;
-            auto bg = tilemap.render_line(map, scx, scy, m_dot_y);
-            *m_line_buffer = *bg;
-            // window
-            // sprites
-            spritemap.render_line(m_dot_y, m_line_buffer);
-            drawn_to_buffer = true;
+            if (!m_draw_frame)
+            {
+                break;
+            }
+            // record the line, it is drawn once mode 3 is over
+            GBEMU_STAT(memory.stats().lines_rendered++);
+            m_line.line = m_dot_y;
+            m_line.start = PPU_RenderState::capture(memory);
+            m_line.writes.clear();
+            m_line_pending = true;
             break;
         }
         default:
@@ -56,66 +88,174 @@ bool GAMEBOY::PPU::transition(m_PPU_STATE new_mode)
     m_state = new_mode;
     m_stat_line_update();
     memory.write(IOHandler::PPU_REG_STAT, stat(), MemoryAccessSource::PPU);
-    return drawn_to_buffer;
 }
 
-bool GAMEBOY::PPU::tick()
+void GAMEBOY::PPU::m_mode_event(uint64_t)
 {
-    bool ppu_enabled = memory.read(IOHandler::PPU_REG_LCDC) & 0x80;
-    if (!ppu_enabled)
-    {
-        m_dot_y = m_FRAME_LINES - 1;
-        m_state = m_PPU_STATE::MODE1;
-        memory.unlock(AddressDispatcher::LOCKABLE::OAM);
-        memory.unlock(AddressDispatcher::LOCKABLE::VRAM);
-        return false;
-    }
-    bool drawn_to_buffer = false;
+    Scheduler& scheduler = memory.scheduler();
     switch (m_state)
     {
         case m_PPU_STATE::MODE0:
-            if (++m_dot_x == m_LINE_LEN)
+            m_line_start += m_LINE_LEN;
+            if (++m_dot_y == m_DRAW_LINES)
+            {
+                transition(m_PPU_STATE::MODE1);
+                scheduler.schedule(EventType::PPU_MODE, m_line_start + m_LINE_LEN);
+            }
+            else
             {
-                m_dot_x = 0;
-                if (++m_dot_y == m_DRAW_LINES)
-                {
-                    transition(m_PPU_STATE::MODE1);
-                }
-                else
-                {
-                    transition(m_PPU_STATE::MODE2);
-                }
-                memory.write(IOHandler::PPU_REG_LY, m_dot_y, MemoryAccessSource::PPU);
+                transition(m_PPU_STATE::MODE2);
+                scheduler.schedule(EventType::PPU_MODE, m_line_start + m_MODE2_LEN);
             }
+            memory.write(IOHandler::PPU_REG_LY, m_dot_y, MemoryAccessSource::PPU);
             break;
         case m_PPU_STATE::MODE1:
-            if (++m_dot_x == m_LINE_LEN)
+            m_line_start += m_LINE_LEN;
+            if (++m_dot_y == m_FRAME_LINES)
             {
-                m_dot_x = 0;
-                if (++m_dot_y == m_FRAME_LINES)
-                {
-                    m_dot_y = 0;
-                    transition(m_PPU_STATE::MODE2);
-                }
-                memory.write(IOHandler::PPU_REG_LY, m_dot_y, MemoryAccessSource::PPU);
+                m_dot_y = 0;
+                transition(m_PPU_STATE::MODE2);
+                scheduler.schedule(EventType::PPU_MODE, m_line_start + m_MODE2_LEN);
             }
-            break;
-        case m_PPU_STATE::MODE2:
-            if (++m_dot_x == m_MODE2_LEN)
+            else
             {
-                drawn_to_buffer = transition(m_PPU_STATE::MODE3);
+                scheduler.schedule(EventType::PPU_MODE, m_line_start + m_LINE_LEN);
             }
+            memory.write(IOHandler::PPU_REG_LY, m_dot_y, MemoryAccessSource::PPU);
+            break;
+        case m_PPU_STATE::MODE2:
+            transition(m_PPU_STATE::MODE3);
+            scheduler.schedule(EventType::PPU_MODE, m_line_start + m_MODE2_LEN + m_MODE3_LEN);
             break;
         case m_PPU_STATE::MODE3:
-            if (++m_dot_x == m_MODE2_LEN+m_MODE3_LEN)
-            {
-                transition(m_PPU_STATE::MODE0);
-            }
+            transition(m_PPU_STATE::MODE0);
+            scheduler.schedule(EventType::PPU_MODE, m_line_start + m_LINE_LEN);
             break;
         default:
             throw std::invalid_argument("Non-existent PPU mode enabled, possible memory corruption");
     }
-    return drawn_to_buffer;
+}
+
+void GAMEBOY::PPU::m_lcd_toggle_event(uint64_t time)
+{
+    bool enabled = memory.read(IOHandler::PPU_REG_LCDC) & 0x80;
+    if (enabled == m_lcd_enabled)
+    {
+        return;
+    }
+    m_lcd_enabled = enabled;
+    Scheduler& scheduler = memory.scheduler();
+    if (!enabled)
+    {
+        // the line position is frozen until the LCD is switched back on
+        m_dot_x = std::min<uint64_t>(time - m_line_start, m_LINE_LEN - 1);
+        m_dot_y = m_FRAME_LINES - 1;
+        m_state = m_PPU_STATE::MODE1;
+        // the line being drawn is never output
+        m_line_pending = false;
+        m_line.start.vram.reset();
+        memory.unlock(AddressDispatcher::LOCKABLE::OAM);
+        memory.unlock(AddressDispatcher::LOCKABLE::VRAM);
+        scheduler.cancel(EventType::PPU_MODE);
+        return;
+    }
+    // resume the last line of VBlank from the dot it was switched off on
+    m_line_start = time - m_dot_x;
+    scheduler.schedule(EventType::PPU_MODE, m_line_start + m_LINE_LEN);
+}
+
+uint64_t GAMEBOY::PPU::frame_count()
+{
+    return m_frame_count;
+}
+
+GAMEBOY::PPU_Framebuffer& GAMEBOY::PPU::framebuffer()
+{
+    render_sync();
+    return m_framebuffer;
+}
+
+GAMEBOY::PPU_FrameSkip& GAMEBOY::PPU::frameskip()
+{
+    return m_frameskip;
+}
+
+/**
+ * @brief Called before the CPU modifies rendering state. During mode 3
+ * the write is recorded along with the pixels shifted out before it, the
+ * renderer then draws the line from that pixel on through the pixel FIFO
+ */
+void GAMEBOY::PPU::m_render_write(uint16_t addr, uint8_t data)
+{
+    if (!m_line_pending || !m_fifo_enabled)
+    {
+        return;
+    }
+    int mode3_dot = memory.scheduler().now() - m_line_start - m_MODE2_LEN;
+    int due_x = std::clamp(mode3_dot - m_MODE3_FETCH_DELAY, 0, (int)PPU_PixelFifo::SCREEN_SIZE_X);
+    if (m_line.writes.empty())
+    {
+        GBEMU_STAT(memory.stats().fifo_lines++);
+    }
+    m_line.writes.push_back({static_cast<uint8_t>(due_x), addr, data});
+}
+
+void GAMEBOY::PPU::m_line_finish()
+{
+    if (!m_line.writes.empty())
+    {
+        // sprites are drawn over the finished line as things are now
+        m_line.end_oam = memory.oam_data();
+        // left set, so the next line's capture() still clears the tile cache
+        m_line.end_vram_modified = memory.vram_modified();
+    }
+    m_line_pending = false;
+    if (m_worker)
+    {
+        m_worker->submit(std::move(m_line));
+        return;
+    }
+    m_framebuffer.write_line(m_line.line, m_renderer.render(m_line));
+    // holding on to the snapshot would make the next VRAM write copy it
+    m_line.start.vram.reset();
+}
+
+bool GAMEBOY::PPU::fifo_enabled()
+{
+    return m_fifo_enabled;
+}
+
+void GAMEBOY::PPU::fifo_enabled(bool enabled)
+{
+    m_fifo_enabled = enabled;
+}
+
+bool GAMEBOY::PPU::render_thread()
+{
+    return m_worker != nullptr;
+}
+
+void GAMEBOY::PPU::render_thread(bool enabled)
+{
+    if (enabled == render_thread())
+    {
+        return;
+    }
+    if (enabled)
+    {
+        m_worker = std::make_unique<PPU_RenderWorker>(m_renderer, m_framebuffer);
+        return;
+    }
+    render_sync();
+    m_worker.reset();
+}
+
+void GAMEBOY::PPU::render_sync()
+{
+    if (m_worker)
+    {
+        m_worker->wait();
+    }
 }
 
 uint8_t GAMEBOY::PPU::mode_no()
@@ -177,3 +317,61 @@ void GAMEBOY::PPU::m_stat_line_update()
         memory.write(INTERRUPT_FLAG, interrupts);
     }
 }
+
+void GAMEBOY::PPU::save_state(StateWriter& state) const
+{
+    if (m_worker)
+    {
+        m_worker->wait();
+    }
+    state.write(m_state);
+    state.write(m_line_start);
+    state.write(m_dot_x);
+    state.write(m_dot_y);
+    state.write(m_lcd_enabled);
+    state.write(m_frame_count);
+    state.write(m_int_sel_lyc);
+    state.write(m_int_sel_mode2);
+    state.write(m_int_sel_mode1);
+    state.write(m_int_sel_mode0);
+    state.write(m_stat_line);
+    state.write(m_draw_frame);
+    state.write(m_line_pending);
+    if (m_line_pending)
+    {
+        m_line.save_state(state, memory.vram_snapshot());
+    }
+    m_framebuffer.save_state(state);
+}
+
+void GAMEBOY::PPU::load_state(StateReader& state)
+{
+    render_sync();
+    m_state = state.read<m_PPU_STATE>();
+    if (m_state > m_PPU_STATE::MODE3)
+    {
+        throw std::invalid_argument("Save state has an invalid PPU mode");
+    }
+    m_line_start = state.read<uint64_t>();
+    m_dot_x = state.read<int>();
+    m_dot_y = state.read<int>();
+    m_lcd_enabled = state.read<bool>();
+    m_frame_count = state.read<uint64_t>();
+    m_int_sel_lyc = state.read<bool>();
+    m_int_sel_mode2 = state.read<bool>();
+    m_int_sel_mode1 = state.read<bool>();
+    m_int_sel_mode0 = state.read<bool>();
+    m_stat_line = state.read<bool>();
+    m_draw_frame = state.read<bool>();
+    m_line_pending = state.read<bool>();
+    if (m_line_pending)
+    {
+        // loaded after the dispatcher, so this is the VRAM from the state
+        m_line.load_state(state, memory.vram_snapshot());
+    }
+    else
+    {
+        m_line.start.vram.reset();
+    }
+    m_framebuffer.load_state(state);
+}
@@ -0,0 +1,62 @@
+#include "gameboy/ppu_fifo.h"
+#include "gameboy/memory_io.h"
+
+void GAMEBOY::PPU_PixelFifo::begin(uint8_t line, uint8_t fine_x, uint8_t start_x)
+{
+    m_line = line;
+    m_fine_x = fine_x & 0x07;
+    m_x = start_x;
+    m_queue_head = 0;
+    m_queue_size = 0;
+}
+
+void GAMEBOY::PPU_PixelFifo::fetch(const PPU_RenderState& state)
+{
+    uint8_t lcdc = state.lcdc;
+    uint8_t scx = state.scx;
+    uint8_t scy = state.scy;
+    // position of the next pixel relative to the first fetched tile
+    uint16_t fetch_x = m_x + m_fine_x;
+    uint8_t map_tile_x = ((scx >> 3) + (fetch_x >> 3)) & 0x1F;
+    uint8_t map_y = scy + m_line;
+    uint16_t map_start = lcdc & 0x08 ? 0x9C00 : 0x9800;
+    uint8_t tile_index = state.vram_read(map_start + (map_y/8)*32 + map_tile_x);
+    uint16_t tile_addr;
+    if (lcdc & 0x10)
+    {
+        tile_addr = VRAM_LO + static_cast<uint16_t>(tile_index)*16;
+    }
+    else
+    {
+        int8_t index_signed = static_cast<int8_t>(tile_index);
+        tile_addr = VRAM_LO + 0x1000 + static_cast<int16_t>(index_signed)*16;
+    }
+    tile_addr += (map_y % 8) * 2;
+    // same bitplane order as PPU_Tile, so both paths produce identical lines
+    uint8_t hi_byte = state.vram_read(tile_addr);
+    uint8_t lo_byte = state.vram_read(tile_addr + 1);
+    // when starting part way through a tile, discard the pixels already drawn
+    for (uint8_t pix_col = fetch_x & 0x07; pix_col < 8; pix_col++)
+    {
+        uint8_t pix_mask = 0x80 >> pix_col;
+        uint8_t hi_bit = hi_byte & pix_mask ? 0x02 : 0x00;
+        uint8_t lo_bit = lo_byte & pix_mask ? 0x01 : 0x00;
+        m_queue[(m_queue_head + m_queue_size++) & 0x0F] = hi_bit | lo_bit;
+    }
+}
+
+void GAMEBOY::PPU_PixelFifo::step(const PPU_RenderState& state, LINE_PIXELS& line_buffer)
+{
+    if (done())
+    {
+        return;
+    }
+    if (m_queue_size == 0)
+    {
+        fetch(state);
+    }
+    uint8_t pix_color_id = m_queue[m_queue_head];
+    m_queue_head = (m_queue_head + 1) & 0x0F;
+    m_queue_size--;
+    line_buffer[m_x++] = state.palette(IOHandler::PALETTE::BGP)[pix_color_id];
+}
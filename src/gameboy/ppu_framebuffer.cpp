@@ -0,0 +1,112 @@
+#include "gameboy/ppu_framebuffer.h"
+#include "gameboy/state.h"
+#include <algorithm>
+#include <stdexcept>
+
+void GAMEBOY::PPU_Framebuffer::write_line(uint8_t line, const LINE_PIXELS& pixels)
+{
+    if (line >= SCREEN_HEIGHT)
+    {
+        throw std::out_of_range("Line beyond screen height attempted to be written");
+    }
+    auto line_start = m_buffers[m_back].begin() + line*SCREEN_WIDTH;
+    std::copy(pixels.cbegin(), pixels.cend(), line_start);
+    if (!m_rgba_buffers.empty())
+    {
+        auto rgba_it = m_rgba_buffers[m_back].begin() + line*SCREEN_WIDTH;
+        for (uint8_t shade : pixels)
+        {
+            *(rgba_it++) = m_shade_rgba[shade & 0x03];
+        }
+    }
+}
+
+void GAMEBOY::PPU_Framebuffer::swap()
+{
+    m_back ^= 1;
+    ++m_sequence;
+    if (m_frame_ready)
+    {
+        m_frame_ready(front(), m_sequence);
+    }
+}
+
+const GAMEBOY::FRAME_PIXELS& GAMEBOY::PPU_Framebuffer::front() const
+{
+    return m_buffers[m_back ^ 1];
+}
+
+const GAMEBOY::FRAME_PIXELS& GAMEBOY::PPU_Framebuffer::back() const
+{
+    return m_buffers[m_back];
+}
+
+uint64_t GAMEBOY::PPU_Framebuffer::sequence() const
+{
+    return m_sequence;
+}
+
+void GAMEBOY::PPU_Framebuffer::on_frame_ready(FRAME_READY_CALLBACK callback)
+{
+    m_frame_ready = callback;
+}
+
+bool GAMEBOY::PPU_Framebuffer::rgba_enabled() const
+{
+    return !m_rgba_buffers.empty();
+}
+
+void GAMEBOY::PPU_Framebuffer::rgba_enabled(bool enabled)
+{
+    if (!enabled)
+    {
+        m_rgba_buffers.clear();
+        m_rgba_buffers.shrink_to_fit();
+    }
+    else if (m_rgba_buffers.empty())
+    {
+        m_rgba_buffers.resize(2);
+    }
+}
+
+const GAMEBOY::SHADE_RGBA_LUT& GAMEBOY::PPU_Framebuffer::shade_rgba() const
+{
+    return m_shade_rgba;
+}
+
+void GAMEBOY::PPU_Framebuffer::shade_rgba(const SHADE_RGBA_LUT& lut)
+{
+    m_shade_rgba = lut;
+}
+
+const GAMEBOY::FRAME_RGBA& GAMEBOY::PPU_Framebuffer::front_rgba() const
+{
+    if (m_rgba_buffers.empty())
+    {
+        throw std::logic_error("RGBA output is not enabled");
+    }
+    return m_rgba_buffers[m_back ^ 1];
+}
+
+void GAMEBOY::PPU_Framebuffer::save_state(StateWriter& state) const
+{
+    state.write(m_buffers[0]);
+    state.write(m_buffers[1]);
+    state.write(m_back);
+    state.write(m_sequence);
+}
+
+void GAMEBOY::PPU_Framebuffer::load_state(StateReader& state)
+{
+    state.read(m_buffers[0]);
+    state.read(m_buffers[1]);
+    m_back = state.read<uint8_t>() & 1;
+    m_sequence = state.read<uint64_t>();
+    for (size_t buffer=0; buffer<m_rgba_buffers.size(); buffer++)
+    {
+        std::transform(m_buffers[buffer].cbegin(), m_buffers[buffer].cend(),
+            m_rgba_buffers[buffer].begin(), [this](uint8_t shade) {
+                return m_shade_rgba[shade & 0x03];
+            });
+    }
+}
@@ -0,0 +1,70 @@
+#include "gameboy/ppu_frameskip.h"
+
+GAMEBOY::PPU_FrameSkip::MODE GAMEBOY::PPU_FrameSkip::mode()
+{
+    return m_mode;
+}
+
+void GAMEBOY::PPU_FrameSkip::mode(MODE mode)
+{
+    m_mode = mode;
+    m_counter = 0;
+    m_skipped = 0;
+    m_adaptive_start = CLOCK::now();
+    m_adaptive_frames = 0;
+}
+
+void GAMEBOY::PPU_FrameSkip::interval(uint32_t interval)
+{
+    m_interval = interval == 0 ? 1 : interval;
+    m_counter = 0;
+}
+
+void GAMEBOY::PPU_FrameSkip::request()
+{
+    m_requested = true;
+}
+
+bool GAMEBOY::PPU_FrameSkip::m_adaptive_behind()
+{
+    auto elapsed = CLOCK::now() - m_adaptive_start;
+    auto emulated = m_FRAME_TIME * m_adaptive_frames++;
+    if (elapsed > emulated + m_FRAME_TIME * m_ADAPTIVE_RESYNC_FRAMES)
+    {
+        // too far behind to ever catch up, e.g. after the host was paused
+        m_adaptive_start = CLOCK::now();
+        m_adaptive_frames = 1;
+        return false;
+    }
+    return elapsed > emulated + m_FRAME_TIME;
+}
+
+bool GAMEBOY::PPU_FrameSkip::next_frame()
+{
+    switch (m_mode)
+    {
+        case MODE::FIXED:
+        {
+            bool draw = m_counter == 0;
+            m_counter = (m_counter + 1) % m_interval;
+            return draw;
+        }
+        case MODE::ON_REQUEST:
+        {
+            bool requested = m_requested;
+            m_requested = false;
+            return requested;
+        }
+        case MODE::ADAPTIVE:
+            if (m_adaptive_behind() && m_skipped < m_ADAPTIVE_MAX_SKIP)
+            {
+                m_skipped++;
+                return false;
+            }
+            m_skipped = 0;
+            return true;
+        case MODE::OFF:
+        default:
+            return true;
+    }
+}
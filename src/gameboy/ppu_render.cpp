@@ -0,0 +1,166 @@
+#include "gameboy/ppu_render.h"
+#include "gameboy/memory_io.h"
+
+const GAMEBOY::LINE_PIXELS& GAMEBOY::PPU_LineRenderer::render(const PPU_LineRecord& record)
+{
+    // the whole line from the state at the start of mode 3
+    auto bg = m_tilemap.render_line(record.start, record.line);
+    *m_line_buffer = *bg;
+    m_spritemap.render_line(record.start, record.line, m_line_buffer);
+    if (record.writes.empty())
+    {
+        return *m_line_buffer;
+    }
+    /*
+     * Pixels before the first write keep their values, from there on the
+     * FIFO catches up to each write before applying it, then finishes the
+     * line with every write applied
+     */
+    PPU_RenderState state = record.start;
+    m_fifo.begin(record.line, state.scx, record.writes.front().x);
+    for (const PPU_LineRecord::Write& write : record.writes)
+    {
+        while (!m_fifo.done() && m_fifo.x() < write.x)
+        {
+            m_fifo.step(state, *bg);
+        }
+        m_write(state, write.addr, write.data);
+    }
+    while (!m_fifo.done())
+    {
+        m_fifo.step(state, *bg);
+    }
+    *m_line_buffer = *bg;
+    state.oam = record.end_oam;
+    state.vram_modified = record.end_vram_modified;
+    m_spritemap.render_line(state, record.line, m_line_buffer);
+    return *m_line_buffer;
+}
+
+void GAMEBOY::PPU_LineRenderer::m_write(PPU_RenderState& state, uint16_t addr, uint8_t data)
+{
+    if (addr >= VRAM_LO && addr <= VRAM_HI)
+    {
+        // the snapshot is shared, so the line's writes go to a copy, which
+        // shares every page it doesn't write
+        if (state.vram != m_vram)
+        {
+            if (m_vram && m_vram.use_count() == 1)
+            {
+                *m_vram = *state.vram;
+            }
+            else
+            {
+                m_vram = std::make_shared<VRAM_DATA>(*state.vram);
+            }
+            state.vram = m_vram;
+        }
+        m_vram->write(addr - VRAM_LO, data);
+        return;
+    }
+    switch (addr)
+    {
+        case IOHandler::PPU_REG_LCDC:
+            state.lcdc = data;
+            break;
+        case IOHandler::PPU_REG_SCY:
+            state.scy = data;
+            break;
+        case IOHandler::PPU_REG_SCX:
+            state.scx = data;
+            break;
+        case IOHandler::PPU_REG_BGP:
+            state.palettes[static_cast<size_t>(IOHandler::PALETTE::BGP)] = IOHandler::decode_palette(data);
+            break;
+        case IOHandler::PPU_REG_OBP0:
+            state.palettes[static_cast<size_t>(IOHandler::PALETTE::OBP0)] = IOHandler::decode_palette(data);
+            break;
+        case IOHandler::PPU_REG_OBP1:
+            state.palettes[static_cast<size_t>(IOHandler::PALETTE::OBP1)] = IOHandler::decode_palette(data);
+            break;
+        default:
+            break;
+    }
+}
+
+GAMEBOY::PPU_RenderWorker::PPU_RenderWorker(PPU_LineRenderer& renderer, PPU_Framebuffer& framebuffer)
+: m_renderer(renderer), m_framebuffer(framebuffer)
+{
+    m_thread = std::thread(&PPU_RenderWorker::m_loop, this);
+}
+
+GAMEBOY::PPU_RenderWorker::~PPU_RenderWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void GAMEBOY::PPU_RenderWorker::submit(PPU_LineRecord&& record)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(record));
+    }
+    m_work.notify_one();
+}
+
+void GAMEBOY::PPU_RenderWorker::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() {
+        return m_queue.empty() && !m_busy;
+    });
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void GAMEBOY::PPU_RenderWorker::m_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work.wait(lock, [this]() {
+            return m_stop || !m_queue.empty();
+        });
+        if (m_queue.empty())
+        {
+            return;
+        }
+        PPU_LineRecord record = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+        try
+        {
+            m_framebuffer.write_line(record.line, m_renderer.render(record));
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+            lock.unlock();
+        }
+        // drop the snapshot before blocking, so VRAM writes needn't copy it
+        record = PPU_LineRecord();
+        lock.lock();
+        m_busy = false;
+        if (m_queue.empty())
+        {
+            m_idle.notify_all();
+        }
+    }
+}
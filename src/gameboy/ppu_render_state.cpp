@@ -0,0 +1,88 @@
+#include "gameboy/ppu_render_state.h"
+#include "gameboy/state.h"
+
+GAMEBOY::PPU_RenderState GAMEBOY::PPU_RenderState::capture(AddressDispatcher& memory)
+{
+    PPU_RenderState state;
+    state.vram = memory.vram_snapshot();
+    state.oam = memory.oam_data();
+    state.lcdc = memory.read(IOHandler::PPU_REG_LCDC, MemoryAccessSource::PPU);
+    state.scy = memory.read(IOHandler::PPU_REG_SCY, MemoryAccessSource::PPU);
+    state.scx = memory.read(IOHandler::PPU_REG_SCX, MemoryAccessSource::PPU);
+    state.wy = memory.read(IOHandler::PPU_REG_WY, MemoryAccessSource::PPU);
+    state.wx = memory.read(IOHandler::PPU_REG_WX, MemoryAccessSource::PPU);
+    for (auto palette : {IOHandler::PALETTE::BGP, IOHandler::PALETTE::OBP0, IOHandler::PALETTE::OBP1})
+    {
+        state.palettes[static_cast<size_t>(palette)] = memory.palette(palette);
+    }
+    state.vram_modified = memory.vram_pop_modified();
+    return state;
+}
+
+void GAMEBOY::PPU_LineRecord::save_state(StateWriter& state, const std::shared_ptr<const VRAM_DATA>& live_vram) const
+{
+    state.write(line);
+    bool vram_written = start.vram != live_vram;
+    state.write(vram_written);
+    if (vram_written)
+    {
+        start.vram->save_state(state);
+    }
+    state.write(start.oam);
+    state.write(start.lcdc);
+    state.write(start.scy);
+    state.write(start.scx);
+    state.write(start.wy);
+    state.write(start.wx);
+    for (const PALETTE_LUT& palette : start.palettes)
+    {
+        state.write(palette);
+    }
+    state.write(start.vram_modified);
+    state.write(static_cast<uint32_t>(writes.size()));
+    for (const Write& write : writes)
+    {
+        state.write(write.x);
+        state.write(write.addr);
+        state.write(write.data);
+    }
+}
+
+void GAMEBOY::PPU_LineRecord::load_state(StateReader& state, std::shared_ptr<const VRAM_DATA> live_vram)
+{
+    line = state.read<uint8_t>();
+    if (state.read<bool>())
+    {
+        auto vram = std::make_shared<VRAM_DATA>();
+        vram->load_state(state);
+        start.vram = vram;
+    }
+    else
+    {
+        start.vram = live_vram;
+    }
+    state.read(start.oam);
+    start.lcdc = state.read<uint8_t>();
+    start.scy = state.read<uint8_t>();
+    start.scx = state.read<uint8_t>();
+    start.wy = state.read<uint8_t>();
+    start.wx = state.read<uint8_t>();
+    for (PALETTE_LUT& palette : start.palettes)
+    {
+        state.read(palette);
+    }
+    start.vram_modified = state.read<bool>();
+    uint32_t write_count = state.read<uint32_t>();
+    writes.clear();
+    for (uint32_t i=0; i<write_count; i++)
+    {
+        Write write;
+        write.x = state.read<uint8_t>();
+        write.addr = state.read<uint16_t>();
+        write.data = state.read<uint8_t>();
+        writes.push_back(write);
+    }
+    // end of line values are filled in when mode 3 ends
+    end_oam = {};
+    end_vram_modified = false;
+}
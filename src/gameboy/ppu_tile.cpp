@@ -7,7 +7,7 @@ typedef std::array<uint8_t, 16> _TILEBYTES;
 
 std::unique_ptr<_TILEBYTES>
 _getTileData(
-        GAMEBOY::AddressDispatcher& memory,
+        const GAMEBOY::PPU_RenderState& state,
         uint8_t index,
         bool unsigned_mode)
 {
@@ -19,7 +19,7 @@ _getTileData(
         uint16_t data_start_addr = base_addr + static_cast<uint16_t>(index)*byte_count;
         for (size_t i=0; i<byte_count; i++)
         {
-            uint8_t i_data = memory.read(data_start_addr + i, GAMEBOY::MemoryAccessSource::PPU);
+            uint8_t i_data = state.vram_read(data_start_addr + i);
             (*tile_data)[i] = i_data;
         }
     }
@@ -30,7 +30,7 @@ _getTileData(
         uint16_t data_start_addr = base_addr + static_cast<int16_t>(index_signed)*byte_count;
         for (size_t i=0; i<byte_count; i++)
         {
-            uint8_t i_data = memory.read(data_start_addr + i, GAMEBOY::MemoryAccessSource::PPU);
+            uint8_t i_data = state.vram_read(data_start_addr + i);
             (*tile_data)[i] = i_data;
         }
     }
@@ -62,12 +62,11 @@ void _tileBytesToXY(uint8_t* in_begin, uint8_t* in_end, uint8_t* out_begin, uint
 }
 
 GAMEBOY::PPU_Tile::PPU_Tile(
-        GAMEBOY::AddressDispatcher& memory,
+        const GAMEBOY::PPU_RenderState& state,
         uint8_t index)
 {
-    uint8_t lcdc_register = memory.read(GAMEBOY::IOHandler::PPU_REG_LCDC, MemoryAccessSource::PPU);
-    bool unsigned_mode = lcdc_register & 0x10;
-    auto tile_bytes = _getTileData(memory, index, unsigned_mode);
+    bool unsigned_mode = state.lcdc & 0x10;
+    auto tile_bytes = _getTileData(state, index, unsigned_mode);
     _tileBytesToXY(tile_bytes->begin(), tile_bytes->end(), m_tile_data.begin(), m_tile_data.end());
 }
 
@@ -82,44 +81,26 @@ uint8_t GAMEBOY::PPU_Tile::get_pixel(uint8_t x, uint8_t y)
 
 void GAMEBOY::PPU_Tilecache::clear()
 {
+    GBEMU_STAT(m_stats.tile_cache_invalidations++);
     cache = std::array<std::optional<_PPU_TILE_PTR>, 256>();
 }
 
-std::shared_ptr<GAMEBOY::PPU_Tile> GAMEBOY::PPU_Tilecache::get(uint8_t index)
+std::shared_ptr<GAMEBOY::PPU_Tile> GAMEBOY::PPU_Tilecache::get(const PPU_RenderState& state, uint8_t index)
 {
     if (cache[index].has_value())
     {
+        GBEMU_STAT(m_stats.tile_cache_hits++);
         return cache[index].value();
     }
-    _PPU_TILE_PTR tile = std::make_shared<GAMEBOY::PPU_Tile>(memory, index);
+    GBEMU_STAT(m_stats.tile_cache_misses++);
+    _PPU_TILE_PTR tile = std::make_shared<GAMEBOY::PPU_Tile>(state, index);
     cache[index] = std::make_optional(tile);
     return tile;
 }
 
-uint8_t
-bg_color_id_to_shade(
-        GAMEBOY::AddressDispatcher& memory,
-        uint8_t pix_color_id)
+std::shared_ptr<GAMEBOY::LINE_PIXELS> GAMEBOY::PPU_Tilemap::render_line(const PPU_RenderState& state, uint8_t line)
 {
-    uint8_t bg_palette = memory.read(GAMEBOY::IOHandler::PPU_REG_BGP, GAMEBOY::MemoryAccessSource::PPU);
-    switch (pix_color_id)
-    {
-        case 0:
-            return bg_palette & 0x03;
-        case 1:
-            return (bg_palette & 0x0C)>>2;
-        case 2:
-            return (bg_palette & 0x30)>>4;
-        case 3:
-            return (bg_palette & 0xC0)>>6;
-        default:
-            throw std::out_of_range("Invalid pixel color id");
-    }
-}
-
-std::shared_ptr<GAMEBOY::LINE_PIXELS> GAMEBOY::PPU_Tilemap::render_line(GAMEBOY::PPU_Tilemap::MAP_SELECT map, uint8_t scroll_x, uint8_t scroll_y, uint8_t line)
-{
-    if (memory.vram_poll_modified())
+    if (state.vram_modified)
     {
         tilecache.clear();
     }
@@ -130,26 +111,28 @@ std::shared_ptr<GAMEBOY::LINE_PIXELS> GAMEBOY::PPU_Tilemap::render_line(GAMEBOY:
     {
         throw std::out_of_range("Line beyond screen size of 160 pixels attempted to be drawn");
     }
-    uint16_t map_start = map == MAP_SELECT::MAP0 ? 0x9800 : 0x9C00;
+    // bit 3 low = map at 0x9800, high = map at 0x9C00
+    uint16_t map_start = state.lcdc & 0x08 ? 0x9C00 : 0x9800;
+    const PALETTE_LUT& bg_palette = state.palette(IOHandler::PALETTE::BGP);
     std::shared_ptr<LINE_PIXELS> line_pix = std::make_shared<LINE_PIXELS>();
     // calculate where in the virtual map image is being drawn
     // note that using uint8_t allows expected overflow/wrap around
-    uint8_t map_y = scroll_y + line;
-    uint8_t map_x = scroll_x;
+    uint8_t map_y = state.scy + line;
+    uint8_t map_x = state.scx;
     // tiles are 8x8 pixels, so calculate which we are reading from
     uint8_t map_tile_y = map_y / 8;
     uint8_t tile_y = map_y % 8;
     for (uint8_t i = 0; i < SCREEN_SIZE_X; i++)
     {
-        uint8_t map_tile_x = (map_x+i) / 8;
-        uint8_t tile_index = memory.read(map_start + map_tile_y*32 + map_tile_x, MemoryAccessSource::PPU);
-        auto tile = tilecache.get(tile_index);
+        // the map is 32 tiles wide, wrapping past the right edge
+        uint8_t map_tile_x = ((map_x + i) / 8) & 0x1F;
+        uint8_t tile_index = state.vram_read(map_start + map_tile_y*32 + map_tile_x);
+        auto tile = tilecache.get(state, tile_index);
         uint8_t tile_x = (map_x+i) % 8;
         // copy data from tile for current pixel
         uint8_t pix_color_id = tile->get_pixel(tile_x, tile_y);
         // translate color id to 2 bit shade
-        uint8_t pix_shade = bg_color_id_to_shade(memory, pix_color_id);
-        (*line_pix)[i] = pix_shade;
+        (*line_pix)[i] = bg_palette[pix_color_id];
     }
     return line_pix;
 }
@@ -0,0 +1,216 @@
+#include "gameboy/rewind.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // equal bytes needed to end a run of XORed bytes, shorter gaps
+    // cost more to encode as a new pair than to copy
+    const size_t MIN_SKIP = 4;
+
+    void write_varint(std::vector<uint8_t>& out, size_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    size_t read_varint(const uint8_t* data, size_t size, size_t& offset)
+    {
+        size_t value = 0;
+        for (int shift=0; offset < size && shift < 64; shift += 7)
+        {
+            uint8_t byte = data[offset++];
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::out_of_range("Rewind delta truncated");
+    }
+
+    // First index from offset where the buffers differ, or size
+    size_t equal_run(const uint8_t* a, const uint8_t* b, size_t offset, size_t size)
+    {
+        // compare a word at a time through the long unchanged stretches
+        while (offset + 8 <= size)
+        {
+            uint64_t word_a, word_b;
+            std::memcpy(&word_a, a + offset, 8);
+            std::memcpy(&word_b, b + offset, 8);
+            if (word_a != word_b)
+            {
+                break;
+            }
+            offset += 8;
+        }
+        while (offset < size && a[offset] == b[offset])
+        {
+            offset++;
+        }
+        return offset;
+    }
+}
+
+GAMEBOY::Rewind::Rewind(size_t capacity, uint32_t interval)
+: m_ring(capacity), m_interval(std::max<uint32_t>(interval, 1)) {}
+
+void GAMEBOY::Rewind::encode_delta(const std::vector<uint8_t>& from, const std::vector<uint8_t>& to,
+    std::vector<uint8_t>& delta)
+{
+    if (from.size() != to.size())
+    {
+        throw std::invalid_argument("Delta between states of different sizes");
+    }
+    delta.clear();
+    const uint8_t* a = from.data();
+    const uint8_t* b = to.data();
+    size_t size = from.size();
+    size_t offset = 0;
+    while (offset < size)
+    {
+        size_t start = offset;
+        offset = equal_run(a, b, offset, size);
+        if (offset == size)
+        {
+            break;
+        }
+        size_t skip = offset - start;
+        size_t end = offset;
+        for (size_t i = offset; i < size && i - end < MIN_SKIP; i++)
+        {
+            if (a[i] != b[i])
+            {
+                end = i + 1;
+            }
+        }
+        write_varint(delta, skip);
+        write_varint(delta, end - offset);
+        for (; offset < end; offset++)
+        {
+            delta.push_back(a[offset] ^ b[offset]);
+        }
+    }
+}
+
+void GAMEBOY::Rewind::apply_delta(const uint8_t* delta, size_t delta_size, std::vector<uint8_t>& state)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < delta_size)
+    {
+        out += read_varint(delta, delta_size, in);
+        size_t length = read_varint(delta, delta_size, in);
+        if (out + length > state.size() || length > delta_size - in)
+        {
+            throw std::out_of_range("Rewind delta overruns the state");
+        }
+        for (size_t i=0; i<length; i++)
+        {
+            state[out++] ^= delta[in++];
+        }
+    }
+}
+
+bool GAMEBOY::Rewind::m_overlaps(const Entry& entry, size_t offset, size_t size) const
+{
+    return entry.offset < offset + size && offset < entry.offset + entry.size;
+}
+
+void GAMEBOY::Rewind::m_push(const std::vector<uint8_t>& delta)
+{
+    size_t size = delta.size();
+    if (size > m_ring.size())
+    {
+        // a single delta bigger than the ring, older history is unreachable
+        m_entries.clear();
+        m_stats.used_bytes = 0;
+        m_write = 0;
+        return;
+    }
+    if (m_write + size > m_ring.size())
+    {
+        // wrap around, dropping the oldest deltas left at the end
+        while (!m_entries.empty() && m_entries.front().offset >= m_write)
+        {
+            m_stats.used_bytes -= m_entries.front().size;
+            m_entries.pop_front();
+        }
+        m_write = 0;
+    }
+    while (!m_entries.empty() && m_overlaps(m_entries.front(), m_write, size))
+    {
+        m_stats.used_bytes -= m_entries.front().size;
+        m_entries.pop_front();
+    }
+    std::copy(delta.cbegin(), delta.cend(), m_ring.begin() + m_write);
+    m_entries.push_back({m_write, size});
+    m_write += size;
+    m_stats.used_bytes += size;
+}
+
+void GAMEBOY::Rewind::capture(Gameboy& gameboy)
+{
+    if (++m_frames < m_interval)
+    {
+        return;
+    }
+    m_frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    gameboy.save_state(m_snapshot);
+    if (m_latest.size() == m_snapshot.size())
+    {
+        // applying the delta to the new snapshot gives back the old one
+        encode_delta(m_snapshot, m_latest, m_delta);
+        m_push(m_delta);
+    }
+    else
+    {
+        clear();
+    }
+    std::swap(m_latest, m_snapshot);
+    m_stats.captures++;
+    m_stats.history = m_entries.size();
+    m_stats.state_bytes = m_latest.size();
+    m_stats.capture_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+bool GAMEBOY::Rewind::step_back(Gameboy& gameboy)
+{
+    if (m_entries.empty())
+    {
+        return false;
+    }
+    Entry entry = m_entries.back();
+    apply_delta(m_ring.data() + entry.offset, entry.size, m_latest);
+    m_entries.pop_back();
+    m_write = entry.offset;
+    m_stats.used_bytes -= entry.size;
+    m_stats.history = m_entries.size();
+    m_stats.rewinds++;
+    m_frames = 0;
+    gameboy.load_state(m_latest);
+    return true;
+}
+
+void GAMEBOY::Rewind::clear()
+{
+    m_entries.clear();
+    m_latest.clear();
+    m_write = 0;
+    m_frames = 0;
+    m_stats.used_bytes = 0;
+    m_stats.history = 0;
+}
+
+const GAMEBOY::Rewind::Stats& GAMEBOY::Rewind::stats() const
+{
+    return m_stats;
+}
@@ -1,29 +1,23 @@
-#include <SDL2/SDL_rwops.h>
-#include <SDL2/SDL_log.h>
+#include <math.h>
 
 #include "gameboy/rom.h"
+#include "gameboy/log.h"
 
-std::optional<ROMDATA> open_rom(char* rom_path) {
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loading rom file: %s\n", rom_path);
-    SDL_RWops* file = SDL_RWFromFile(rom_path, "rb");
-    if (file==NULL)
+std::optional<ROMDATA> open_rom(const char* rom_path, GAMEBOY::FileInterface& files) {
+    GBEMU_LOG_INFO("Loading rom file: %s\n", rom_path);
+    std::optional<ROMDATA> rom = files.read(rom_path);
+    if (!rom.has_value())
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Failed to open file\n");
+        GBEMU_LOG_CRITICAL("Failed to open file\n");
         return {}; // File failed to open
     }
-    size_t rom_size = SDL_RWsize(file);
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Rom file size: %lu\n", rom_size);
+    size_t rom_size = rom->size();
+    GBEMU_LOG_INFO("Rom file size: %lu\n", rom_size);
     if (rom_size > 10*1000*1000)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Rom size over 10MB not allowed\n");
+        GBEMU_LOG_CRITICAL("Rom size over 10MB not allowed\n");
         return {}; // File size over 10MB is likely invalid
     }
-    ROMDATA rom(rom_size);
-    for (size_t i=0; i<rom_size; i++)
-    {
-        rom[i] = SDL_ReadU8(file);
-    }
-    SDL_RWclose(file);
     return rom;
 }
 
@@ -0,0 +1,118 @@
+#include "gameboy/scheduler.h"
+#include "gameboy/state.h"
+#include <algorithm>
+
+GAMEBOY::Scheduler::Scheduler()
+{
+    m_due.fill(NEVER);
+    m_heap.reserve(4*m_EVENT_COUNT);
+}
+
+bool GAMEBOY::Scheduler::m_later(const Event& a, const Event& b)
+{
+    if (a.time != b.time)
+    {
+        return a.time > b.time;
+    }
+    return a.type > b.type;
+}
+
+bool GAMEBOY::Scheduler::m_stale(const Event& event) const
+{
+    return event.generation != m_generation[static_cast<size_t>(event.type)];
+}
+
+void GAMEBOY::Scheduler::m_discard_stale()
+{
+    while (!m_heap.empty() && m_stale(m_heap.front()))
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), m_later);
+        m_heap.pop_back();
+    }
+    m_next_due = m_heap.empty() ? NEVER : m_heap.front().time;
+}
+
+void GAMEBOY::Scheduler::handler(EventType type, HANDLER handler)
+{
+    m_handlers[static_cast<size_t>(type)] = handler;
+}
+
+void GAMEBOY::Scheduler::schedule(EventType type, uint64_t time)
+{
+    size_t index = static_cast<size_t>(type);
+    uint32_t generation = ++m_generation[index];
+    m_due[index] = time;
+    m_heap.push_back({time, type, generation});
+    std::push_heap(m_heap.begin(), m_heap.end(), m_later);
+    m_discard_stale();
+}
+
+void GAMEBOY::Scheduler::cancel(EventType type)
+{
+    size_t index = static_cast<size_t>(type);
+    ++m_generation[index];
+    m_due[index] = NEVER;
+    m_discard_stale();
+}
+
+bool GAMEBOY::Scheduler::pending(EventType type) const
+{
+    return m_due[static_cast<size_t>(type)] != NEVER;
+}
+
+uint64_t GAMEBOY::Scheduler::due(EventType type) const
+{
+    return m_due[static_cast<size_t>(type)];
+}
+
+void GAMEBOY::Scheduler::dispatch()
+{
+    while (!m_heap.empty() && m_heap.front().time <= m_now)
+    {
+        Event event = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), m_later);
+        m_heap.pop_back();
+        if (m_stale(event))
+        {
+            continue;
+        }
+        size_t index = static_cast<size_t>(event.type);
+        m_due[index] = NEVER;
+        m_dispatched |= event_bit(event.type);
+        // the handler may schedule further events, including for now
+        if (m_handlers[index])
+        {
+            m_handlers[index](event.time);
+        }
+    }
+    m_discard_stale();
+}
+
+void GAMEBOY::Scheduler::save_state(StateWriter& state) const
+{
+    state.write(m_now);
+    for (uint64_t due : m_due)
+    {
+        state.write(due);
+    }
+}
+
+void GAMEBOY::Scheduler::load_state(StateReader& state)
+{
+    m_now = state.read<uint64_t>();
+    m_heap.clear();
+    m_dispatched = 0;
+    for (size_t index=0; index<m_EVENT_COUNT; index++)
+    {
+        uint64_t due = state.read<uint64_t>();
+        EventType type = static_cast<EventType>(index);
+        if (due == NEVER)
+        {
+            cancel(type);
+        }
+        else
+        {
+            schedule(type, due);
+        }
+    }
+}
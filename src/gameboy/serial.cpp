@@ -1,13 +1,13 @@
 #include "gameboy/serial.h"
 
-GAMEBOY::SerialEventSupervisor* GAMEBOY::SerialEventSupervisor::instance = nullptr;
-
-void GAMEBOY::SerialEventSupervisor::subscribe(SerialEventType event, SerialEventSubscriber* subscriber)
+void GAMEBOY::SerialEventSupervisor::subscribe([[maybe_unused]] SerialEventType event, SerialEventSubscriber* subscriber)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     subscribers.push_back(subscriber);
 }
-void GAMEBOY::SerialEventSupervisor::publish(SerialEventType event, uint8_t data)
+void GAMEBOY::SerialEventSupervisor::publish([[maybe_unused]] SerialEventType event, uint8_t data)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     for (auto it=subscribers.begin(); it!=subscribers.end(); it++)
     {
         SerialEventSubscriber* subscriber = *it;
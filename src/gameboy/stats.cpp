@@ -0,0 +1,115 @@
+#include "gameboy/stats.h"
+#include <algorithm>
+#include <stdarg.h>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    void append(std::string& out, const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    void append(std::string& out, const char* format, ...)
+    {
+        char line[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        out += line;
+    }
+
+    double percent(uint64_t part, uint64_t total)
+    {
+        return total == 0 ? 0.0 : 100.0*part/total;
+    }
+}
+
+const char* GAMEBOY::Stats::region_name(REGION region)
+{
+    switch (region)
+    {
+        case REGION::CART_ROM:
+            return "ROM";
+        case REGION::VRAM:
+            return "VRAM";
+        case REGION::CART_RAM:
+            return "cart RAM";
+        case REGION::WRAM:
+            return "WRAM";
+        case REGION::OAM:
+            return "OAM";
+        case REGION::IO:
+            return "IO";
+        case REGION::HRAM:
+            return "HRAM";
+        case REGION::UNMAPPED:
+            return "unmapped";
+    }
+    return "";
+}
+
+const char* GAMEBOY::Stats::source_name(MemoryAccessSource source)
+{
+    switch (source)
+    {
+        case MemoryAccessSource::CPU:
+            return "CPU";
+        case MemoryAccessSource::PPU:
+            return "PPU";
+        case MemoryAccessSource::DMA:
+            return "DMA";
+    }
+    return "";
+}
+
+std::string GAMEBOY::Stats::summary(size_t top_opcodes) const
+{
+    std::string out;
+    if (!ENABLED)
+    {
+        append(out, "%lu M-cycles, other counters not compiled in\n", (unsigned long)mcycles);
+        return out;
+    }
+    append(out, "%lu M-cycles, %lu instructions, %lu interrupts\n",
+        (unsigned long)mcycles, (unsigned long)instructions, (unsigned long)interrupts);
+    append(out, "HALT %.1f%%, STOP %.1f%%\n",
+        percent(halt_mcycles, mcycles), percent(stop_mcycles, mcycles));
+    // opcodes ordered by count, CB prefixed ones after the rest
+    std::vector<std::pair<uint64_t, uint16_t>> ranked;
+    for (uint16_t opcode=0; opcode<0x100; opcode++)
+    {
+        ranked.push_back({opcodes[opcode], opcode});
+        ranked.push_back({cb_opcodes[opcode], 0xCB00 | opcode});
+    }
+    size_t shown = std::min(top_opcodes, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + shown, ranked.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+    out += "Top opcodes:";
+    for (size_t i=0; i<shown && ranked[i].first != 0; i++)
+    {
+        append(out, ranked[i].second > 0xFF ? " %04X %.1f%%" : " %02X %.1f%%",
+            ranked[i].second, percent(ranked[i].first, instructions));
+    }
+    out += "\nReads/writes:";
+    for (size_t region=0; region<REGION_COUNT; region++)
+    {
+        append(out, " %s %lu/%lu", region_name(static_cast<REGION>(region)),
+            (unsigned long)reads[region], (unsigned long)writes[region]);
+    }
+    out += "\nAccesses:";
+    for (size_t source=0; source<SOURCE_COUNT; source++)
+    {
+        append(out, " %s %lu", source_name(static_cast<MemoryAccessSource>(source)),
+            (unsigned long)accesses[source]);
+    }
+    append(out, "\nTile cache: %lu hits, %lu misses, %lu invalidations\n",
+        (unsigned long)tile_cache_hits, (unsigned long)tile_cache_misses,
+        (unsigned long)tile_cache_invalidations);
+    append(out, "Sprite cache: %lu hits, %lu misses, %lu invalidations\n",
+        (unsigned long)sprite_cache_hits, (unsigned long)sprite_cache_misses,
+        (unsigned long)sprite_cache_invalidations);
+    append(out, "%lu lines rendered, %lu through the FIFO, %lu DMA transfers\n",
+        (unsigned long)lines_rendered, (unsigned long)fifo_lines, (unsigned long)dma_transfers);
+    return out;
+}
@@ -1,69 +1,179 @@
 #include "gameboy/timer.h"
 #include "gameboy/memory_io.h"
+#include "gameboy/state.h"
 
-GAMEBOY::Timer* GAMEBOY::Timer::instance = nullptr;
+GAMEBOY::Timer::Timer(Scheduler& scheduler, IOHandler& io)
+: m_scheduler(scheduler), m_io(io)
+{
+    m_counter_base = m_scheduler.now();
+    m_tima_time = m_counter_base;
+    m_scheduler.handler(EventType::TIMER, [this](uint64_t time) {
+        m_reload(time);
+    });
+}
 
-void GAMEBOY::Timer::tick(GAMEBOY::AddressDispatcher& memory)
+bool GAMEBOY::Timer::m_enabled()
+{
+    return registerTAC & 0x04;
+}
+
+uint64_t GAMEBOY::Timer::m_period()
 {
-    if (++registerDIVSubTick == 63)
-    {
-        ++registerDIV;
-        registerDIVSubTick = 0;
-    }
-    bool timerBitCurrent;
     switch (registerTAC & 0x03)
     {
         case 0b00:
-            timerBitCurrent = registerDIV & 0x02;
-            break;
+            return 1024;
         case 0b01:
-            timerBitCurrent = registerDIVSubTick & 0x02;
-            break;
+            return 16;
         case 0b10:
-            timerBitCurrent = registerDIVSubTick & 0x08;
-            break;
+            return 64;
         case 0b11:
-            timerBitCurrent = registerDIVSubTick & 0x20;
-            break;
+        default:
+            return 256;
+    }
+}
+
+bool GAMEBOY::Timer::m_timer_bit(uint64_t time)
+{
+    return m_enabled() && !m_stopped && ((time - m_counter_base) & (m_period() >> 1));
+}
+
+uint64_t GAMEBOY::Timer::m_edges(uint64_t from, uint64_t to)
+{
+    if (!m_enabled() || m_stopped || to <= from)
+    {
+        return 0;
+    }
+    uint64_t period = m_period();
+    return (to - m_counter_base)/period - (from - m_counter_base)/period;
+}
+
+bool GAMEBOY::Timer::m_overflowed(uint64_t time)
+{
+    return m_reload_time != Scheduler::NEVER && time + 4 >= m_reload_time;
+}
+
+uint8_t GAMEBOY::Timer::m_tima(uint64_t time)
+{
+    if (m_overflowed(time))
+    {
+        // waiting for TMA
+        return 0x00;
+    }
+    return (registerTIMA + m_edges(m_tima_time, time)) & 0xFF;
+}
+
+void GAMEBOY::Timer::m_tima_latch(uint64_t time)
+{
+    registerTIMA = m_tima(time);
+    m_tima_time = time;
+}
+
+void GAMEBOY::Timer::m_falling_edge(uint64_t time)
+{
+    if (m_overflowed(time))
+    {
+        return;
+    }
+    if (++registerTIMA == 0x00)
+    {
+        // overflowed this M-cycle, so TMA is copied at the end of it
+        m_reload_time = time + 4;
+    }
+}
+
+void GAMEBOY::Timer::m_reset_counter(uint64_t time)
+{
+    m_tima_latch(time);
+    // a set timer bit falls as the counter resets
+    bool timer_bit = m_timer_bit(time);
+    m_counter_base = time;
+    if (timer_bit)
+    {
+        m_falling_edge(time);
     }
-    timerBitCurrent = timerBitCurrent && (registerTAC & 0x04);
-    if (timaOverflow)
+}
+
+void GAMEBOY::Timer::m_schedule_reload(uint64_t time)
+{
+    if (!m_overflowed(time))
     {
-        // previously overflowed
-        registerTIMA = registerTMA;
-        // request timer interrupt
-        uint8_t interrupt_flags = memory.read(IOHandler::INTERRUPT_REG_IF);
-        interrupt_flags |= 0x04;
-        memory.write(IOHandler::INTERRUPT_REG_IF, interrupt_flags);
-        timaOverflow = false;
+        m_reload_time = Scheduler::NEVER;
+        if (m_enabled() && !m_stopped)
+        {
+            // the overflow is the (256 - TIMA)th falling edge from the latch
+            uint64_t period = m_period();
+            uint64_t first_edge = m_counter_base + ((m_tima_time - m_counter_base)/period + 1)*period;
+            uint64_t overflow = first_edge + (0xFF - registerTIMA)*period;
+            // TMA->TIMA copy happens the M-cycle after the overflow
+            m_reload_time = overflow + 4;
+        }
     }
-    if (!timerBitCurrent && timerBitPrevious) // falling edge
+    if (m_reload_time == Scheduler::NEVER)
     {
-        ++registerTIMA;
-        // if overflow, queue TMA->TIMA copy for next m-cycle
-        timaOverflow = (registerTIMA == 0x00);
+        m_scheduler.cancel(EventType::TIMER);
+        return;
     }
-    timerBitPrevious = timerBitCurrent;
+    m_scheduler.schedule(EventType::TIMER, m_reload_time);
+}
+
+void GAMEBOY::Timer::m_reload(uint64_t time)
+{
+    registerTIMA = registerTMA;
+    m_tima_time = time;
+    m_reload_time = Scheduler::NEVER;
+    m_reloaded_time = time;
+    // request timer interrupt
+    m_io.request_interrupt(0x04);
+    m_schedule_reload(time);
 }
 
 void GAMEBOY::Timer::write(Register target, uint8_t data)
 {
+    uint64_t now = m_scheduler.now();
     switch (target)
     {
         case Register::DIV:
             // always reset on write, data ignored
-            registerDIV = 0;
+            m_reset_counter(now);
             break;
         case Register::TIMA:
+            if (now == m_reloaded_time)
+            {
+                // TMA is being copied this M-cycle and takes priority
+                return;
+            }
+            // writing in the M-cycle after an overflow aborts the reload
+            if (m_overflowed(now))
+            {
+                m_reload_time = Scheduler::NEVER;
+            }
             registerTIMA = data;
+            m_tima_time = now;
             break;
         case Register::TMA:
             registerTMA = data;
+            if (now != m_reloaded_time)
+            {
+                return;
+            }
+            // still being copied into TIMA
+            m_tima_latch(now);
+            registerTIMA = data;
             break;
         case Register::TAC:
+        {
+            m_tima_latch(now);
+            bool timer_bit = m_timer_bit(now);
             registerTAC = data;
+            if (timer_bit && !m_timer_bit(now))
+            {
+                m_falling_edge(now);
+            }
             break;
+        }
     }
+    m_schedule_reload(now);
 }
 
 uint8_t GAMEBOY::Timer::read(Register target)
@@ -71,9 +181,14 @@ uint8_t GAMEBOY::Timer::read(Register target)
     switch (target)
     {
         case Register::DIV:
-            return registerDIV;
+            if (m_stopped)
+            {
+                return 0x00;
+            }
+            // DIV is bits 8-15 of the system counter
+            return ((m_scheduler.now() - m_counter_base) >> 8) & 0xFF;
         case Register::TIMA:
-            return registerTIMA;
+            return m_tima(m_scheduler.now());
         case Register::TMA:
             return registerTMA;
         case Register::TAC:
@@ -83,3 +198,45 @@ uint8_t GAMEBOY::Timer::read(Register target)
             return 0x00;
     }
 }
+
+void GAMEBOY::Timer::stop()
+{
+    uint64_t now = m_scheduler.now();
+    m_reset_counter(now);
+    m_stopped = true;
+    m_schedule_reload(now);
+}
+
+void GAMEBOY::Timer::resume()
+{
+    uint64_t now = m_scheduler.now();
+    // counting restarts from 0, with TIMA as it was when stopped
+    m_counter_base = now;
+    m_tima_time = now;
+    m_stopped = false;
+    m_schedule_reload(now);
+}
+
+void GAMEBOY::Timer::save_state(StateWriter& state) const
+{
+    state.write(m_counter_base);
+    state.write(m_tima_time);
+    state.write(registerTIMA);
+    state.write(registerTMA);
+    state.write(registerTAC);
+    state.write(m_reload_time);
+    state.write(m_reloaded_time);
+    state.write(m_stopped);
+}
+
+void GAMEBOY::Timer::load_state(StateReader& state)
+{
+    m_counter_base = state.read<uint64_t>();
+    m_tima_time = state.read<uint64_t>();
+    registerTIMA = state.read<uint8_t>();
+    registerTMA = state.read<uint8_t>();
+    registerTAC = state.read<uint8_t>();
+    m_reload_time = state.read<uint64_t>();
+    m_reloaded_time = state.read<uint64_t>();
+    m_stopped = state.read<bool>();
+}
@@ -0,0 +1,170 @@
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "gameboy/trace.h"
+
+GAMEBOY::TraceRecorder::TraceRecorder(const std::string& path, bool memory_accesses)
+: m_memory_accesses(memory_accesses), m_ring(std::make_unique<SpscRing<TraceRecord, RING_RECORDS>>())
+{
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        throw std::runtime_error("Trace file could not be created");
+    }
+    // rewritten with the counts on close
+    m_write_header();
+    m_writer = std::thread(&TraceRecorder::m_write_loop, this);
+}
+
+GAMEBOY::TraceRecorder::~TraceRecorder()
+{
+    close();
+}
+
+void GAMEBOY::TraceRecorder::access(TraceKind kind, uint64_t cycle, uint16_t addr, uint8_t data)
+{
+    TraceRecord record = {};
+    record.cycle = cycle;
+    record.pc = m_pc;
+    record.bank = m_bank;
+    record.kind = kind;
+    record.addr = addr;
+    record.data = data;
+    push(record);
+}
+
+void GAMEBOY::TraceRecorder::frame(uint64_t cycle)
+{
+    TraceRecord record = {};
+    record.cycle = cycle;
+    record.kind = TraceKind::FRAME;
+    push(record);
+}
+
+/**
+ * @brief Hand the batch to the writer, waiting for room in the ring
+ * rather than dropping records
+ */
+void GAMEBOY::TraceRecorder::m_flush()
+{
+    size_t done = m_ring->write(m_batch.data(), m_batch_size);
+    while (done < m_batch_size)
+    {
+        m_stalls++;
+        std::this_thread::yield();
+        done += m_ring->write(m_batch.data() + done, m_batch_size - done);
+    }
+    m_batch_size = 0;
+}
+
+void GAMEBOY::TraceRecorder::m_write_loop()
+{
+    std::vector<TraceRecord> records(RING_RECORDS/4);
+    while (true)
+    {
+        // read the flag first, so nothing pushed before stopping is missed
+        bool stop = m_stop.load(std::memory_order_acquire);
+        size_t count = m_ring->read(records.data(), records.size());
+        if (count == 0)
+        {
+            if (stop)
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (size_t i=0; i<count; i++)
+        {
+            if (records[i].kind == TraceKind::FRAME)
+            {
+                m_frame_index.push_back(m_written + i);
+            }
+        }
+        m_write_failed |= fwrite(records.data(), sizeof(TraceRecord), count, m_file) != count;
+        m_written += count;
+    }
+}
+
+void GAMEBOY::TraceRecorder::m_write_header()
+{
+    TraceHeader header = {};
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.byte_order = TRACE_BYTE_ORDER;
+    header.flags = m_memory_accesses ? TRACE_FLAG_MEMORY : 0;
+    header.record_count = m_written;
+    header.frame_count = m_frame_index.size();
+    header.frame_index_offset = m_frame_index.empty() && m_written == 0 ? 0
+        : sizeof(TraceHeader) + m_written*sizeof(TraceRecord);
+    m_write_failed |= fwrite(&header, sizeof(header), 1, m_file) != 1;
+}
+
+bool GAMEBOY::TraceRecorder::close()
+{
+    if (m_file == nullptr)
+    {
+        return !m_write_failed;
+    }
+    m_flush();
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+    m_write_failed |= fwrite(m_frame_index.data(), sizeof(uint64_t), m_frame_index.size(), m_file)
+        != m_frame_index.size();
+    m_write_failed |= fseek(m_file, 0, SEEK_SET) != 0;
+    m_write_header();
+    m_write_failed |= ferror(m_file) != 0;
+    m_write_failed |= fclose(m_file) != 0;
+    m_file = nullptr;
+    return !m_write_failed;
+}
+
+GAMEBOY::TraceReader::TraceReader(const uint8_t* data, size_t size)
+: m_data(data)
+{
+    if (size < sizeof(TraceHeader))
+    {
+        throw std::invalid_argument("Trace too short for its header");
+    }
+    std::memcpy(&m_header, data, sizeof(TraceHeader));
+    if (m_header.magic != TRACE_MAGIC)
+    {
+        throw std::invalid_argument("Not a trace");
+    }
+    if (m_header.byte_order != TRACE_BYTE_ORDER)
+    {
+        throw std::invalid_argument("Trace recorded on a host of the other byte order");
+    }
+    if (m_header.version != TRACE_VERSION || m_header.record_size != sizeof(TraceRecord))
+    {
+        throw std::invalid_argument("Unsupported trace version");
+    }
+    uint64_t available = (size - sizeof(TraceHeader))/sizeof(TraceRecord);
+    if (m_header.frame_index_offset == 0)
+    {
+        // never closed, every whole record written is readable
+        m_record_count = available;
+        m_header.frame_count = 0;
+        return;
+    }
+    m_record_count = m_header.record_count;
+    if (m_record_count > available ||
+        m_header.frame_index_offset != sizeof(TraceHeader) + m_record_count*sizeof(TraceRecord) ||
+        m_header.frame_count > (size - m_header.frame_index_offset)/sizeof(uint64_t))
+    {
+        throw std::invalid_argument("Trace truncated");
+    }
+}
+
+uint64_t GAMEBOY::TraceReader::frame_start(uint64_t frame) const
+{
+    if (frame >= m_header.frame_count)
+    {
+        throw std::out_of_range("Frame not in trace");
+    }
+    uint64_t index;
+    std::memcpy(&index, m_data + m_header.frame_index_offset + frame*sizeof(uint64_t), sizeof(index));
+    return index;
+}
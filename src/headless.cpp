@@ -0,0 +1,538 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gameboy/batch.h"
+#include "gameboy/file.h"
+#include "gameboy/gameboy.h"
+#include "gameboy/log.h"
+#include "gameboy/movie.h"
+#include "gameboy/rewind.h"
+#include "gameboy/rom.h"
+#include "gameboy/serial.h"
+#include "gameboy/trace.h"
+
+/*
+ * Runs a ROM without a display or SDL, for servers & automated testing
+ * Frames are written as binary PGM images, alongside the serial output
+ * and stats for the run
+ */
+
+class SerialCapture: public GAMEBOY::SerialEventSubscriber
+{
+public:
+    std::vector<uint8_t> data;
+    void receive(uint8_t byte)
+    {
+        data.push_back(byte);
+    }
+};
+
+struct Options
+{
+    const char* rom_path = nullptr;
+    std::string out_dir = ".";
+    uint64_t frames = 600;
+    bool frames_set = false;
+    std::optional<uint64_t> cycles;
+    // write every nth frame, 0 for only the final frame
+    uint64_t frame_every = 0;
+    // MB of rewind history to capture each frame, 0 for none
+    uint64_t rewind_mb = 0;
+    // copies of the ROM to run across the batch runner's threads
+    uint64_t instances = 1;
+    uint64_t threads = 0;
+    // movie to replay, verifying each frame against its hashes
+    const char* movie_path = nullptr;
+    // stream the APU's output to audio.wav
+    bool wav = false;
+    // draw lines on the PPU's render thread
+    bool render_thread = false;
+    // binary execution trace to record, see gbemu_trace
+    const char* trace_path = nullptr;
+    bool trace_memory = false;
+};
+
+void display_help(char* exec_name)
+{
+    printf("Missing or incorrect launch parameters.\n\n");
+    printf("Usage: %s [options] rom_file\n", exec_name);
+    printf("  --frames N       run for N frames (default 600)\n");
+    printf("  --cycles N       run for N T-cycles instead of a number of frames\n");
+    printf("  --out DIR        directory to write output to (default .)\n");
+    printf("  --frame-every N  also write every Nth frame\n");
+    printf("  --rewind MB      capture rewind history each frame, reporting its cost\n");
+    printf("  --instances N    run N instances for --frames each, reporting aggregate speed\n");
+    printf("  --threads N      worker threads for --instances (default one per core)\n");
+    printf("  --play FILE      replay a movie, by default for as many frames as were recorded\n");
+    printf("  --wav            write the sound to audio.wav as it is generated\n");
+    printf("  --render-thread  draw lines on a thread of their own\n");
+    printf("  --trace FILE     record every instruction to a binary trace\n");
+    printf("  --trace-memory   also record each instruction's memory accesses\n");
+}
+
+std::optional<Options> parse_args(int argc, char** argv)
+{
+    Options options;
+    for (int i=1; i<argc; i++)
+    {
+        bool has_value = i+1 < argc;
+        if (!strcmp(argv[i], "--frames") && has_value)
+        {
+            options.frames = strtoull(argv[++i], nullptr, 10);
+            options.frames_set = true;
+        }
+        else if (!strcmp(argv[i], "--cycles") && has_value)
+        {
+            options.cycles = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--out") && has_value)
+        {
+            options.out_dir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--frame-every") && has_value)
+        {
+            options.frame_every = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--rewind") && has_value)
+        {
+            options.rewind_mb = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--instances") && has_value)
+        {
+            options.instances = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value)
+        {
+            options.threads = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--play") && has_value)
+        {
+            options.movie_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--wav"))
+        {
+            options.wav = true;
+        }
+        else if (!strcmp(argv[i], "--render-thread"))
+        {
+            options.render_thread = true;
+        }
+        else if (!strcmp(argv[i], "--trace") && has_value)
+        {
+            options.trace_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace-memory"))
+        {
+            options.trace_memory = true;
+        }
+        else if (argv[i][0] != '-' && options.rom_path == nullptr)
+        {
+            options.rom_path = argv[i];
+        }
+        else
+        {
+            return {};
+        }
+    }
+    if (options.rom_path == nullptr || options.instances == 0 ||
+        (options.trace_memory && options.trace_path == nullptr))
+    {
+        return {};
+    }
+    // movies are replayed a frame at a time
+    if (options.movie_path != nullptr && options.cycles.has_value())
+    {
+        return {};
+    }
+    // batches only run whole frames and write the first instance's output
+    if (options.instances > 1 && (options.cycles.has_value() ||
+        options.frame_every != 0 || options.rewind_mb != 0 || options.movie_path != nullptr ||
+        options.wav || options.render_thread || options.trace_path != nullptr))
+    {
+        return {};
+    }
+    return options;
+}
+
+std::vector<uint8_t> encode_pgm(const GAMEBOY::FRAME_PIXELS& frame)
+{
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "P5\n%d %d\n255\n",
+            GAMEBOY::SCREEN_WIDTH, GAMEBOY::SCREEN_HEIGHT);
+    std::vector<uint8_t> image(header, header + header_len);
+    image.reserve(header_len + frame.size());
+    for (uint8_t shade : frame)
+    {
+        // shades are grey, so any colour channel will do
+        image.push_back((GAMEBOY::DEFAULT_SHADE_RGBA[shade] >> 24) & 0xFF);
+    }
+    return image;
+}
+
+/*
+ * 16-bit stereo PCM written as it arrives, the sizes in the header are
+ * filled in once the length is known
+ */
+class WavWriter
+{
+private:
+    FILE* m_file;
+    uint32_t m_data_bytes = 0;
+    std::vector<uint8_t> m_bytes;
+    void m_header(uint32_t sample_rate)
+    {
+        uint8_t header[44];
+        auto put = [&header](size_t offset, uint32_t value, size_t size)
+        {
+            for (size_t i=0; i<size; i++)
+            {
+                header[offset + i] = (value >> (i*8)) & 0xFF;
+            }
+        };
+        memcpy(header, "RIFF", 4);
+        put(4, 36 + m_data_bytes, 4);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        put(16, 16, 4);
+        // PCM, 2 channels
+        put(20, 1, 2);
+        put(22, 2, 2);
+        put(24, sample_rate, 4);
+        put(28, sample_rate*4, 4);
+        put(32, 4, 2);
+        put(34, 16, 2);
+        memcpy(header + 36, "data", 4);
+        put(40, m_data_bytes, 4);
+        fwrite(header, 1, sizeof(header), m_file);
+    }
+public:
+    const uint32_t sample_rate;
+    WavWriter(const std::string& path, uint32_t sample_rate)
+    : sample_rate(sample_rate)
+    {
+        m_file = fopen(path.c_str(), "wb");
+        if (m_file != nullptr)
+        {
+            m_header(sample_rate);
+        }
+    }
+    ~WavWriter()
+    {
+        close();
+    }
+    void write(const int16_t* samples, size_t frames)
+    {
+        if (m_file == nullptr)
+        {
+            return;
+        }
+        // WAV is little endian
+        m_bytes.resize(frames*4);
+        for (size_t i=0; i<frames*2; i++)
+        {
+            m_bytes[i*2] = samples[i] & 0xFF;
+            m_bytes[i*2 + 1] = (samples[i] >> 8) & 0xFF;
+        }
+        fwrite(m_bytes.data(), 1, m_bytes.size(), m_file);
+        m_data_bytes += m_bytes.size();
+    }
+    // Fill in the header's sizes, returns false if anything failed to write
+    bool close()
+    {
+        if (m_file == nullptr)
+        {
+            return false;
+        }
+        fseek(m_file, 0, SEEK_SET);
+        m_header(sample_rate);
+        bool ok = !ferror(m_file);
+        ok &= fclose(m_file) == 0;
+        m_file = nullptr;
+        return ok;
+    }
+};
+
+/*
+ * Runs copies of the ROM across the batch runner, for measuring
+ * aggregate throughput on all cores
+ */
+int run_batch(const Options& options, ROMDATA& rom, const std::string& title)
+{
+    GAMEBOY::FileInterface& files = GAMEBOY::FileInterface::standard();
+    GAMEBOY::BatchRunner runner(options.threads);
+    for (uint64_t i=0; i<options.instances; i++)
+    {
+        runner.add(rom, options.frames);
+    }
+    auto stats = runner.run();
+    std::string out_prefix = options.out_dir + "/";
+    bool write_failed = false;
+    write_failed |= !files.write(out_prefix + "frame.pgm", encode_pgm(runner.gameboy(0).frame()));
+    write_failed |= !files.write(out_prefix + "serial.txt", runner.serial(0));
+    char json[512];
+    int json_len = snprintf(json, sizeof(json),
+            "{\n"
+            "  \"title\": \"%s\",\n"
+            "  \"instances\": %lu,\n"
+            "  \"threads\": %lu,\n"
+            "  \"frames\": %lu,\n"
+            "  \"cycles\": %lu,\n"
+            "  \"steals\": %lu,\n"
+            "  \"seconds\": %.6f,\n"
+            "  \"frames_per_second\": %.2f,\n"
+            "  \"mcycles_per_second\": %.2f\n"
+            "}\n",
+            title.c_str(),
+            (unsigned long)stats.instances,
+            (unsigned long)stats.threads,
+            (unsigned long)stats.frames,
+            (unsigned long)stats.cycles,
+            (unsigned long)stats.steals,
+            stats.seconds,
+            stats.frames_per_second,
+            stats.seconds > 0 ? stats.cycles/4/stats.seconds : 0.0);
+    write_failed |= !files.write(out_prefix + "stats.json", std::vector<uint8_t>(json, json + json_len));
+    fwrite(json, 1, json_len, stdout);
+    if (write_failed)
+    {
+        GBEMU_LOG_ERROR("Failed to write output to %s\n", options.out_dir.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<Options> optionsopt = parse_args(argc, argv);
+    if (!optionsopt.has_value())
+    {
+        display_help(argv[0]);
+        return 1;
+    }
+    Options options = optionsopt.value();
+    if (std::getenv("DEBUG") != nullptr)
+    {
+        GAMEBOY::log_level(GAMEBOY::LOG_LEVEL::DEBUG);
+    }
+    GAMEBOY::FileInterface& files = GAMEBOY::FileInterface::standard();
+    std::optional<ROMDATA> romopt = open_rom(options.rom_path, files);
+    if (!romopt.has_value())
+    {
+        GBEMU_LOG_CRITICAL("ROM file could not be read, aborting\n");
+        return 1;
+    }
+    ROMDATA rom = romopt.value();
+    std::string title(rom.cbegin() + GAMEBOY::TITLE_BEGIN, rom.cbegin() + GAMEBOY::TITLE_END);
+    title = title.c_str();
+    for (char& c : title)
+    {
+        // keep the stats valid JSON
+        if (c < ' ' || c > '~' || c == '"' || c == '\\')
+        {
+            c = '?';
+        }
+    }
+    if (options.instances > 1)
+    {
+        return run_batch(options, rom, title);
+    }
+    SerialCapture serial;
+    GAMEBOY::SerialEventSupervisor::getInstance().subscribe(GAMEBOY::SerialEventType::SERIAL_OUT, &serial);
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    gameboy.render_thread(options.render_thread);
+    std::string out_prefix = options.out_dir + "/";
+    bool write_failed = false;
+    if (options.frame_every != 0)
+    {
+        gameboy.on_frame_ready(
+            [&](const GAMEBOY::FRAME_PIXELS& frame, uint64_t sequence)
+            {
+                if (sequence % options.frame_every != 0)
+                {
+                    return;
+                }
+                char name[32];
+                snprintf(name, sizeof(name), "frame_%06lu.pgm", (unsigned long)sequence);
+                write_failed |= !files.write(out_prefix + name, encode_pgm(frame));
+            });
+    }
+    std::optional<WavWriter> wav;
+    if (options.wav)
+    {
+        wav.emplace(out_prefix + "audio.wav", 48000);
+        gameboy.apu().on_samples(
+            [&wav](const int16_t* samples, size_t frames)
+            {
+                wav->write(samples, frames);
+            },
+            wav->sample_rate);
+    }
+    std::unique_ptr<GAMEBOY::TraceRecorder> tracer;
+    if (options.trace_path != nullptr)
+    {
+        try
+        {
+            tracer = std::make_unique<GAMEBOY::TraceRecorder>(options.trace_path, options.trace_memory);
+        }
+        catch (const std::exception& error)
+        {
+            GBEMU_LOG_CRITICAL("%s, aborting\n", error.what());
+            return 1;
+        }
+        gameboy.tracer(tracer.get());
+    }
+    std::optional<GAMEBOY::MoviePlayer> player;
+    if (options.movie_path != nullptr)
+    {
+        auto movie_file = files.read(options.movie_path);
+        if (!movie_file.has_value())
+        {
+            GBEMU_LOG_CRITICAL("Movie file could not be read, aborting\n");
+            return 1;
+        }
+        try
+        {
+            GAMEBOY::Movie movie = GAMEBOY::Movie::deserialize(movie_file.value());
+            if (!options.frames_set)
+            {
+                options.frames = movie.frame_hashes.size();
+            }
+            player.emplace(gameboy, input_handler, std::move(movie));
+        }
+        catch (const std::exception& error)
+        {
+            GBEMU_LOG_CRITICAL("%s, aborting\n", error.what());
+            return 1;
+        }
+    }
+    std::optional<GAMEBOY::Rewind> rewind;
+    if (options.rewind_mb != 0)
+    {
+        rewind.emplace(options.rewind_mb*1024*1024);
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames = 0;
+    if (options.cycles.has_value())
+    {
+        gameboy.run_cycles(options.cycles.value());
+        frames = gameboy.frame_sequence();
+    }
+    else
+    {
+        for (; frames<options.frames; frames++)
+        {
+            if (player.has_value())
+            {
+                player->run_frame();
+                player->frame();
+                continue;
+            }
+            gameboy.run_frame();
+            if (rewind.has_value())
+            {
+                rewind->capture(gameboy);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t cycles = gameboy.cycles();
+    write_failed |= !files.write(out_prefix + "frame.pgm", encode_pgm(gameboy.frame()));
+    write_failed |= !files.write(out_prefix + "serial.txt", serial.data);
+    if (wav.has_value())
+    {
+        gameboy.apu().flush();
+        write_failed |= !wav->close();
+    }
+    char trace_stats[64] = "";
+    if (tracer)
+    {
+        gameboy.tracer(nullptr);
+        write_failed |= !tracer->close();
+        snprintf(trace_stats, sizeof(trace_stats), ",\n  \"trace_stalls\": %lu",
+            (unsigned long)tracer->stalls());
+    }
+    char rewind_stats[256] = "";
+    if (rewind.has_value() && rewind->stats().captures != 0)
+    {
+        const auto& stats = rewind->stats();
+        double capture_us = stats.capture_ns/1000.0/stats.captures;
+        // against the 16.74ms a frame takes on hardware
+        snprintf(rewind_stats, sizeof(rewind_stats),
+            ",\n"
+            "  \"rewind_capture_us\": %.2f,\n"
+            "  \"rewind_frame_percent\": %.3f,\n"
+            "  \"rewind_history\": %lu,\n"
+            "  \"rewind_bytes\": %lu",
+            capture_us,
+            capture_us/16742.706*100,
+            (unsigned long)stats.history,
+            (unsigned long)stats.used_bytes);
+    }
+    char counter_stats[384] = "";
+    if (GAMEBOY::Stats::ENABLED)
+    {
+        GAMEBOY::Stats counters = gameboy.stats();
+        std::string summary = counters.summary();
+        write_failed |= !files.write(out_prefix + "counters.txt", std::vector<uint8_t>(summary.cbegin(), summary.cend()));
+        uint64_t tile_lookups = counters.tile_cache_hits + counters.tile_cache_misses;
+        snprintf(counter_stats, sizeof(counter_stats),
+            ",\n"
+            "  \"instructions\": %lu,\n"
+            "  \"halt_percent\": %.2f,\n"
+            "  \"tile_cache_hit_percent\": %.2f,\n"
+            "  \"tile_cache_invalidations\": %lu,\n"
+            "  \"lines_rendered\": %lu,\n"
+            "  \"dma_transfers\": %lu",
+            (unsigned long)counters.instructions,
+            counters.mcycles > 0 ? 100.0*counters.halt_mcycles/counters.mcycles : 0.0,
+            tile_lookups > 0 ? 100.0*counters.tile_cache_hits/tile_lookups : 0.0,
+            (unsigned long)counters.tile_cache_invalidations,
+            (unsigned long)counters.lines_rendered,
+            (unsigned long)counters.dma_transfers);
+    }
+    char movie_stats[64] = "";
+    if (player.has_value())
+    {
+        snprintf(movie_stats, sizeof(movie_stats), ",\n  \"movie_desyncs\": %lu",
+            (unsigned long)player->desyncs());
+    }
+    char stats[1280];
+    int stats_len = snprintf(stats, sizeof(stats),
+            "{\n"
+            "  \"title\": \"%s\",\n"
+            "  \"frames\": %lu,\n"
+            "  \"cycles\": %lu,\n"
+            "  \"seconds\": %.6f,\n"
+            "  \"frames_per_second\": %.2f,\n"
+            "  \"mcycles_per_second\": %.2f%s%s%s%s\n"
+            "}\n",
+            title.c_str(),
+            (unsigned long)frames,
+            (unsigned long)cycles,
+            seconds,
+            seconds > 0 ? frames/seconds : 0.0,
+            seconds > 0 ? cycles/4/seconds : 0.0,
+            counter_stats,
+            rewind_stats,
+            movie_stats,
+            trace_stats);
+    write_failed |= !files.write(out_prefix + "stats.json", std::vector<uint8_t>(stats, stats + stats_len));
+    fwrite(stats, 1, stats_len, stdout);
+    if (write_failed)
+    {
+        GBEMU_LOG_ERROR("Failed to write output to %s\n", options.out_dir.c_str());
+        return 1;
+    }
+    if (player.has_value() && player->desyncs() != 0)
+    {
+        GBEMU_LOG_ERROR("Movie desynced on %lu frames\n", (unsigned long)player->desyncs());
+        return 1;
+    }
+    return 0;
+}
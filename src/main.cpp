@@ -1,13 +1,27 @@
 #include <stdio.h>
 #include <SDL2/SDL.h>
+#include <atomic>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string.h>
+#include <thread>
+#include <vector>
 
+#include "audio.h"
+#include "pacer.h"
 #include "render.h"
 #include "gameboy/rom.h"
 #include "gameboy/gameboy.h"
 #include "gameboy/serial.h"
 #include "gameboy/input.h"
+#include "gameboy/file.h"
+#include "gameboy/log.h"
+#include "gameboy/movie.h"
+#include "gameboy/rewind.h"
 
 class SerialPrinter: public GAMEBOY::SerialEventSubscriber
 {
@@ -22,7 +36,10 @@ void display_help(char* exec_name)
 {
     printf("Missing or incorrect launch parameters.\n");
     printf("Need rom file path to load.\n\n");
-    printf("Usage: %s rom_file\n", exec_name);
+    printf("Usage: %s [--record movie_file | --play movie_file] rom_file\n", exec_name);
+    printf("Hold R to rewind, except while recording or playing a movie\n");
+    printf("Press I to log the emulator's performance counters\n");
+    printf("Hold Tab to fast-forward, - and = halve and double the speed, 0 resets it\n");
 }
 
 std::optional<GAMEBOY::InputHandler::BUTTON> map_key(SDL_Keycode key)
@@ -57,10 +74,94 @@ std::optional<GAMEBOY::InputHandler::BUTTON> map_key(SDL_Keycode key)
     return {};
 }
 
+/*
+ * Adaptive frame skip measures against real time at normal speed, when
+ * running faster only the frames which can be shown are drawn. Movies
+ * hash every frame, so nothing is skipped while one records or plays
+ */
+void update_frameskip(GAMEBOY::Gameboy& gameboy, FramePacer& pacer, bool movie)
+{
+    GAMEBOY::PPU_FrameSkip& frameskip = gameboy.frameskip();
+    if (movie)
+    {
+        frameskip.mode(GAMEBOY::PPU_FrameSkip::MODE::OFF);
+    }
+    else if (pacer.uncapped())
+    {
+        frameskip.mode(GAMEBOY::PPU_FrameSkip::MODE::FIXED);
+        frameskip.interval(8);
+    }
+    else if (pacer.speed() > 1.0)
+    {
+        frameskip.mode(GAMEBOY::PPU_FrameSkip::MODE::FIXED);
+        frameskip.interval(static_cast<uint32_t>(pacer.speed()));
+    }
+    else if (pacer.speed() < 1.0)
+    {
+        // adaptive skipping measures against 1x, so slow motion would always look behind
+        frameskip.mode(GAMEBOY::PPU_FrameSkip::MODE::OFF);
+    }
+    else
+    {
+        frameskip.mode(GAMEBOY::PPU_FrameSkip::MODE::ADAPTIVE);
+    }
+}
+
+SDL_LogPriority sdl_priority(GAMEBOY::LOG_LEVEL level)
+{
+    switch (level)
+    {
+        case GAMEBOY::LOG_LEVEL::DEBUG:
+            return SDL_LOG_PRIORITY_DEBUG;
+        case GAMEBOY::LOG_LEVEL::INFO:
+            return SDL_LOG_PRIORITY_INFO;
+        case GAMEBOY::LOG_LEVEL::WARN:
+            return SDL_LOG_PRIORITY_WARN;
+        case GAMEBOY::LOG_LEVEL::ERROR:
+            return SDL_LOG_PRIORITY_ERROR;
+        case GAMEBOY::LOG_LEVEL::CRITICAL:
+        default:
+            return SDL_LOG_PRIORITY_CRITICAL;
+    }
+}
+
 int main(int argc, char** argv)
 {
-    SDL_Init(SDL_INIT_VIDEO|SDL_INIT_TIMER);
-    auto line_buffer = std::make_shared<GAMEBOY::LINE_PIXELS>();
+    const char* rom_path = nullptr;
+    const char* record_path = nullptr;
+    const char* play_path = nullptr;
+    for (int i=1; i<argc; i++)
+    {
+        if (!strcmp(argv[i], "--record") && i+1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--play") && i+1 < argc)
+        {
+            play_path = argv[++i];
+        }
+        else if (argv[i][0] != '-' && rom_path == nullptr)
+        {
+            rom_path = argv[i];
+        }
+        else
+        {
+            display_help(argv[0]);
+            return -1;
+        }
+    }
+    if (record_path != nullptr && play_path != nullptr)
+    {
+        display_help(argv[0]);
+        return -1;
+    }
+    // route core logging through SDL alongside the frontend's
+    GAMEBOY::log_sink(
+        [](GAMEBOY::LOG_LEVEL level, const char* message)
+        {
+            SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, sdl_priority(level), "%s", message);
+        });
+    SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO|SDL_INIT_TIMER);
     SDL_Window* win = SDL_CreateWindow(
             "GBEMU",
             SDL_WINDOWPOS_UNDEFINED,
@@ -73,17 +174,19 @@ int main(int argc, char** argv)
         SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "SDL Window could not be created, aborting\n");
         return -1;
     }
-    Renderer renderer(line_buffer, win);
     SDL_Event event;
     std::optional<ROMDATA> romopt;
+    std::string rom_file;
     char* debug_env = std::getenv("DEBUG");
     if (debug_env != nullptr)
     {
         SDL_LogSetAllPriority(SDL_LOG_PRIORITY_DEBUG);
+        GAMEBOY::log_level(GAMEBOY::LOG_LEVEL::DEBUG);
     }
-    if (argc==2)
+    if (rom_path != nullptr)
     {
-        romopt = open_rom(argv[1]);
+        romopt = open_rom(rom_path);
+        rom_file = rom_path;
     }
     else
     {
@@ -101,6 +204,7 @@ int main(int argc, char** argv)
                 {
                     auto fname = event.drop.file;
                     romopt = open_rom(fname);
+                    rom_file = fname;
                     free(fname);
                     if (romopt.has_value())
                     {
@@ -127,55 +231,255 @@ int main(int argc, char** argv)
     auto& serialSupervisor = GAMEBOY::SerialEventSupervisor::getInstance();
     serialSupervisor.subscribe(GAMEBOY::SerialEventType::SERIAL_OUT, new SerialPrinter());
     GAMEBOY::InputHandler input_handler;
-    GAMEBOY::Gameboy gameboy(rom, input_handler, line_buffer);
-    uint64_t frame_start;
-    int64_t frame_time;
-    const int64_t min_frame_time = 1000/60;
-    bool quit = false;
-    while (!quit)
+    AudioOutput audio;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    // draw lines alongside the CPU, leaving more of each frame for fast-forward
+    gameboy.render_thread(true);
+    if (audio.open())
+    {
+        gameboy.apu().on_samples(
+            [&audio](const int16_t* samples, size_t frames)
+            {
+                audio.submit(samples, frames);
+            },
+            audio.sample_rate());
+    }
+    else
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "No audio device, running without sound: %s\n", SDL_GetError());
+    }
+    auto renderer = std::make_unique<Renderer>(win);
+    gameboy.on_frame_ready(
+        [&renderer](const GAMEBOY::FRAME_PIXELS& frame, uint64_t)
+        {
+            renderer->submit_frame(frame);
+        });
+    FramePacer pacer;
+    // a snapshot every frame, a minute or more of history
+    GAMEBOY::Rewind rewind(16*1024*1024);
+    bool rewinding = false;
+    GAMEBOY::FileInterface& files = GAMEBOY::FileInterface::standard();
+    std::optional<GAMEBOY::MovieRecorder> recorder;
+    std::optional<GAMEBOY::MoviePlayer> player;
+    if (record_path != nullptr)
     {
-        frame_start = SDL_GetTicks64();
-        while (SDL_PollEvent(&event))
+        recorder.emplace(gameboy, input_handler);
+    }
+    if (play_path != nullptr)
+    {
+        auto movie_file = files.read(play_path);
+        try
+        {
+            if (!movie_file.has_value())
+            {
+                throw std::invalid_argument("Movie file could not be read");
+            }
+            player.emplace(gameboy, input_handler, GAMEBOY::Movie::deserialize(movie_file.value()));
+        }
+        catch (const std::exception& error)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "%s, aborting\n", error.what());
+            return -1;
+        }
+    }
+    bool movie = recorder || player;
+    // skip drawing frames rather than slowing down when the host can't keep up
+    update_frameskip(gameboy, pacer, movie);
+    // movies start from power on, so don't touch the battery save
+    std::string battery_path = std::filesystem::path(rom_file).replace_extension(".sav").string();
+    bool use_battery = !movie;
+    if (use_battery)
+    {
+        auto battery = files.read(battery_path);
+        try
+        {
+            if (battery.has_value())
+            {
+                gameboy.load_battery(battery.value(), std::time(nullptr));
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loaded battery save %s\n", battery_path.c_str());
+            }
+        }
+        catch (const std::exception& error)
+        {
+            // leave the file alone rather than overwrite it at exit
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s: %s\n", battery_path.c_str(), error.what());
+            use_battery = false;
+        }
+    }
+    /*
+     * The emulator runs on its own thread, paced to real time, while this
+     * thread owns the window. It presents each frame as it's queued and
+     * hands key presses over to be handled between frames
+     */
+    std::atomic<bool> quit{false};
+    std::mutex key_mutex;
+    std::vector<SDL_KeyboardEvent> key_events;
+    std::thread emulator([&]() {
+        std::vector<SDL_KeyboardEvent> keys;
+        while (!quit)
         {
-            if (event.type == SDL_QUIT)
             {
-                quit = true;
+                std::lock_guard<std::mutex> lock(key_mutex);
+                keys.swap(key_events);
             }
-            if (event.type == SDL_KEYDOWN && event.key.repeat == 0)
+            for (const SDL_KeyboardEvent& key : keys)
             {
-                auto btn = map_key(event.key.keysym.sym);
-                if (btn.has_value())
+                if ((key.type == SDL_KEYDOWN || key.type == SDL_KEYUP)
+                    && key.keysym.sym == SDLK_r && !recorder && !player)
+                {
+                    rewinding = key.type == SDL_KEYDOWN;
+                }
+                if (key.type == SDL_KEYDOWN && key.repeat == 0
+                    && key.keysym.sym == SDLK_i)
+                {
+                    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s", gameboy.stats().summary().c_str());
+                }
+                if ((key.type == SDL_KEYDOWN || key.type == SDL_KEYUP)
+                    && key.keysym.sym == SDLK_TAB && key.repeat == 0)
+                {
+                    pacer.uncapped(key.type == SDL_KEYDOWN);
+                    update_frameskip(gameboy, pacer, movie);
+                }
+                if (key.type == SDL_KEYDOWN && key.repeat == 0)
                 {
-                    input_handler.btn_down(btn.value());
+                    double speed = pacer.speed();
+                    switch (key.keysym.sym)
+                    {
+                        case SDLK_MINUS:
+                            pacer.speed(speed/2);
+                            break;
+                        case SDLK_EQUALS:
+                            pacer.speed(speed*2);
+                            break;
+                        case SDLK_0:
+                            pacer.speed(1.0);
+                            break;
+                    }
+                    if (pacer.speed() != speed)
+                    {
+                        update_frameskip(gameboy, pacer, movie);
+                        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Speed %gx\n", pacer.speed());
+                    }
+                }
+                // the movie being played has control of the buttons
+                if ((key.type == SDL_KEYDOWN || key.type == SDL_KEYUP)
+                    && key.repeat == 0 && !player)
+                {
+                    auto btn = map_key(key.keysym.sym);
+                    bool pressed = key.type == SDL_KEYDOWN;
+                    if (btn.has_value() && recorder)
+                    {
+                        recorder->button(btn.value(), pressed);
+                    }
+                    else if (btn.has_value() && pressed)
+                    {
+                        input_handler.btn_down(btn.value());
+                    }
+                    else if (btn.has_value())
+                    {
+                        input_handler.btn_up(btn.value());
+                    }
                 }
             }
-            if (event.type == SDL_KEYUP && event.key.repeat == 0)
+            keys.clear();
+            if (rewinding)
             {
-                auto btn = map_key(event.key.keysym.sym);
-                if (btn.has_value())
+                // step back a frame at a time, the loaded frame isn't reported
+                // through on_frame_ready so is shown directly
+                if (rewind.step_back(gameboy))
                 {
-                    input_handler.btn_up(btn.value());
+                    renderer->submit_frame(gameboy.frame());
                 }
             }
-        }
-        for (int lines=0; lines<160;)
-        {
-            if (SDL_GetTicks64() - frame_start > min_frame_time * 2)
+            else if (player)
             {
-                break;
+                player->run_frame();
+                if (!player->frame())
+                {
+                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Movie desync at frame %lu\n",
+                        (unsigned long)gameboy.frame_sequence());
+                }
+                if (player->finished())
+                {
+                    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Movie finished, %lu desyncs\n",
+                        (unsigned long)player->desyncs());
+                    player.reset();
+                }
             }
-            if (gameboy.tick())
+            else
             {
-                renderer.add_line();
-                lines++;
+                // also returns after a frame's worth of cycles while the LCD is off
+                gameboy.run_frame();
+                if (recorder)
+                {
+                    recorder->frame();
+                }
+                else
+                {
+                    rewind.capture(gameboy);
+                }
             }
+            pacer.wait();
+        }
+    });
+    while (!quit)
+    {
+        if (!SDL_WaitEvent(&event))
+        {
+            continue;
+        }
+        if (event.type == SDL_QUIT)
+        {
+            quit = true;
         }
-        frame_time = SDL_GetTicks64() - frame_start;
-        if (frame_time < min_frame_time)
+        else if (event.type == renderer->frame_event())
         {
-            SDL_Delay(min_frame_time - frame_time);
+            renderer->present();
         }
+        else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP)
+        {
+            std::lock_guard<std::mutex> lock(key_mutex);
+            key_events.push_back(event.key);
+        }
+    }
+    emulator.join();
+    if (recorder)
+    {
+        std::vector<uint8_t> movie_file;
+        recorder->movie().serialize(movie_file);
+        if (!files.write(record_path, movie_file))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Movie could not be written to %s\n", record_path);
+        }
+    }
+    if (use_battery)
+    {
+        std::vector<uint8_t> battery = gameboy.save_battery(std::time(nullptr));
+        if (!battery.empty() && !files.write(battery_path, battery))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Battery save could not be written to %s\n", battery_path.c_str());
+        }
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s", gameboy.stats().summary().c_str());
+    if (audio.underruns() != 0 || audio.dropped_frames() != 0)
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Audio: %lu underruns, %lu frames dropped\n",
+            (unsigned long)audio.underruns(), (unsigned long)audio.dropped_frames());
+    }
+    if (pacer.resyncs() != 0)
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Fell behind real time %lu times\n",
+            (unsigned long)pacer.resyncs());
+    }
+    const auto& rewind_stats = rewind.stats();
+    if (rewind_stats.captures != 0)
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Rewind: %.1fus per snapshot, %lu snapshots in %lu bytes\n",
+            rewind_stats.capture_ns/1000.0/rewind_stats.captures,
+            (unsigned long)rewind_stats.history, (unsigned long)rewind_stats.used_bytes);
     }
+    // the renderer is destroyed before SDL is shut down
+    renderer.reset();
     SDL_Quit();
     return 0;
 }
@@ -0,0 +1,69 @@
+#include "pacer.h"
+#include <algorithm>
+#include <thread>
+
+constexpr std::chrono::nanoseconds FramePacer::FRAME_TIME;
+constexpr std::chrono::nanoseconds FramePacer::m_SPIN_TAIL;
+
+FramePacer::FramePacer()
+{
+    reset();
+}
+
+void FramePacer::wait()
+{
+    CLOCK::time_point now = CLOCK::now();
+    if (m_uncapped)
+    {
+        m_deadline = now;
+        return;
+    }
+    auto frame_time = std::chrono::duration_cast<CLOCK::duration>(FRAME_TIME/m_speed);
+    m_deadline += frame_time;
+    if (now > m_deadline + m_RESYNC_FRAMES*frame_time)
+    {
+        m_resyncs++;
+        m_deadline = now;
+        return;
+    }
+    if (m_deadline - now > m_SPIN_TAIL)
+    {
+        std::this_thread::sleep_until(m_deadline - m_SPIN_TAIL);
+    }
+    while (CLOCK::now() < m_deadline) {}
+}
+
+void FramePacer::reset()
+{
+    m_deadline = CLOCK::now();
+}
+
+void FramePacer::speed(double multiplier)
+{
+    m_speed = std::clamp(multiplier, 1.0/16, 16.0);
+}
+
+double FramePacer::speed()
+{
+    return m_speed;
+}
+
+void FramePacer::uncapped(bool uncapped)
+{
+    // pacing resumes from when fast-forward ends
+    if (m_uncapped && !uncapped)
+    {
+        reset();
+    }
+    m_uncapped = uncapped;
+}
+
+bool FramePacer::uncapped()
+{
+    return m_uncapped;
+}
+
+uint64_t FramePacer::resyncs()
+{
+    return m_resyncs;
+}
@@ -1,8 +1,7 @@
 #include "render.h"
-#include <array>
 
-Renderer::Renderer(std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer, SDL_Window* win)
-: m_line_buffer(line_buffer)
+Renderer::Renderer(SDL_Window* win)
+: m_screen_buffer(GB_W * GB_H)
 {
     m_sdl_renderer = SDL_CreateRenderer(
             win,
@@ -14,56 +13,49 @@ Renderer::Renderer(std::shared_ptr<GAMEBOY::LINE_PIXELS> line_buffer, SDL_Window
             SDL_TEXTUREACCESS_STREAMING,
             GB_W,
             GB_H);
-    m_screen_buffer = new uint32_t[GB_W * GB_H];
+    m_frame_event = SDL_RegisterEvents(1);
 }
 
 Renderer::~Renderer()
 {
-    delete[] m_screen_buffer;
-    // probably need to delete texture and renderer
-    // check the order that they will need to be destroyed
-    // (alongside the window too, unsure if there will be issues)
+    SDL_DestroyTexture(m_sdl_texture);
+    SDL_DestroyRenderer(m_sdl_renderer);
 }
 
-inline uint32_t gb2bpp_to_rgba(uint8_t gbpix)
+bool Renderer::submit_frame(const GAMEBOY::FRAME_PIXELS& frame)
 {
-    switch(gbpix)
+    if (!m_frames.push(frame))
     {
-        case 0:
-            return 0xFFFFFF88;
-        case 1:
-            return 0xB8B8B888;
-        case 2:
-            return 0x68686888;
-        case 3:
-            return 0x00000088;
-        default:
-            return 0xFFFFFF88;
+        ++m_dropped;
+        return false;
     }
+    SDL_Event event = {};
+    event.type = m_frame_event;
+    SDL_PushEvent(&event);
+    return true;
 }
 
-bool Renderer::add_line()
+bool Renderer::present()
 {
-    SDL_LockTexture(m_sdl_texture, NULL, (void**)&m_screen_buffer, &m_buffer_pitch);
-    int base_index = GB_W * m_current_line;
-    // copy line to screen buffer until full
-    for (int i=0; i<GB_W; i++)
+    if (!m_frames.pop(m_frame))
     {
-        uint32_t pixel = gb2bpp_to_rgba((*m_line_buffer)[i]);
-        m_screen_buffer[base_index + i] = pixel;
+        return false;
     }
-    SDL_UnlockTexture(m_sdl_texture);
-    if (++m_current_line == GB_H)
+    // only the newest frame is worth presenting
+    while (m_frames.pop(m_frame)) {}
+    for (size_t i=0; i<m_frame.size(); i++)
     {
-        // copy screen buffer to texture
-        SDL_SetRenderDrawColor(m_sdl_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-        SDL_RenderClear(m_sdl_renderer);
-        SDL_Rect render_quad = {0, 0, GB_W, GB_H};
-        //SDL_RenderCopyEx(m_sdl_renderer, m_sdl_texture, NULL, &render_quad, 0.0, NULL, SDL_FLIP_NONE);
-        SDL_RenderCopy(m_sdl_renderer, m_sdl_texture, NULL, NULL);
-        SDL_RenderPresent(m_sdl_renderer);
-        m_current_line = 0;
-        return true;
+        m_screen_buffer[i] = m_SHADE_RGBA[m_frame[i] & 0x03];
     }
-    return false;
+    SDL_UpdateTexture(m_sdl_texture, NULL, m_screen_buffer.data(), GB_W * sizeof(uint32_t));
+    SDL_SetRenderDrawColor(m_sdl_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderClear(m_sdl_renderer);
+    SDL_RenderCopy(m_sdl_renderer, m_sdl_texture, NULL, NULL);
+    SDL_RenderPresent(m_sdl_renderer);
+    return true;
+}
+
+uint64_t Renderer::dropped_frames()
+{
+    return m_dropped;
 }
@@ -0,0 +1,188 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+#include "gameboy/cpu_disasm.h"
+#include "gameboy/trace.h"
+
+/*
+ * Converts a range of a binary trace recorded by gbemu_headless --trace
+ * to text, one line per record. The trace is mapped rather than read,
+ * so a range near the end of a large trace costs no more than the start
+ */
+
+struct Options
+{
+    const char* trace_path = nullptr;
+    uint64_t from = 0;
+    std::optional<uint64_t> count;
+    std::optional<uint64_t> frame;
+    uint64_t frames = 1;
+    // mnemonics in place of the registers
+    bool disasm = false;
+};
+
+void display_help(char* exec_name)
+{
+    printf("Missing or incorrect launch parameters.\n\n");
+    printf("Usage: %s [options] trace_file\n", exec_name);
+    printf("  --from N    start at record N (default 0)\n");
+    printf("  --count N   convert N records (default to the end)\n");
+    printf("  --frame F   start at the VBlank beginning frame F\n");
+    printf("  --frames N  with --frame, convert N frames (default 1)\n");
+    printf("  --disasm    disassemble instructions instead of listing registers\n");
+}
+
+std::optional<Options> parse_args(int argc, char** argv)
+{
+    Options options;
+    for (int i=1; i<argc; i++)
+    {
+        bool has_value = i+1 < argc;
+        if (!strcmp(argv[i], "--from") && has_value)
+        {
+            options.from = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--count") && has_value)
+        {
+            options.count = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--frame") && has_value)
+        {
+            options.frame = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--frames") && has_value)
+        {
+            options.frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--disasm"))
+        {
+            options.disasm = true;
+        }
+        else if (argv[i][0] != '-' && options.trace_path == nullptr)
+        {
+            options.trace_path = argv[i];
+        }
+        else
+        {
+            return {};
+        }
+    }
+    if (options.trace_path == nullptr)
+    {
+        return {};
+    }
+    // a range is either records or frames
+    if (options.frame.has_value() && (options.from != 0 || options.count.has_value()))
+    {
+        return {};
+    }
+    return options;
+}
+
+void print_record(const GAMEBOY::TraceRecord& record, bool disasm)
+{
+    printf("%12lu %02X:%04X  ", (unsigned long)record.cycle, record.bank, record.pc);
+    switch (record.kind)
+    {
+        case GAMEBOY::TraceKind::INSTRUCTION:
+        {
+            uint8_t length = GAMEBOY::instruction_length(record.opcode);
+            char bytes[12];
+            int used = snprintf(bytes, sizeof(bytes), "%02X", record.opcode);
+            for (uint8_t i=1; i<length; i++)
+            {
+                used += snprintf(bytes + used, sizeof(bytes) - used, " %02X", record.operands[i - 1]);
+            }
+            if (disasm)
+            {
+                std::string text = GAMEBOY::disassemble(record.pc, record.opcode, record.operands[0], record.operands[1]);
+                printf("%-9s %s\n", bytes, text.c_str());
+                break;
+            }
+            printf("%-9s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X IME=%u\n",
+                bytes, record.af, record.bc, record.de, record.hl, record.sp, record.ime);
+            break;
+        }
+        case GAMEBOY::TraceKind::INTERRUPT:
+            printf("INT $%04X\n", record.addr);
+            break;
+        case GAMEBOY::TraceKind::READ:
+            printf("          read  $%04X -> $%02X\n", record.addr, record.data);
+            break;
+        case GAMEBOY::TraceKind::WRITE:
+            printf("          write $%04X <- $%02X\n", record.addr, record.data);
+            break;
+        case GAMEBOY::TraceKind::FRAME:
+            printf("VBLANK\n");
+            break;
+        default:
+            printf("unknown record %u\n", static_cast<unsigned>(record.kind));
+            break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<Options> optionsopt = parse_args(argc, argv);
+    if (!optionsopt.has_value())
+    {
+        display_help(argv[0]);
+        return 1;
+    }
+    Options options = optionsopt.value();
+    int fd = open(options.trace_path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        fprintf(stderr, "Trace file could not be opened\n");
+        return 1;
+    }
+    size_t size = info.st_size;
+    void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Trace file could not be mapped\n");
+        return 1;
+    }
+    int result = 0;
+    try
+    {
+        GAMEBOY::TraceReader reader(static_cast<const uint8_t*>(data), size);
+        uint64_t begin = options.from;
+        uint64_t end = reader.size();
+        if (options.count.has_value() && options.count.value() < end - std::min(begin, end))
+        {
+            end = begin + options.count.value();
+        }
+        if (options.frame.has_value())
+        {
+            uint64_t frame = options.frame.value();
+            begin = reader.frame_start(frame);
+            if (frame + options.frames < reader.frames())
+            {
+                end = reader.frame_start(frame + options.frames);
+            }
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+        for (uint64_t i=begin; i<end; i++)
+        {
+            print_record(reader[i], options.disasm);
+        }
+    }
+    catch (const std::exception& error)
+    {
+        fprintf(stderr, "%s\n", error.what());
+        result = 1;
+    }
+    munmap(data, size);
+    return result;
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/apu.h"
+#include "gameboy/apu_synth.h"
+#include "gameboy/scheduler.h"
+#include "gameboy/state.h"
+
+using GAMEBOY::APU;
+
+TEST(APU_test, ReadMasks) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    // boot ROM state, channel 1 still on
+    EXPECT_EQ(apu.read(APU::NR52), 0xF1);
+    apu.write(APU::NR11, 0x00);
+    EXPECT_EQ(apu.read(APU::NR11), 0x3F);
+    apu.write(APU::NR13, 0x12);
+    EXPECT_EQ(apu.read(APU::NR13), 0xFF);
+    apu.write(APU::NR50, 0x12);
+    EXPECT_EQ(apu.read(APU::NR50), 0x12);
+    // unused registers between NR52 and wave RAM
+    EXPECT_EQ(apu.read(0xFF27), 0xFF);
+    apu.write(APU::WAVE_RAM_LO, 0xA5);
+    EXPECT_EQ(apu.read(APU::WAVE_RAM_LO), 0xA5);
+}
+
+TEST(APU_test, TriggerAndLength) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    apu.write(APU::NR12, 0x00);
+    EXPECT_EQ(apu.read(APU::NR52), 0xF0);
+    apu.write(APU::NR22, 0xF0);
+    // 2 steps of length remaining, with length enabled
+    apu.write(APU::NR21, 0x3E);
+    apu.write(APU::NR24, 0xC0);
+    EXPECT_EQ(apu.read(APU::NR52), 0xF2);
+    // lengths count at 256Hz, every other 8192 cycle step
+    scheduler.advance(8192*4);
+    EXPECT_EQ(apu.read(APU::NR52), 0xF0);
+}
+
+TEST(APU_test, DacOffDisablesChannel) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    apu.write(APU::NR30, 0x80);
+    apu.write(APU::NR34, 0x80);
+    EXPECT_EQ(apu.read(APU::NR52) & 0x04, 0x04);
+    apu.write(APU::NR30, 0x00);
+    EXPECT_EQ(apu.read(APU::NR52) & 0x04, 0x00);
+}
+
+TEST(APU_test, PowerOff) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    apu.write(APU::WAVE_RAM_LO, 0x5A);
+    apu.write(APU::NR52, 0x00);
+    EXPECT_EQ(apu.read(APU::NR52), 0x70);
+    EXPECT_EQ(apu.read(APU::NR50), 0x00);
+    EXPECT_EQ(apu.read(APU::NR51), 0x00);
+    // registers ignore writes while off, wave RAM is kept
+    apu.write(APU::NR50, 0x77);
+    EXPECT_EQ(apu.read(APU::NR50), 0x00);
+    EXPECT_EQ(apu.read(APU::WAVE_RAM_LO), 0x5A);
+    apu.write(APU::NR52, 0x80);
+    apu.write(APU::NR50, 0x77);
+    EXPECT_EQ(apu.read(APU::NR50), 0x77);
+}
+
+TEST(APU_test, SquareWaveFrequency) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    std::vector<int16_t> left;
+    std::vector<int16_t> right;
+    apu.on_samples([&](const int16_t* samples, size_t frames) {
+        for (size_t i=0; i<frames; i++)
+        {
+            left.push_back(samples[i*2]);
+            right.push_back(samples[i*2 + 1]);
+        }
+    }, 48000);
+    apu.write(APU::NR12, 0x00);
+    // channel 2 to the left only, 50% duty, 131072/(2048 - 1920) = 1024Hz
+    apu.write(APU::NR51, 0x20);
+    apu.write(APU::NR21, 0x80);
+    apu.write(APU::NR22, 0xF0);
+    apu.write(APU::NR23, 1920 & 0xFF);
+    apu.write(APU::NR24, 0x80 | (1920 >> 8));
+    scheduler.advance(APU::CLOCK_RATE);
+    apu.flush();
+    EXPECT_NEAR(left.size(), 48000, 48);
+    size_t crossings = 0;
+    for (size_t i=1; i<left.size(); i++)
+    {
+        crossings += left[i - 1] < 0 && left[i] >= 0;
+    }
+    EXPECT_NEAR(crossings, 1024, 2);
+    for (int16_t sample : right)
+    {
+        EXPECT_EQ(sample, 0);
+    }
+}
+
+TEST(APU_test, BandlimitedLongFrame) {
+    // 64 samples of room, but a frame of about 500 samples
+    GAMEBOY::BandlimitedBuffer small(4194304, 48000, 64);
+    GAMEBOY::BandlimitedBuffer large(4194304, 48000, 1024);
+    for (uint32_t time=1000; time<40000; time+=5000)
+    {
+        small.add_delta(time, 1000.0f);
+        large.add_delta(time, 1000.0f);
+    }
+    small.end_frame(44000);
+    large.end_frame(44000);
+    ASSERT_EQ(small.available(), large.available());
+    std::vector<int16_t> expected(large.available());
+    std::vector<int16_t> samples(small.available());
+    large.read(expected.data(), expected.size());
+    small.read(samples.data(), samples.size());
+    EXPECT_EQ(samples, expected);
+    // the last step, at sample 412, was kept rather than dropped
+    EXPECT_GT(samples[420] - samples[404], 500);
+}
+
+TEST(APU_test, SaveState) {
+    GAMEBOY::Scheduler scheduler;
+    APU apu(scheduler);
+    apu.write(APU::NR22, 0xF3);
+    apu.write(APU::NR21, 0x20);
+    apu.write(APU::NR24, 0xC7);
+    scheduler.advance(8192*3);
+    std::vector<uint8_t> data;
+    GAMEBOY::StateWriter writer(data);
+    apu.save_state(writer);
+
+    GAMEBOY::Scheduler restored_scheduler;
+    restored_scheduler.advance(8192*3);
+    APU restored(restored_scheduler);
+    GAMEBOY::StateReader reader(data);
+    restored.load_state(reader);
+    for (uint16_t addr=APU::REG_LO; addr<=APU::REG_HI; addr++)
+    {
+        EXPECT_EQ(apu.read(addr), restored.read(addr)) << std::hex << addr;
+    }
+    // lengths carry on counting down together
+    scheduler.advance(8192*64);
+    restored_scheduler.advance(8192*64);
+    EXPECT_EQ(apu.read(APU::NR52), restored.read(APU::NR52));
+    EXPECT_EQ(apu.read(APU::NR52) & 0x02, 0x00);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/batch.h"
+#include "test_rom.h"
+
+// Sends id over serial, then copies TIMA & LY across memory from VRAM
+static ROMDATA batch_test_rom(uint8_t id)
+{
+    // LD A,id; LDH (0x01),A; LD A,0x81; LDH (0x02),A
+    return busy_test_rom({0x3E, id, 0xE0, 0x01, 0x3E, 0x81, 0xE0, 0x02});
+}
+
+TEST(BatchRunner_test, MatchesSequentialRuns) {
+    const size_t instances = 7;
+    GAMEBOY::BatchRunner runner(3);
+    std::vector<ROMDATA> roms;
+    for (size_t i=0; i<instances; i++)
+    {
+        roms.push_back(batch_test_rom(0x40 + i));
+    }
+    for (size_t i=0; i<instances; i++)
+    {
+        // uneven lengths, so workers run out and steal
+        runner.add(roms[i], 4 + i*3);
+    }
+    auto stats = runner.run(2);
+    EXPECT_EQ(stats.instances, instances);
+    EXPECT_EQ(stats.threads, 3);
+    uint64_t frames = 0;
+    for (size_t i=0; i<instances; i++)
+    {
+        frames += 4 + i*3;
+        EXPECT_EQ(runner.frames_run(i), 4 + i*3);
+        EXPECT_EQ(runner.serial(i), std::vector<uint8_t>{static_cast<uint8_t>(0x40 + i)});
+        GAMEBOY::InputHandler input_handler;
+        GAMEBOY::Gameboy gameboy(roms[i], input_handler);
+        for (size_t frame=0; frame<4 + i*3; frame++)
+        {
+            gameboy.run_frame();
+        }
+        EXPECT_EQ(runner.gameboy(i).save_state(), gameboy.save_state());
+    }
+    EXPECT_EQ(stats.frames, frames);
+    EXPECT_GT(stats.frames_per_second, 0);
+}
+
+TEST(BatchRunner_test, CallbackFinishesEarly) {
+    ROMDATA rom = batch_test_rom(0);
+    GAMEBOY::BatchRunner runner(2);
+    int quanta = 0;
+    runner.add(rom, 100, [&quanta](GAMEBOY::Gameboy&, GAMEBOY::InputHandler& input_handler) {
+        input_handler.btn_down(GAMEBOY::InputHandler::BUTTON::A);
+        return ++quanta < 3;
+    });
+    runner.add(rom, 5);
+    auto stats = runner.run();
+    EXPECT_EQ(runner.frames_run(0), 3);
+    EXPECT_EQ(runner.frames_run(1), 5);
+    EXPECT_EQ(stats.frames, 8);
+    // finished instances are left alone by later runs
+    stats = runner.run();
+    EXPECT_EQ(stats.frames, 0);
+}
+
+TEST(BatchRunner_test, IsolatedErrors) {
+    ROMDATA rom = batch_test_rom(0);
+    GAMEBOY::BatchRunner runner(2);
+    runner.isolate_errors(true);
+    runner.add(rom, 10, [](GAMEBOY::Gameboy& gameboy, GAMEBOY::InputHandler&) -> bool {
+        if (gameboy.frame_sequence() == 2)
+        {
+            throw std::runtime_error("instance failed");
+        }
+        return true;
+    });
+    runner.add(rom, 10);
+    runner.run();
+    EXPECT_TRUE(runner.error(0));
+    EXPECT_EQ(runner.frames_run(0), 2);
+    // the other instance carries on
+    EXPECT_FALSE(runner.error(1));
+    EXPECT_EQ(runner.frames_run(1), 10);
+    EXPECT_GT(runner.seconds(1), 0);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "gameboy/conformance.h"
+#include "test_rom.h"
+
+typedef GAMEBOY::ConformanceMonitor::STATUS STATUS;
+typedef GAMEBOY::ConformanceMonitor::SOURCE SOURCE;
+
+// With RETI for the VBlank interrupt
+static ROMDATA conformance_test_rom(const std::vector<uint8_t>& code)
+{
+    ROMDATA rom = test_rom(code);
+    rom[0x40] = 0xD9;
+    return rom;
+}
+
+// Sends the text over serial, then DI; JR -2
+static std::vector<uint8_t> serial_code(const std::string& text)
+{
+    // JP 0x0150, past the cartridge header
+    std::vector<uint8_t> code = {0xC3, 0x50, 0x01};
+    code.resize(0x50);
+    for (char c : text)
+    {
+        // LD A,c; LDH (0x01),A; LD A,0x81; LDH (0x02),A
+        // wait for the transfer, LDH A,(0x02); BIT 7,A; JR NZ,-6
+        std::vector<uint8_t> send = {
+            0x3E, static_cast<uint8_t>(c), 0xE0, 0x01, 0x3E, 0x81, 0xE0, 0x02,
+            0xF0, 0x02, 0xCB, 0x7F, 0x20, 0xFA};
+        code.insert(code.end(), send.cbegin(), send.cend());
+    }
+    code.insert(code.end(), {0xF3, 0x18, 0xFE});
+    return code;
+}
+
+struct MonitorRun
+{
+    STATUS status;
+    SOURCE source;
+    uint64_t cycles;
+};
+
+static MonitorRun run_monitor(std::vector<uint8_t> code, uint64_t budget = 60*GAMEBOY::FRAME_CYCLES)
+{
+    ROMDATA rom = conformance_test_rom(code);
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    std::vector<uint8_t> serial;
+    gameboy.on_serial_out([&serial](uint8_t data) {
+        serial.push_back(data);
+    });
+    GAMEBOY::ConformanceMonitor monitor(gameboy, budget);
+    while (monitor.check(serial) == STATUS::RUNNING)
+    {
+        gameboy.run_frame();
+    }
+    return {monitor.status(), monitor.source(), monitor.cycles()};
+}
+
+TEST(ConformanceMonitor_test, Serial) {
+    MonitorRun run = run_monitor(serial_code("cpu_instrs\nPassed\n"));
+    EXPECT_EQ(run.status, STATUS::PASSED);
+    EXPECT_EQ(run.source, SOURCE::SERIAL);
+    run = run_monitor(serial_code("Failed #2\n"));
+    EXPECT_EQ(run.status, STATUS::FAILED);
+    EXPECT_EQ(run.source, SOURCE::SERIAL);
+    run = run_monitor(serial_code("\x03\x05\x08\x0D\x15\x22"));
+    EXPECT_EQ(run.status, STATUS::PASSED);
+    EXPECT_EQ(run.source, SOURCE::SERIAL);
+}
+
+TEST(ConformanceMonitor_test, Breakpoint) {
+    // LD B,3; LD C,5; LD D,8; LD E,13; LD H,21; LD L,34; LD B,B; JR -2
+    std::vector<uint8_t> code = {0x06, 3, 0x0E, 5, 0x16, 8, 0x1E, 13, 0x26, 21, 0x2E, 34, 0x40, 0x18, 0xFE};
+    MonitorRun run = run_monitor(code);
+    EXPECT_EQ(run.status, STATUS::PASSED);
+    EXPECT_EQ(run.source, SOURCE::BREAKPOINT);
+    // 6 loads of 8 cycles before the breakpoint
+    EXPECT_EQ(run.cycles, 48);
+    code[11] = 35;
+    run = run_monitor(code);
+    EXPECT_EQ(run.status, STATUS::FAILED);
+    EXPECT_EQ(run.source, SOURCE::BREAKPOINT);
+}
+
+TEST(ConformanceMonitor_test, Loop) {
+    // NOP; JR -2, no interrupts are enabled
+    MonitorRun run = run_monitor({0x00, 0x18, 0xFE});
+    EXPECT_EQ(run.status, STATUS::FAILED);
+    EXPECT_EQ(run.source, SOURCE::LOOP);
+    EXPECT_EQ(run.cycles, 4);
+}
+
+TEST(ConformanceMonitor_test, Budget) {
+    // LD A,1; LDH (0xFF),A; EI; JR -2 is waiting for VBlank, not finished
+    MonitorRun run = run_monitor({0x3E, 0x01, 0xE0, 0xFF, 0xFB, 0x18, 0xFE}, 5*GAMEBOY::FRAME_CYCLES);
+    EXPECT_EQ(run.status, STATUS::TIMEOUT);
+    EXPECT_EQ(run.source, SOURCE::BUDGET);
+    EXPECT_GE(run.cycles, 5*GAMEBOY::FRAME_CYCLES);
+}
@@ -5,7 +5,7 @@
 #include "gameboy/memory.h"
 #include "gameboy/rom.h"
 #include "gameboy/input.h"
-#include <SDL2/SDL_log.h>
+#include "gameboy/log.h"
 #include <vector>
 
 static const ROMDATA rom();
@@ -23,7 +23,7 @@ public:
         addressDispatcher(GAMEBOY::AddressDispatcher(rom, input_handler))
     {
         *registers.PC = 0xC000;
-        SDL_LogSetAllPriority(SDL_LOG_PRIORITY_VERBOSE);
+        GAMEBOY::log_level(GAMEBOY::LOG_LEVEL::DEBUG);
     };
 };
 
@@ -17,6 +17,9 @@ TEST(STOP_test, DoesStop) {
     GAMEBOY::InstructionResult result = instr.tick();
     EXPECT_EQ(*helper.registers.PC, 0xC001);
     EXPECT_EQ(result, GAMEBOY::InstructionResult::STOP);
+    // the timer is held until the CPU resumes
+    helper.addressDispatcher.scheduler().advance(1024);
+    EXPECT_EQ(helper.addressDispatcher.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 0);
 }
 
 TEST(JP_HL_test, IsCorrectPc) {
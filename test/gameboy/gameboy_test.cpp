@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "gameboy/gameboy.h"
+#include "test_rom.h"
+
+TEST(Gameboy_test, RunFrame) {
+    // JR -2
+    ROMDATA rom = test_rom({0x18, 0xFE});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    auto result = gameboy.run_frame();
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::FRAME);
+    // first VBlank begins after 144 lines
+    EXPECT_EQ(result.cycles, 144*456);
+    result = gameboy.run_frame();
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::FRAME);
+    EXPECT_EQ(result.cycles, GAMEBOY::FRAME_CYCLES);
+    EXPECT_EQ(gameboy.cycles(), 144*456 + GAMEBOY::FRAME_CYCLES);
+}
+
+TEST(Gameboy_test, RunCycles) {
+    ROMDATA rom = test_rom({0x18, 0xFE});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    auto result = gameboy.run_cycles(1000);
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::CYCLES);
+    EXPECT_EQ(result.cycles, 1000);
+    // rounded up to whole M-cycles
+    result = gameboy.run_cycles(2);
+    EXPECT_EQ(result.cycles, 4);
+}
+
+TEST(Gameboy_test, RunUntil) {
+    ROMDATA rom = test_rom({0x18, 0xFE});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    auto result = gameboy.run_until_event(GAMEBOY::event_bit(GAMEBOY::EventType::PPU_MODE));
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::EVENT);
+    // mode 2 ends after 80 dots
+    EXPECT_EQ(result.cycles, 80);
+    result = gameboy.run_until([&gameboy]() {
+        return gameboy.cycles() >= 200;
+    });
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::PREDICATE);
+    EXPECT_EQ(gameboy.cycles(), 200);
+    result = gameboy.run_until([]() { return false; }, 40);
+    EXPECT_EQ(result.reason, GAMEBOY::RunResult::STOP_REASON::CYCLES);
+    EXPECT_EQ(result.cycles, 40);
+}
+
+TEST(Gameboy_test, HaltSkipsToEvents) {
+    // IE = VBlank, then clear IF & HALT until the next VBlank
+    // 0x100: LD A,0x01; LDH (0xFF),A
+    // 0x104: XOR A; LDH (0x0F),A; HALT; INC B; JR 0x104
+    ROMDATA rom = test_rom({0x3E, 0x01, 0xE0, 0xFF, 0xAF, 0xE0, 0x0F, 0x76, 0x04, 0x18, 0xF9});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    // the same as stepping each M-cycle
+    ROMDATA rom_step = rom;
+    GAMEBOY::InputHandler input_handler_step;
+    GAMEBOY::Gameboy gameboy_step(rom_step, input_handler_step);
+    for (int i=0; i<4; i++)
+    {
+        auto result = gameboy.run_frame();
+        uint64_t frames = 0;
+        uint64_t cycles = 0;
+        while (frames == 0)
+        {
+            frames += gameboy_step.tick();
+            cycles += 4;
+        }
+        EXPECT_EQ(result.cycles, cycles);
+        EXPECT_EQ(gameboy.cycles(), gameboy_step.cycles());
+    }
+}
+
+// Copies TIMA & LY across every address from VRAM upwards, so VRAM, cart
+// RAM, WRAM, OAM & eventually the IO registers all end up changing
+// 0x100: LD A,0x05; LDH (0x07),A; LD HL,0x8000
+// 0x107: LDH A,(0x05); LD (HL+),A; LDH A,(0x44); LDH (0x43),A; INC B; JR 0x107
+TEST(Gameboy_test, SaveStateRoundTrip) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    // never saved, to check saving doesn't change the machine
+    GAMEBOY::InputHandler input_handler_ref;
+    GAMEBOY::Gameboy gameboy_ref(rom, input_handler_ref);
+    // the loaded machine only gets its buttons from the state
+    input_handler.btn_down(GAMEBOY::InputHandler::BUTTON::START);
+    input_handler_ref.btn_down(GAMEBOY::InputHandler::BUTTON::START);
+    for (int i=0; i<10; i++)
+    {
+        gameboy.run_frame();
+    }
+    // stop part way through an instruction
+    gameboy.run_cycles(1234);
+    auto state = gameboy.save_state();
+
+    GAMEBOY::InputHandler input_handler_loaded;
+    GAMEBOY::Gameboy gameboy_loaded(rom, input_handler_loaded);
+    gameboy_loaded.load_state(state);
+    EXPECT_EQ(gameboy_loaded.cycles(), gameboy.cycles());
+    EXPECT_EQ(gameboy_loaded.frame(), gameboy.frame());
+    EXPECT_EQ(gameboy_loaded.save_state(), state);
+
+    gameboy_ref.run_until([&]() {
+        return gameboy_ref.cycles() >= gameboy.cycles();
+    }, GAMEBOY::Scheduler::NEVER);
+    EXPECT_EQ(gameboy_ref.save_state(), state);
+
+    // long enough for the copy to reach the IO registers
+    for (int i=0; i<30; i++)
+    {
+        gameboy.run_frame();
+        gameboy_loaded.run_frame();
+        gameboy_ref.run_frame();
+        ASSERT_EQ(gameboy_loaded.cycles(), gameboy.cycles());
+        ASSERT_EQ(gameboy_ref.cycles(), gameboy.cycles());
+        ASSERT_EQ(gameboy_loaded.frame(), gameboy.frame());
+        ASSERT_EQ(gameboy_ref.frame(), gameboy.frame());
+    }
+    state = gameboy.save_state();
+    EXPECT_EQ(gameboy_loaded.save_state(), state);
+    EXPECT_EQ(gameboy_ref.save_state(), state);
+}
+
+TEST(Gameboy_test, SaveStateWhileHalted) {
+    // same as HaltSkipsToEvents
+    ROMDATA rom = test_rom({0x3E, 0x01, 0xE0, 0xFF, 0xAF, 0xE0, 0x0F, 0x76, 0x04, 0x18, 0xF9});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    gameboy.run_frame();
+    gameboy.run_cycles(1000);
+    auto state = gameboy.save_state();
+    GAMEBOY::InputHandler input_handler_loaded;
+    GAMEBOY::Gameboy gameboy_loaded(rom, input_handler_loaded);
+    gameboy_loaded.load_state(state);
+    for (int i=0; i<3; i++)
+    {
+        auto result = gameboy.run_frame();
+        auto result_loaded = gameboy_loaded.run_frame();
+        EXPECT_EQ(result_loaded.cycles, result.cycles);
+    }
+    EXPECT_EQ(gameboy_loaded.save_state(), gameboy.save_state());
+}
+
+TEST(Gameboy_test, SaveStateRejected) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    auto state = gameboy.save_state();
+    // a different global checksum
+    ROMDATA other_rom = rom;
+    other_rom[0x14F] = 0x01;
+    GAMEBOY::InputHandler other_input_handler;
+    GAMEBOY::Gameboy other(other_rom, other_input_handler);
+    EXPECT_THROW(other.load_state(state), std::invalid_argument);
+    auto bad_version = state;
+    bad_version[4] ^= 0xFF;
+    EXPECT_THROW(gameboy.load_state(bad_version), std::invalid_argument);
+    auto truncated = state;
+    truncated.resize(state.size() - 1);
+    EXPECT_THROW(gameboy.load_state(truncated), std::out_of_range);
+}
+
+TEST(Gameboy_test, SaveStateFailureChangesNothing) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    input_handler.btn_down(GAMEBOY::InputHandler::BUTTON::START);
+    gameboy.run_frame();
+    auto earlier = gameboy.save_state();
+    for (int i=0; i<10; i++)
+    {
+        gameboy.run_frame();
+    }
+    auto state = gameboy.save_state();
+    // cut off at the end, and part way through memory
+    for (size_t size : {earlier.size() - 1, earlier.size() / 2})
+    {
+        auto truncated = earlier;
+        truncated.resize(size);
+        EXPECT_THROW(gameboy.load_state(truncated), std::out_of_range);
+        EXPECT_EQ(gameboy.save_state(), state);
+    }
+    auto trailing = earlier;
+    trailing.push_back(0x00);
+    EXPECT_THROW(gameboy.load_state(trailing), std::invalid_argument);
+    EXPECT_EQ(gameboy.save_state(), state);
+    gameboy.load_state(earlier);
+    EXPECT_EQ(gameboy.save_state(), earlier);
+}
+
+TEST(Gameboy_test, ForkRunsIndependently) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    input_handler.btn_down(GAMEBOY::InputHandler::BUTTON::START);
+    for (int i=0; i<10; i++)
+    {
+        gameboy.run_frame();
+    }
+    gameboy.run_cycles(1234);
+    // the child takes its buttons from the parent
+    GAMEBOY::InputHandler child_input_handler;
+    std::unique_ptr<GAMEBOY::Gameboy> child = gameboy.fork(child_input_handler);
+    EXPECT_EQ(child->cycles(), gameboy.cycles());
+    EXPECT_EQ(child->frame(), gameboy.frame());
+    EXPECT_EQ(child->save_state(), gameboy.save_state());
+
+    // both running at once, neither changes the other's memory
+    std::vector<GAMEBOY::FRAME_PIXELS> child_frames;
+    std::thread thread([&]() {
+        for (int i=0; i<30; i++)
+        {
+            child->run_frame();
+            child_frames.push_back(child->frame());
+        }
+    });
+    std::vector<GAMEBOY::FRAME_PIXELS> frames;
+    for (int i=0; i<30; i++)
+    {
+        gameboy.run_frame();
+        frames.push_back(gameboy.frame());
+    }
+    thread.join();
+    EXPECT_EQ(child_frames, frames);
+    EXPECT_EQ(child->save_state(), gameboy.save_state());
+}
+
+TEST(Gameboy_test, StatsHalt) {
+    if (!GAMEBOY::Stats::ENABLED)
+    {
+        GTEST_SKIP() << "Stats compiled out";
+    }
+    // IE = VBlank, then clear IF & HALT until the next VBlank
+    ROMDATA rom = test_rom({0x3E, 0x01, 0xE0, 0xFF, 0xAF, 0xE0, 0x0F, 0x76, 0x04, 0x18, 0xF9});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    ROMDATA rom_step = rom;
+    GAMEBOY::InputHandler input_handler_step;
+    GAMEBOY::Gameboy gameboy_step(rom_step, input_handler_step);
+    for (int i=0; i<4; i++)
+    {
+        gameboy.run_frame();
+        while (!gameboy_step.tick());
+    }
+    auto stats = gameboy.stats();
+    auto stats_step = gameboy_step.stats();
+    EXPECT_EQ(stats.mcycles, gameboy.cycles()/4);
+    // skipped cycles count the same as stepping through them
+    EXPECT_EQ(stats.halt_mcycles, stats_step.halt_mcycles);
+    EXPECT_GT(stats.halt_mcycles, stats.mcycles*9/10);
+    EXPECT_EQ(stats.opcodes[0x76], 4);
+    EXPECT_EQ(stats.interrupts, 4);
+    EXPECT_EQ(stats.stop_mcycles, 0);
+}
+
+TEST(Gameboy_test, StatsCounters) {
+    if (!GAMEBOY::Stats::ENABLED)
+    {
+        GTEST_SKIP() << "Stats compiled out";
+    }
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    for (int i=0; i<3; i++)
+    {
+        gameboy.run_frame();
+    }
+    auto stats = gameboy.stats();
+    uint64_t opcodes = 0;
+    for (uint64_t count : stats.opcodes)
+    {
+        opcodes += count;
+    }
+    EXPECT_EQ(opcodes, stats.instructions);
+    EXPECT_GT(stats.writes[static_cast<size_t>(GAMEBOY::Stats::REGION::VRAM)], 0);
+    EXPECT_GT(stats.reads[static_cast<size_t>(GAMEBOY::Stats::REGION::IO)], 0);
+    EXPECT_GT(stats.accesses[static_cast<size_t>(GAMEBOY::MemoryAccessSource::PPU)], 0);
+    EXPECT_EQ(stats.lines_rendered % GAMEBOY::SCREEN_HEIGHT, 0);
+    EXPECT_GE(stats.lines_rendered, 2*GAMEBOY::SCREEN_HEIGHT);
+    // VRAM keeps changing, so the tiles are rebuilt
+    EXPECT_GT(stats.tile_cache_invalidations, 0);
+    EXPECT_GT(stats.tile_cache_misses, 0);
+    EXPECT_FALSE(stats.summary().empty());
+}
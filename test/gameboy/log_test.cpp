@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "gameboy/log.h"
+
+class LogCapture
+{
+public:
+    std::vector<std::string> messages;
+    LogCapture()
+    {
+        GAMEBOY::log_sink([this](GAMEBOY::LOG_LEVEL, const char* message) {
+            messages.push_back(message);
+        });
+    }
+    ~LogCapture()
+    {
+        GAMEBOY::log_sink(nullptr);
+    }
+};
+
+TEST(Log_test, RuntimeLevel) {
+    LogCapture capture;
+    GAMEBOY::LOG_LEVEL previous = GAMEBOY::log_level();
+    GAMEBOY::log_level(GAMEBOY::LOG_LEVEL::WARN);
+    GAMEBOY::log(GAMEBOY::LOG_LEVEL::INFO, "dropped %d\n", 1);
+    GAMEBOY::log(GAMEBOY::LOG_LEVEL::ERROR, "kept %d\n", 2);
+    GAMEBOY::log_level(previous);
+    ASSERT_EQ(capture.messages.size(), 1);
+    EXPECT_EQ(capture.messages[0], "kept 2\n");
+}
+
+TEST(Log_test, CompiledLevels) {
+    static_assert(GAMEBOY::log_compiled(GAMEBOY::LOG_LEVEL::CRITICAL));
+    EXPECT_EQ(GAMEBOY::log_compiled(GAMEBOY::LOG_LEVEL::DEBUG), GBEMU_LOG_MIN_LEVEL == 0);
+}
+
+#if GBEMU_LOG_MIN_LEVEL > 0
+TEST(Log_test, CompiledOutArgumentsNotEvaluated) {
+    LogCapture capture;
+    GAMEBOY::LOG_LEVEL previous = GAMEBOY::log_level();
+    GAMEBOY::log_level(GAMEBOY::LOG_LEVEL::DEBUG);
+    int evaluated = 0;
+    auto count = [&evaluated]() { return ++evaluated; };
+    GBEMU_LOG_DEBUG("%d\n", count());
+    GAMEBOY::log_level(previous);
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_TRUE(capture.messages.empty());
+}
+#endif
+
+TEST(Log_test, LimiterDeduplicates) {
+    LogCapture capture;
+    GAMEBOY::LogLimiter limiter;
+    for (int i=0; i<50; i++)
+    {
+        limiter.log(GAMEBOY::LOG_LEVEL::WARN, "same\n");
+    }
+    EXPECT_EQ(capture.messages.size(), 1);
+    limiter.log(GAMEBOY::LOG_LEVEL::WARN, "different\n");
+    ASSERT_EQ(capture.messages.size(), 3);
+    EXPECT_EQ(capture.messages[1], "Previous message repeated 49 times\n");
+    EXPECT_EQ(capture.messages[2], "different\n");
+}
+
+TEST(Log_test, LimiterRateLimits) {
+    LogCapture capture;
+    GAMEBOY::LogLimiter limiter(5, std::chrono::hours(1));
+    for (int i=0; i<20; i++)
+    {
+        limiter.log(GAMEBOY::LOG_LEVEL::WARN, "message %d\n", i);
+    }
+    EXPECT_EQ(capture.messages.size(), 5);
+    limiter.flush();
+    ASSERT_EQ(capture.messages.size(), 6);
+    EXPECT_EQ(capture.messages[5], "Suppressed 15 messages\n");
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/memory_cart.h"
+#include "gameboy/scheduler.h"
+#include "gameboy/state.h"
+
+// ROM of the given mapper type & size, each bank's first byte its number
+static ROMDATA banked_rom(uint8_t cart_type, uint8_t rom_size, uint8_t ram_size)
+{
+    ROMDATA rom(std::vector<uint8_t>((0x8000 << rom_size), 0));
+    for (size_t bank=0; bank<rom.size()/0x4000; bank++)
+    {
+        rom[bank*0x4000] = bank & 0xFF;
+        rom[bank*0x4000 + 1] = bank >> 8;
+    }
+    rom[GAMEBOY::CART_TYPE] = cart_type;
+    rom[GAMEBOY::ROM_SIZE] = rom_size;
+    rom[GAMEBOY::RAM_SIZE] = ram_size;
+    return rom;
+}
+
+static uint16_t mapped_bank(GAMEBOY::Cartridge& cart)
+{
+    return cart.read_rom(0x4000) | cart.read_rom(0x4001) << 8;
+}
+
+TEST(MemoryCart_test, Mbc1Banking) {
+    // 2MB, 32KB RAM
+    ROMDATA rom = banked_rom(0x03, 0x06, 0x03);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    EXPECT_EQ(mapped_bank(cart), 1);
+    cart.write(0x2000, 0x00);
+    EXPECT_EQ(mapped_bank(cart), 1);
+    cart.write(0x2000, 0x05);
+    EXPECT_EQ(mapped_bank(cart), 5);
+    EXPECT_EQ(cart.rom_bank(), 5);
+    // upper bits from the RAM bank register
+    cart.write(0x4000, 0x02);
+    EXPECT_EQ(mapped_bank(cart), 0x45);
+    EXPECT_EQ(cart.read_rom(0x0000), 0);
+    // mode 1 banks 0x0000-0x3FFF too
+    cart.write(0x6000, 0x01);
+    EXPECT_EQ(cart.read_rom(0x0000), 0x40);
+    // RAM reads as 0xFF until enabled
+    EXPECT_EQ(cart.read_ram(0xA000), 0xFF);
+    cart.write(0xA000, 0x12);
+    cart.write(0x0000, 0x0A);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x00);
+    cart.write(0xA000, 0x12);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x12);
+    cart.write(0x4000, 0x01);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x00);
+    cart.write(0x4000, 0x02);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x12);
+    cart.write(0x0000, 0x00);
+    EXPECT_EQ(cart.read_ram(0xA000), 0xFF);
+}
+
+TEST(MemoryCart_test, Mbc2Ram) {
+    // 256KB
+    ROMDATA rom = banked_rom(0x06, 0x03, 0x00);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    // bit 8 of the address picks the register
+    cart.write(0x2100, 0x0F);
+    EXPECT_EQ(mapped_bank(cart), 15);
+    cart.write(0x0100, 0x00);
+    EXPECT_EQ(mapped_bank(cart), 1);
+    cart.write(0x0000, 0x0A);
+    // half bytes, repeating every 512 bytes
+    cart.write(0xA005, 0x3C);
+    EXPECT_EQ(cart.read_ram(0xA005), 0xFC);
+    EXPECT_EQ(cart.read_ram(0xA205), 0xFC);
+    EXPECT_EQ(cart.read_ram(0xBE05), 0xFC);
+}
+
+TEST(MemoryCart_test, Mbc5Banking) {
+    // 8MB, 128KB RAM
+    ROMDATA rom = banked_rom(0x1B, 0x08, 0x04);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    EXPECT_EQ(mapped_bank(cart), 1);
+    // bank 0 can be mapped high
+    cart.write(0x2000, 0x00);
+    EXPECT_EQ(mapped_bank(cart), 0);
+    cart.write(0x2000, 0x34);
+    cart.write(0x3000, 0x01);
+    EXPECT_EQ(mapped_bank(cart), 0x134);
+    cart.write(0x0000, 0x0A);
+    cart.write(0x4000, 0x0F);
+    cart.write(0xBFFF, 0x56);
+    cart.write(0x4000, 0x00);
+    EXPECT_EQ(cart.read_ram(0xBFFF), 0x00);
+    cart.write(0x4000, 0x0F);
+    EXPECT_EQ(cart.read_ram(0xBFFF), 0x56);
+}
+
+TEST(MemoryCart_test, BanksWrap) {
+    // 64KB MBC5 selecting bank 7
+    ROMDATA rom = banked_rom(0x19, 0x01, 0x00);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    cart.write(0x2000, 0x07);
+    EXPECT_EQ(mapped_bank(cart), 3);
+}
+
+TEST(MemoryCart_test, Mbc3RamBanks) {
+    // 1MB, 32KB RAM
+    ROMDATA rom = banked_rom(0x13, 0x05, 0x03);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    cart.write(0x0000, 0x0A);
+    for (uint8_t bank=0; bank<4; bank++)
+    {
+        cart.write(0x4000, bank);
+        cart.write(0xA000, 0x10 + bank);
+        cart.write(0xBFFF, 0x20 + bank);
+    }
+    // each write landed in its own bank and stayed there
+    for (uint8_t bank=0; bank<4; bank++)
+    {
+        cart.write(0x4000, bank);
+        EXPECT_EQ(cart.read_ram(0xA000), 0x10 + bank);
+        EXPECT_EQ(cart.read_ram(0xBFFF), 0x20 + bank);
+    }
+    // and survive switching ROM banks & disabling RAM
+    cart.write(0x2000, 0x3F);
+    EXPECT_EQ(mapped_bank(cart), 0x3F);
+    cart.write(0x0000, 0x00);
+    EXPECT_EQ(cart.read_ram(0xA000), 0xFF);
+    cart.write(0x0000, 0x0A);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x13);
+}
+
+TEST(MemoryCart_test, CopiesAndStates) {
+    ROMDATA rom = banked_rom(0x13, 0x03, 0x03);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    cart.write(0x0000, 0x0A);
+    cart.write(0x2000, 0x09);
+    cart.write(0xA123, 0x77);
+    GAMEBOY::Cartridge copy(cart, scheduler);
+    copy.write(0xA123, 0x88);
+    EXPECT_EQ(cart.read_ram(0xA123), 0x77);
+    EXPECT_EQ(copy.read_ram(0xA123), 0x88);
+    EXPECT_EQ(mapped_bank(copy), 9);
+    std::vector<uint8_t> data;
+    GAMEBOY::StateWriter writer(data);
+    cart.save_state(writer);
+    copy.write(0x2000, 0x02);
+    copy.write(0x0000, 0x00);
+    GAMEBOY::StateReader reader(data);
+    copy.load_state(reader);
+    EXPECT_EQ(mapped_bank(copy), 9);
+    EXPECT_EQ(copy.read_ram(0xA123), 0x77);
+}
+
+// Latches the MBC3 clock and reads back one of its registers
+static uint8_t read_clock(GAMEBOY::Cartridge& cart, uint8_t reg)
+{
+    cart.write(0x6000, 0x00);
+    cart.write(0x6000, 0x01);
+    cart.write(0x4000, reg);
+    return cart.read_ram(0xA000);
+}
+
+TEST(MemoryCart_test, Mbc3Clock) {
+    ROMDATA rom = banked_rom(0x10, 0x03, 0x03);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    const uint64_t SECOND = GAMEBOY::RealTimeClock::CYCLES_PER_SECOND;
+    cart.write(0x0000, 0x0A);
+    scheduler.advance(61*SECOND + 100);
+    EXPECT_EQ(read_clock(cart, 0x08), 1);
+    EXPECT_EQ(read_clock(cart, 0x09), 1);
+    // the latched value holds until the next latch
+    scheduler.advance(SECOND);
+    EXPECT_EQ(cart.read_ram(0xA000), 1);
+    cart.write(0x4000, 0x08);
+    EXPECT_EQ(cart.read_ram(0xA000), 1);
+    EXPECT_EQ(read_clock(cart, 0x08), 2);
+    // set to day 0x1FF 23:59:59, which then overflows
+    cart.write(0x4000, 0x0A);
+    cart.write(0xA000, 23);
+    cart.write(0x4000, 0x09);
+    cart.write(0xA000, 59);
+    cart.write(0x4000, 0x0B);
+    cart.write(0xA000, 0xFF);
+    cart.write(0x4000, 0x0C);
+    cart.write(0xA000, 0x01);
+    cart.write(0x4000, 0x08);
+    cart.write(0xA000, 59);
+    EXPECT_EQ(read_clock(cart, 0x0C), 0x01);
+    scheduler.advance(SECOND);
+    EXPECT_EQ(read_clock(cart, 0x0B), 0x00);
+    EXPECT_EQ(read_clock(cart, 0x0C), 0x80);
+    EXPECT_EQ(read_clock(cart, 0x08), 0);
+    // halted, the clock stops
+    cart.write(0x4000, 0x0C);
+    cart.write(0xA000, 0x40);
+    scheduler.advance(10*SECOND);
+    EXPECT_EQ(read_clock(cart, 0x08), 0);
+    EXPECT_EQ(read_clock(cart, 0x0C), 0x40);
+    // RAM banks are still there
+    cart.write(0x4000, 0x01);
+    cart.write(0xA000, 0x99);
+    EXPECT_EQ(cart.read_ram(0xA000), 0x99);
+}
+
+TEST(MemoryCart_test, Mbc3Battery) {
+    ROMDATA rom = banked_rom(0x10, 0x03, 0x03);
+    GAMEBOY::Scheduler scheduler;
+    GAMEBOY::Cartridge cart(rom, scheduler);
+    const uint64_t SECOND = GAMEBOY::RealTimeClock::CYCLES_PER_SECOND;
+    cart.write(0x0000, 0x0A);
+    cart.write(0x4000, 0x03);
+    cart.write(0xBFFF, 0x42);
+    scheduler.advance(5*SECOND);
+    read_clock(cart, 0x08);
+    std::vector<uint8_t> battery = cart.save_battery(1000);
+    // 4 RAM banks then the clock
+    ASSERT_EQ(battery.size(), 4*0x2000 + 48);
+    EXPECT_EQ(battery[4*0x2000 - 1], 0x42);
+    EXPECT_EQ(battery[4*0x2000], 5);
+    EXPECT_EQ(battery[4*0x2000 + 20], 5);
+    // loaded into a machine a minute & a half later on the host
+    GAMEBOY::Scheduler other_scheduler;
+    GAMEBOY::Cartridge other(rom, other_scheduler);
+    other.load_battery(battery, 1090);
+    other.write(0x0000, 0x0A);
+    EXPECT_EQ(read_clock(other, 0x08), 35);
+    EXPECT_EQ(read_clock(other, 0x09), 1);
+    other.write(0x4000, 0x03);
+    EXPECT_EQ(other.read_ram(0xBFFF), 0x42);
+    // without the clock, or the wrong size
+    battery.resize(4*0x2000);
+    EXPECT_NO_THROW(other.load_battery(battery, 0));
+    battery.resize(0x2000);
+    EXPECT_THROW(other.load_battery(battery, 0), std::invalid_argument);
+    EXPECT_EQ(other.read_ram(0xBFFF), 0x42);
+    // no battery, nothing saved
+    ROMDATA no_battery = banked_rom(0x12, 0x03, 0x03);
+    GAMEBOY::Cartridge plain(no_battery, scheduler);
+    EXPECT_TRUE(plain.save_battery(0).empty());
+}
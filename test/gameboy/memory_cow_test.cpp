@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/memory_cow.h"
+#include "gameboy/state.h"
+#include "cpu_init_helper.h"
+
+TEST(MemoryCow_test, CopiesShareUntilWritten) {
+    GAMEBOY::CowMemory<0x1000> memory;
+    EXPECT_EQ(memory.unique_pages(), 4);
+    memory.write(0x0123, 0x45);
+    GAMEBOY::CowMemory<0x1000> copy = memory;
+    EXPECT_EQ(memory.unique_pages(), 0);
+    EXPECT_EQ(copy.read(0x0123), 0x45);
+    // only the page written is copied
+    copy.write(0x0801, 0x67);
+    EXPECT_EQ(copy.unique_pages(), 1);
+    EXPECT_EQ(memory.unique_pages(), 1);
+    EXPECT_EQ(memory.read(0x0801), 0x00);
+    memory.write(0x0123, 0x89);
+    EXPECT_EQ(copy.read(0x0123), 0x45);
+    EXPECT_EQ(memory.unique_pages(), 2);
+}
+
+TEST(MemoryCow_test, SaveState) {
+    GAMEBOY::CowMemory<0x800> memory;
+    for (size_t i=0; i<0x800; i++)
+    {
+        memory.write(i, i*7);
+    }
+    std::vector<uint8_t> data;
+    GAMEBOY::StateWriter writer(data);
+    memory.save_state(writer);
+    // the same as a plain array of bytes
+    ASSERT_EQ(data.size(), 0x800);
+    EXPECT_EQ(data[0x432], static_cast<uint8_t>(0x432*7));
+    GAMEBOY::CowMemory<0x800> copy = memory;
+    data[0x432] = 0;
+    GAMEBOY::StateReader reader(data);
+    memory.load_state(reader);
+    EXPECT_EQ(memory.read(0x432), 0);
+    // loading never writes pages still shared
+    EXPECT_EQ(copy.read(0x432), static_cast<uint8_t>(0x432*7));
+}
+
+TEST(MemoryCow_test, DispatcherFork) {
+    CpuInitHelper helper;
+    GAMEBOY::AddressDispatcher& parent = helper.addressDispatcher;
+    parent.write(0xC010, 0x11);
+    parent.write(0x8010, 0x22);
+    parent.write(0xA010, 0x33);
+    parent.write(GAMEBOY::IOHandler::PPU_REG_SCX, 0x44);
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::AddressDispatcher child(parent, input_handler);
+    std::vector<uint8_t> registers;
+    GAMEBOY::StateWriter writer(registers);
+    parent.save_registers(writer);
+    GAMEBOY::StateReader reader(registers);
+    child.load_registers(reader);
+    EXPECT_EQ(child.read(0xC010), 0x11);
+    EXPECT_EQ(child.read(0x8010), 0x22);
+    EXPECT_EQ(child.read(0xA010), 0x33);
+    EXPECT_EQ(child.read(GAMEBOY::IOHandler::PPU_REG_SCX), 0x44);
+    // ROM is shared outright
+    EXPECT_EQ(child.read(0x0100), parent.read(0x0100));
+    child.write(0xC010, 0x55);
+    child.write(0x8010, 0x66);
+    child.write(0xA010, 0x77);
+    parent.write(0xC020, 0x88);
+    EXPECT_EQ(parent.read(0xC010), 0x11);
+    EXPECT_EQ(parent.read(0x8010), 0x22);
+    EXPECT_EQ(parent.read(0xA010), 0x33);
+    EXPECT_EQ(child.read(0xC020), 0x00);
+    EXPECT_EQ(child.read(0xC010), 0x55);
+    EXPECT_EQ(child.read(0x8010), 0x66);
+    EXPECT_EQ(child.read(0xA010), 0x77);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include "gameboy/movie.h"
+#include "test_rom.h"
+
+// Copies the buttons held into BGP, so input changes the frames drawn
+// 0x100: LD A,0x10; LDH (0x00),A
+// 0x104: LDH A,(0x00); LDH (0x47),A; JR 0x104
+static ROMDATA movie_test_rom()
+{
+    return test_rom({0x3E, 0x10, 0xE0, 0x00, 0xF0, 0x00, 0xE0, 0x47, 0x18, 0xFA});
+}
+
+// Presses part way through frames, toggling A & B
+static GAMEBOY::Movie record(GAMEBOY::Gameboy& gameboy, GAMEBOY::MovieRecorder& recorder, int frames)
+{
+    for (int i=0; i<frames; i++)
+    {
+        if (i % 3 == 0)
+        {
+            gameboy.run_cycles(1000 + i*40);
+            recorder.button(GAMEBOY::InputHandler::BUTTON::A, i % 2 == 0);
+            recorder.button(GAMEBOY::InputHandler::BUTTON::B, i % 4 == 0);
+        }
+        gameboy.run_frame();
+        recorder.frame();
+    }
+    return recorder.movie();
+}
+
+TEST(Movie_test, RecordAndReplay) {
+    ROMDATA rom = movie_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    GAMEBOY::MovieRecorder recorder(gameboy, input_handler);
+    GAMEBOY::Movie movie = record(gameboy, recorder, 30);
+    std::set<uint64_t> hashes(movie.frame_hashes.cbegin(), movie.frame_hashes.cend());
+    EXPECT_GT(hashes.size(), 1);
+
+    std::vector<uint8_t> file;
+    movie.serialize(file);
+    GAMEBOY::Movie loaded = GAMEBOY::Movie::deserialize(file);
+    ASSERT_EQ(loaded.events.size(), movie.events.size());
+    EXPECT_EQ(loaded.frame_hashes, movie.frame_hashes);
+
+    GAMEBOY::InputHandler input_handler_replay;
+    GAMEBOY::Gameboy gameboy_replay(rom, input_handler_replay);
+    GAMEBOY::MoviePlayer player(gameboy_replay, input_handler_replay, loaded);
+    for (int i=0; i<30; i++)
+    {
+        player.run_frame();
+        EXPECT_TRUE(player.frame());
+    }
+    EXPECT_TRUE(player.finished());
+    EXPECT_EQ(player.desyncs(), 0);
+    EXPECT_EQ(gameboy_replay.save_state(), gameboy.save_state());
+}
+
+TEST(Movie_test, StartState) {
+    ROMDATA rom = movie_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    for (int i=0; i<5; i++)
+    {
+        gameboy.run_frame();
+    }
+    input_handler.btn_down(GAMEBOY::InputHandler::BUTTON::A);
+    GAMEBOY::MovieRecorder recorder(gameboy, input_handler, true);
+    GAMEBOY::Movie movie = record(gameboy, recorder, 10);
+    EXPECT_FALSE(movie.start_state.empty());
+
+    GAMEBOY::InputHandler input_handler_replay;
+    GAMEBOY::Gameboy gameboy_replay(rom, input_handler_replay);
+    GAMEBOY::MoviePlayer player(gameboy_replay, input_handler_replay, movie);
+    for (int i=0; i<10; i++)
+    {
+        player.run_frame();
+        player.frame();
+    }
+    EXPECT_EQ(player.desyncs(), 0);
+    EXPECT_EQ(gameboy_replay.save_state(), gameboy.save_state());
+}
+
+TEST(Movie_test, DetectsDesync) {
+    ROMDATA rom = movie_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    GAMEBOY::MovieRecorder recorder(gameboy, input_handler);
+    GAMEBOY::Movie movie = record(gameboy, recorder, 10);
+    // a press which never happened while recording
+    movie.events.insert(movie.events.begin(), {500, GAMEBOY::InputHandler::BUTTON::B, true});
+
+    GAMEBOY::InputHandler input_handler_replay;
+    GAMEBOY::Gameboy gameboy_replay(rom, input_handler_replay);
+    GAMEBOY::MoviePlayer player(gameboy_replay, input_handler_replay, movie);
+    player.run_frame();
+    EXPECT_FALSE(player.frame());
+    EXPECT_EQ(player.desyncs(), 1);
+}
+
+TEST(Movie_test, Rejected) {
+    ROMDATA rom = movie_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    GAMEBOY::MovieRecorder recorder(gameboy, input_handler);
+    GAMEBOY::Movie movie = record(gameboy, recorder, 3);
+    std::vector<uint8_t> file;
+    movie.serialize(file);
+    auto bad_magic = file;
+    bad_magic[0] = 'X';
+    EXPECT_THROW(GAMEBOY::Movie::deserialize(bad_magic), std::invalid_argument);
+    auto truncated = file;
+    truncated.resize(file.size() - 1);
+    EXPECT_THROW(GAMEBOY::Movie::deserialize(truncated), std::out_of_range);
+    movie.rom_checksum ^= 1;
+    EXPECT_THROW(GAMEBOY::MoviePlayer(gameboy, input_handler, movie), std::invalid_argument);
+}
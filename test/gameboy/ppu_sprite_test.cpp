@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <stdexcept>
 #include "gameboy/ppu_sprite.h"
 #include "gameboy/ppu.h"
 #include "cpu_init_helper.h"
@@ -36,9 +37,10 @@ TEST(PPU_Spritemap_test, SingleLine) {
     helper.addressDispatcher.write(GAMEBOY::OAM_LO+3, 0);
     helper.addressDispatcher.lock(GAMEBOY::AddressDispatcher::LOCKABLE::OAM);
     helper.addressDispatcher.lock(GAMEBOY::AddressDispatcher::LOCKABLE::VRAM);
-    GAMEBOY::PPU_Spritemap spritemap(helper.addressDispatcher);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_Spritemap spritemap(helper.addressDispatcher.stats());
     auto line_buffer = std::make_shared<GAMEBOY::LINE_PIXELS>();
-    spritemap.render_line(0, line_buffer);
+    spritemap.render_line(render_state, 0, line_buffer);
     for (size_t i=0; i<8; i++)
     {
         EXPECT_EQ((*line_buffer)[i], i%4);
@@ -69,7 +71,7 @@ TEST(PPU_Sprite_test, SpriteAlone) {
         }
         lo = !lo;
     }
-    GAMEBOY::PPU_Sprite sprite(helper.addressDispatcher, 0, false);
+    GAMEBOY::PPU_Sprite sprite(GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher), 0, false);
     for (size_t y=0; y<8; y++)
     {
         for (size_t x=0; x<8; x++)
@@ -91,7 +93,7 @@ TEST(PPU_Sprite_test, ArrowSprite) {
     {
         helper.addressDispatcher.write(tile_start+i, sprite_bytes[i]);
     }
-    GAMEBOY::PPU_Sprite sprite(helper.addressDispatcher, 0, false);
+    GAMEBOY::PPU_Sprite sprite(GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher), 0, false);
     uint8_t sprite_render_bytes[] = {
         0, 0, 0, 0, 0, 0, 0, 0,
         0, 3, 3, 0, 0, 0, 0, 0,
@@ -111,6 +113,33 @@ TEST(PPU_Sprite_test, ArrowSprite) {
     }
 }
 
+TEST(PPU_Spritecache_test, SizeSwitch) {
+    CpuInitHelper helper;
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x82);
+    // tile 0 all colour 3, tile 1 below it all colour 1
+    uint16_t tile_start = GAMEBOY::VRAM_LO;
+    for (int i=0; i<16; i++)
+    {
+        helper.addressDispatcher.write(tile_start+i, 0xFF);
+        helper.addressDispatcher.write(tile_start+16+i, (i % 2) ? 0xFF : 0x00);
+    }
+    auto state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_Spritecache cache(helper.addressDispatcher.stats());
+    auto small = cache.get(state, 0, false);
+    EXPECT_THROW(small->get_pixel(0, 8), std::out_of_range);
+    EXPECT_EQ(cache.get(state, 0, false), small);
+    // switching LCDC to 8x16 must not reuse the 8x8 sprite
+    auto large = cache.get(state, 0, true);
+    EXPECT_NE(large, small);
+    EXPECT_EQ(large->get_pixel(0, 0), 3);
+    EXPECT_EQ(large->get_pixel(0, 8), 1);
+    EXPECT_EQ(cache.get(state, 0, true), large);
+    // and switching back decodes 8x8 again
+    auto small_again = cache.get(state, 0, false);
+    EXPECT_NE(small_again, large);
+    EXPECT_THROW(small_again->get_pixel(0, 8), std::out_of_range);
+}
+
 TEST(PPU_OamEntry_test, ArrowSprite) {
     CpuInitHelper helper;
     // set bit 7 to enable PPU
@@ -134,8 +163,9 @@ TEST(PPU_OamEntry_test, ArrowSprite) {
     helper.addressDispatcher.write(GAMEBOY::OAM_LO+2, 0);
     // oam attrs
     helper.addressDispatcher.write(GAMEBOY::OAM_LO+3, 0);
-    GAMEBOY::PPU_OamEntry oam0(0, helper.addressDispatcher);
-    GAMEBOY::PPU_Spritecache sprite_cache(helper.addressDispatcher);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_OamEntry oam0(render_state, 0);
+    GAMEBOY::PPU_Spritecache sprite_cache(helper.addressDispatcher.stats());
     uint8_t sprite_render_bytes[] = {
         0, 0, 0, 0, 0, 0, 0, 0,
         0, 3, 3, 0, 0, 0, 0, 0,
@@ -197,17 +227,20 @@ TEST(PPU_test, SpriteIntegration) {
     helper.addressDispatcher.write(GAMEBOY::OAM_LO+2, 0);
     // oam attrs
     helper.addressDispatcher.write(GAMEBOY::OAM_LO+3, 0);
-    auto line_buffer = std::make_shared<GAMEBOY::LINE_PIXELS>();
-    GAMEBOY::PPU ppu(helper.addressDispatcher, line_buffer);
-    // run until outputs first line
-    while (!ppu.tick()) {}
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    // run until outputs first frame
+    while (ppu.frame_count() == 0)
+    {
+        helper.addressDispatcher.scheduler().advance(1);
+    }
+    auto& frame = ppu.framebuffer().front();
     for (size_t i=0; i<8; i++)
     {
-        EXPECT_EQ((*line_buffer)[i], i%4);
+        EXPECT_EQ(frame[i], i%4);
     }
-    for (size_t i=8; i<line_buffer->size(); i++)
+    for (size_t i=8; i<GAMEBOY::SCREEN_WIDTH; i++)
     {
-        EXPECT_EQ((*line_buffer)[i], 0);
+        EXPECT_EQ(frame[i], 0);
     }
 }
 
@@ -1,13 +1,22 @@
 #include <gtest/gtest.h>
 #include "gameboy/ppu.h"
+#include "gameboy/cpu_interrupt.h"
+#include "gameboy/state.h"
 #include "cpu_init_helper.h"
 
+// Advance the machine clock 1 dot, returns true when a frame has been completed
+static bool tick_dot(CpuInitHelper& helper, GAMEBOY::PPU& ppu)
+{
+    uint64_t frame_count = ppu.frame_count();
+    helper.addressDispatcher.scheduler().advance(1);
+    return ppu.frame_count() != frame_count;
+}
+
 TEST(PPU_test, StateMachine) {
     CpuInitHelper helper;
     // set bit 7 to enable PPU
     helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x80);
-    auto lb = std::make_shared<GAMEBOY::LINE_PIXELS>();
-    GAMEBOY::PPU ppu(helper.addressDispatcher, lb);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
     for (int k=0; k<10; k++)
     {
         for (int i=0; i<144; i++)
@@ -19,7 +28,7 @@ TEST(PPU_test, StateMachine) {
                 helper.addressDispatcher.write(GAMEBOY::OAM_LO, 0x00);
                 EXPECT_NE(helper.addressDispatcher.read(GAMEBOY::OAM_LO), 0x00);
                 EXPECT_EQ(ppu.mode_no(), 2);
-                ppu.tick();
+                tick_dot(helper, ppu);
             }
             for (int j=0; j<172; j++)
             {
@@ -28,7 +37,7 @@ TEST(PPU_test, StateMachine) {
                 helper.addressDispatcher.write(GAMEBOY::OAM_LO, 0x00);
                 EXPECT_NE(helper.addressDispatcher.read(GAMEBOY::OAM_LO), 0x00);
                 EXPECT_EQ(ppu.mode_no(), 3);
-                ppu.tick();
+                tick_dot(helper, ppu);
             }
             for (int j=0; j<204; j++)
             {
@@ -37,7 +46,7 @@ TEST(PPU_test, StateMachine) {
                 helper.addressDispatcher.write(GAMEBOY::OAM_LO, 0x33);
                 EXPECT_EQ(helper.addressDispatcher.read(GAMEBOY::OAM_LO), 0x33);
                 EXPECT_EQ(ppu.mode_no(), 0);
-                ppu.tick();
+                tick_dot(helper, ppu);
             }
         }
         for (int i=0; i<4560; i++)
@@ -47,7 +56,346 @@ TEST(PPU_test, StateMachine) {
             helper.addressDispatcher.write(GAMEBOY::OAM_LO, 0x44);
             EXPECT_EQ(helper.addressDispatcher.read(GAMEBOY::OAM_LO), 0x44);
             EXPECT_EQ(ppu.mode_no(), 1);
-            ppu.tick();
+            tick_dot(helper, ppu);
+        }
+    }
+}
+
+void init_fifo_test_vram(CpuInitHelper& helper)
+{
+    // set bit 7 to enable PPU
+    // set bit 4 to operate in unsigned 0x8000 base mode
+    // set bit 0 to enable BG
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x91);
+    // set BG palette so 3=3, 2=2, 1=1, 0=0
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_BGP, 0xE4);
+    // tile 0 repeats colour IDs 0,1,2,3 on every row
+    bool lo = true;
+    for (int i=0; i<16; i++)
+    {
+        helper.addressDispatcher.write(GAMEBOY::VRAM_LO+i, lo ? 0x33 : 0x55);
+        lo = !lo;
+    }
+    for (uint16_t map_index = 0; map_index < 0x400; map_index++)
+    {
+        helper.addressDispatcher.write(0x9800+map_index, 0);
+    }
+}
+
+TEST(PPU_test, FifoMidlinePalette) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    // 50 dots into mode 3, the first 38 pixels have been shifted out
+    for (int i=0; i<80+50; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    // invert the palette
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_BGP, 0x1B);
+    for (int i=0; i<172-50; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    EXPECT_EQ(ppu.mode_no(), 0);
+    auto lb = ppu.framebuffer().back();
+    for (size_t i=0; i<38; i++)
+    {
+        EXPECT_EQ(lb[i], i%4);
+    }
+    for (size_t i=38; i<GAMEBOY::SCREEN_WIDTH; i++)
+    {
+        EXPECT_EQ(lb[i], 3 - i%4);
+    }
+}
+
+TEST(PPU_test, FifoDisabledMidlinePalette) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    ppu.fifo_enabled(false);
+    for (int i=0; i<80+50; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_BGP, 0x1B);
+    for (int i=0; i<172-50; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    auto lb = ppu.framebuffer().back();
+    for (size_t i=0; i<GAMEBOY::SCREEN_WIDTH; i++)
+    {
+        EXPECT_EQ(lb[i], i%4);
+    }
+}
+
+TEST(PPU_test, FifoMatchesScanline) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_SCX, 3);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    // engage the FIFO from the very first pixel without changing the output
+    for (int i=0; i<80; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_SCX, 3);
+    for (int i=0; i<172; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    auto lb = ppu.framebuffer().back();
+    for (size_t i=0; i<GAMEBOY::SCREEN_WIDTH; i++)
+    {
+        EXPECT_EQ(lb[i], (i+3)%4);
+    }
+}
+
+TEST(PPU_test, MidlineTileWriteReachesNextLine) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    for (int i=0; i<80+50; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    // tile 0 becomes colour 3 throughout, part way through line 0
+    for (int i=0; i<16; i++)
+    {
+        helper.addressDispatcher.write(GAMEBOY::VRAM_LO+i, 0xFF);
+    }
+    // to the end of line 1's mode 3
+    for (int i=0; i<456-80-50 + 80+172; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    EXPECT_EQ(ppu.mode_no(), 0);
+    auto lb = ppu.framebuffer().back();
+    for (size_t i=0; i<GAMEBOY::SCREEN_WIDTH; i++)
+    {
+        EXPECT_EQ(lb[GAMEBOY::SCREEN_WIDTH + i], 3);
+    }
+}
+
+TEST(PPU_test, FramebufferSwap) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    uint64_t callback_sequence = 0;
+    ppu.framebuffer().on_frame_ready(
+        [&callback_sequence](const GAMEBOY::FRAME_PIXELS&, uint64_t sequence)
+        {
+            callback_sequence = sequence;
+        });
+    int frames = 0;
+    // only the transition into VBlank completes a frame
+    for (int i=0; i<456*144; i++)
+    {
+        if (tick_dot(helper, ppu))
+        {
+            frames++;
+        }
+    }
+    EXPECT_EQ(frames, 1);
+    EXPECT_EQ(ppu.framebuffer().sequence(), 1);
+    EXPECT_EQ(callback_sequence, 1);
+    auto& frame = ppu.framebuffer().front();
+    for (size_t y=0; y<GAMEBOY::SCREEN_HEIGHT; y++)
+    {
+        for (size_t x=0; x<GAMEBOY::SCREEN_WIDTH; x++)
+        {
+            EXPECT_EQ(frame[y*GAMEBOY::SCREEN_WIDTH + x], x%4);
+        }
+    }
+    for (int i=0; i<456*154; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    EXPECT_EQ(ppu.framebuffer().sequence(), 2);
+    EXPECT_EQ(callback_sequence, 2);
+}
+
+TEST(PPU_test, FrameSkipFixed) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    ppu.frameskip().mode(GAMEBOY::PPU_FrameSkip::MODE::FIXED);
+    ppu.frameskip().interval(3);
+    helper.addressDispatcher.write(GAMEBOY::INTERRUPT_FLAG, 0);
+    int frames = 0;
+    int vblank_interrupts = 0;
+    for (int i=0; i<456*154*6; i++)
+    {
+        if (tick_dot(helper, ppu))
+        {
+            frames++;
+        }
+        uint8_t interrupts = helper.addressDispatcher.read(GAMEBOY::INTERRUPT_FLAG);
+        if (interrupts & (uint8_t)GAMEBOY::InterruptType::VBLANK)
+        {
+            vblank_interrupts++;
+            helper.addressDispatcher.write(GAMEBOY::INTERRUPT_FLAG, 0);
+        }
+    }
+    // timing is unaffected, only frames 0, 1 & 4 are drawn
+    // as the first frame began when the PPU was created
+    EXPECT_EQ(frames, 6);
+    EXPECT_EQ(vblank_interrupts, 6);
+    EXPECT_EQ(ppu.framebuffer().sequence(), 3);
+}
+
+TEST(PPU_test, FrameSkipOnRequest) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    ppu.frameskip().mode(GAMEBOY::PPU_FrameSkip::MODE::ON_REQUEST);
+    // the first frame began when the PPU was created, so is always drawn
+    for (int i=0; i<456*154*3; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    EXPECT_EQ(ppu.framebuffer().sequence(), 1);
+    ppu.frameskip().request();
+    for (int i=0; i<456*154*2; i++)
+    {
+        tick_dot(helper, ppu);
+    }
+    EXPECT_EQ(ppu.framebuffer().sequence(), 2);
+    auto& frame = ppu.framebuffer().front();
+    EXPECT_EQ(frame[GAMEBOY::SCREEN_WIDTH*GAMEBOY::SCREEN_HEIGHT - 1], 3);
+}
+
+TEST(PPU_test, PaletteLutRebuiltOnWrite) {
+    CpuInitHelper helper;
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_BGP, 0x1B);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_OBP0, 0xE4);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_OBP1, 0xD2);
+    GAMEBOY::PALETTE_LUT bgp = {3, 2, 1, 0};
+    GAMEBOY::PALETTE_LUT obp0 = {0, 1, 2, 3};
+    GAMEBOY::PALETTE_LUT obp1 = {2, 0, 1, 3};
+    EXPECT_EQ(helper.addressDispatcher.palette(GAMEBOY::IOHandler::PALETTE::BGP), bgp);
+    EXPECT_EQ(helper.addressDispatcher.palette(GAMEBOY::IOHandler::PALETTE::OBP0), obp0);
+    EXPECT_EQ(helper.addressDispatcher.palette(GAMEBOY::IOHandler::PALETTE::OBP1), obp1);
+}
+
+TEST(PPU_test, FramebufferRgba) {
+    CpuInitHelper helper;
+    init_fifo_test_vram(helper);
+    GAMEBOY::PPU ppu(helper.addressDispatcher);
+    ppu.framebuffer().rgba_enabled(true);
+    while (!tick_dot(helper, ppu)) {}
+    auto& frame = ppu.framebuffer().front();
+    auto& frame_rgba = ppu.framebuffer().front_rgba();
+    for (size_t i=0; i<frame.size(); i++)
+    {
+        EXPECT_EQ(frame_rgba[i], GAMEBOY::DEFAULT_SHADE_RGBA[frame[i]]);
+    }
+}
+
+struct RenderTestMachine
+{
+    CpuInitHelper helper;
+    GAMEBOY::PPU ppu{helper.addressDispatcher};
+};
+
+// Writes to VRAM, OAM & the render registers at awkward dots, including mid-line
+static void render_stress_dot(CpuInitHelper& helper, uint32_t dot)
+{
+    auto& memory = helper.addressDispatcher;
+    if (dot % 97 == 0)
+    {
+        memory.write(GAMEBOY::IOHandler::PPU_REG_SCX, dot >> 3);
+    }
+    if (dot % 131 == 0)
+    {
+        memory.write(GAMEBOY::IOHandler::PPU_REG_BGP, dot*7);
+    }
+    if (dot % 53 == 0)
+    {
+        memory.write(GAMEBOY::VRAM_LO + (dot*13) % 0x2000, dot);
+    }
+    if (dot % 61 == 0)
+    {
+        memory.write(GAMEBOY::OAM_LO + dot % 0xA0, dot*3);
+    }
+    if (dot % 277 == 0)
+    {
+        memory.write(GAMEBOY::IOHandler::PPU_REG_OBP0, dot*5);
+    }
+    if (dot % 389 == 0)
+    {
+        // LCD, BG & sprites stay on, the tile data & map move around
+        memory.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x83 | ((dot >> 4) & 0x1C));
+    }
+}
+
+TEST(PPU_test, RenderThreadMatchesInline) {
+    RenderTestMachine inline_machine;
+    RenderTestMachine threaded;
+    threaded.ppu.render_thread(true);
+    EXPECT_TRUE(threaded.ppu.render_thread());
+    init_fifo_test_vram(inline_machine.helper);
+    init_fifo_test_vram(threaded.helper);
+    uint32_t dot = 0;
+    for (int frame=0; frame<8; frame++)
+    {
+        bool inline_done = false;
+        bool threaded_done = false;
+        while (!inline_done)
+        {
+            render_stress_dot(inline_machine.helper, dot);
+            render_stress_dot(threaded.helper, dot);
+            dot++;
+            inline_done = tick_dot(inline_machine.helper, inline_machine.ppu);
+            threaded_done = tick_dot(threaded.helper, threaded.ppu);
+            ASSERT_EQ(inline_done, threaded_done);
+        }
+        ASSERT_EQ(threaded.ppu.framebuffer().front(), inline_machine.ppu.framebuffer().front()) << frame;
+    }
+    if (GAMEBOY::Stats::ENABLED)
+    {
+        EXPECT_GT(inline_machine.helper.addressDispatcher.stats().fifo_lines, 0);
+    }
+    threaded.ppu.render_thread(false);
+    EXPECT_FALSE(threaded.ppu.render_thread());
+}
+
+TEST(PPU_test, RenderThreadSaveStateMidLine) {
+    RenderTestMachine threaded;
+    threaded.ppu.render_thread(true);
+    init_fifo_test_vram(threaded.helper);
+    uint32_t dot = 0;
+    // 60 dots into mode 3, after a mid-line VRAM write
+    while (dot < GAMEBOY::FRAME_CYCLES*2 + 80 + 60)
+    {
+        render_stress_dot(threaded.helper, dot++);
+        tick_dot(threaded.helper, threaded.ppu);
+    }
+    threaded.helper.addressDispatcher.write(GAMEBOY::VRAM_LO + 0x1800, 0x01);
+    std::vector<uint8_t> data;
+    GAMEBOY::StateWriter writer(data);
+    threaded.helper.addressDispatcher.scheduler().save_state(writer);
+    threaded.helper.addressDispatcher.save_state(writer);
+    threaded.ppu.save_state(writer);
+
+    RenderTestMachine loaded;
+    GAMEBOY::StateReader reader(data);
+    loaded.helper.addressDispatcher.scheduler().load_state(reader);
+    loaded.helper.addressDispatcher.load_state(reader);
+    loaded.ppu.load_state(reader);
+    EXPECT_TRUE(reader.done());
+    for (int frame=0; frame<2; frame++)
+    {
+        bool done = false;
+        while (!done)
+        {
+            render_stress_dot(threaded.helper, dot);
+            render_stress_dot(loaded.helper, dot);
+            dot++;
+            done = tick_dot(threaded.helper, threaded.ppu);
+            ASSERT_EQ(tick_dot(loaded.helper, loaded.ppu), done);
         }
+        ASSERT_EQ(loaded.ppu.framebuffer().front(), threaded.ppu.framebuffer().front()) << frame;
     }
 }
@@ -35,12 +35,10 @@ TEST(PPU_Tilemap_test, RepeatedPattern) {
         uint16_t map_base_addr = 0x9800;
         helper.addressDispatcher.write(map_base_addr+map_index, 0);
     }
-    GAMEBOY::PPU_Tilemap tilemap(helper.addressDispatcher);
-    auto line = tilemap.render_line(
-            GAMEBOY::PPU_Tilemap::MAP_SELECT::MAP0,
-            8,
-            0,
-            0);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_SCX, 8);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_Tilemap tilemap(helper.addressDispatcher.stats());
+    auto line = tilemap.render_line(render_state, 0);
     for (size_t i=0; i<line->size(); i++)
     {
         EXPECT_EQ((*line)[i], i%4);
@@ -82,23 +80,16 @@ TEST(PPU_Tilemap_test, SingleTile) {
     }
     // row 1, col 2 (zero indexed)
     helper.addressDispatcher.write(map_base_addr+34, 0);
-    GAMEBOY::PPU_Tilemap tilemap(helper.addressDispatcher);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_Tilemap tilemap(helper.addressDispatcher.stats());
     // just before row 1
-    auto line = tilemap.render_line(
-            GAMEBOY::PPU_Tilemap::MAP_SELECT::MAP0,
-            0,
-            0,
-            7);
+    auto line = tilemap.render_line(render_state, 7);
     for (size_t i=0; i<line->size(); i++)
     {
         EXPECT_EQ((*line)[i], 0);
     }
     // just after row 1
-    line = tilemap.render_line(
-            GAMEBOY::PPU_Tilemap::MAP_SELECT::MAP0,
-            0,
-            0,
-            16);
+    line = tilemap.render_line(render_state, 16);
     for (size_t i=0; i<line->size(); i++)
     {
         EXPECT_EQ((*line)[i], 0);
@@ -106,11 +97,7 @@ TEST(PPU_Tilemap_test, SingleTile) {
     // within row 1
     for (int i=0; i<8; i++)
     {
-        line = tilemap.render_line(
-                GAMEBOY::PPU_Tilemap::MAP_SELECT::MAP0,
-                0,
-                0,
-                8+i);
+        line = tilemap.render_line(render_state, 8+i);
         // just before col 2
         for (size_t i=0; i<16; i++)
         {
@@ -152,7 +139,7 @@ TEST(PPU_Tile_test, AllUnsigned) {
             }
             lo = !lo;
         }
-        GAMEBOY::PPU_Tile tile(helper.addressDispatcher, testing_tile_num);
+        GAMEBOY::PPU_Tile tile(GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher), testing_tile_num);
         for (size_t y=0; y<8; y++)
         {
             for (size_t x=0; x<8; x++)
@@ -185,7 +172,7 @@ TEST(PPU_getTileData_test, PositiveSigned) {
             }
             lo = !lo;
         }
-        GAMEBOY::PPU_Tile tile(helper.addressDispatcher, testing_tile_num);
+        GAMEBOY::PPU_Tile tile(GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher), testing_tile_num);
         for (size_t y=0; y<8; y++)
         {
             for (size_t x=0; x<8; x++)
@@ -218,7 +205,7 @@ TEST(PPU_getTileData_test, NegativeSigned) {
             }
             lo = !lo;
         }
-        GAMEBOY::PPU_Tile tile(helper.addressDispatcher, testing_tile_num);
+        GAMEBOY::PPU_Tile tile(GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher), testing_tile_num);
         for (size_t y=0; y<8; y++)
         {
             for (size_t x=0; x<8; x++)
@@ -229,3 +216,33 @@ TEST(PPU_getTileData_test, NegativeSigned) {
     }
 }
 
+
+TEST(PPU_Tilemap_test, WrapsRightEdgeOfMap1) {
+    CpuInitHelper helper;
+    // as above, but with the map from 0x9C00
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_LCDC, 0x99);
+    helper.addressDispatcher.write(0xFF47, 0xE4);
+    // tile 0 blank, tile 1 solid colour 3
+    for (int i=0; i<16; i++)
+    {
+        helper.addressDispatcher.write(GAMEBOY::VRAM_LO+i, 0x00);
+        helper.addressDispatcher.write(GAMEBOY::VRAM_LO+16+i, 0xFF);
+    }
+    uint16_t map_base_addr = 0x9C00;
+    for (uint16_t map_index = 0; map_index < 0x400; map_index++)
+    {
+        helper.addressDispatcher.write(map_base_addr+map_index, 0);
+    }
+    // only the first tile of the last row, the end of VRAM
+    helper.addressDispatcher.write(map_base_addr + 31*32, 1);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_SCY, 248);
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_SCX, 200);
+    auto render_state = GAMEBOY::PPU_RenderState::capture(helper.addressDispatcher);
+    GAMEBOY::PPU_Tilemap tilemap(helper.addressDispatcher.stats());
+    auto line = tilemap.render_line(render_state, 0);
+    // from x 56 the map wraps back round to its first column
+    for (size_t i=0; i<line->size(); i++)
+    {
+        EXPECT_EQ((*line)[i], i >= 56 && i < 64 ? 3 : 0) << "x " << i;
+    }
+}
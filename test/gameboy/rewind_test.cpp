@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/rewind.h"
+#include "test_rom.h"
+
+TEST(Rewind_test, DeltaRoundTrip) {
+    std::vector<uint8_t> from(1000, 0x55);
+    std::vector<uint8_t> to = from;
+    to[0] = 0;
+    to[10] = 1;
+    to[12] = 2;
+    to[500] = 3;
+    to[999] = 4;
+    std::vector<uint8_t> delta;
+    GAMEBOY::Rewind::encode_delta(from, to, delta);
+    // mostly unchanged, so far smaller than the buffers
+    EXPECT_LT(delta.size(), 32);
+    std::vector<uint8_t> result = from;
+    GAMEBOY::Rewind::apply_delta(delta.data(), delta.size(), result);
+    EXPECT_EQ(result, to);
+    GAMEBOY::Rewind::apply_delta(delta.data(), delta.size(), result);
+    EXPECT_EQ(result, from);
+    // identical buffers need no delta at all
+    GAMEBOY::Rewind::encode_delta(from, from, delta);
+    EXPECT_TRUE(delta.empty());
+    std::vector<uint8_t> shorter(999);
+    EXPECT_THROW(GAMEBOY::Rewind::encode_delta(from, shorter, delta), std::invalid_argument);
+}
+
+TEST(Rewind_test, StepBack) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    GAMEBOY::Rewind rewind(1024*1024);
+    std::vector<std::vector<uint8_t>> states;
+    for (int i=0; i<20; i++)
+    {
+        gameboy.run_frame();
+        rewind.capture(gameboy);
+        states.push_back(gameboy.save_state());
+    }
+    EXPECT_EQ(rewind.stats().captures, 20);
+    EXPECT_EQ(rewind.stats().history, 19);
+    EXPECT_LT(rewind.stats().used_bytes, 19*rewind.stats().state_bytes);
+    for (int i=18; i>=10; i--)
+    {
+        ASSERT_TRUE(rewind.step_back(gameboy));
+        ASSERT_EQ(gameboy.save_state(), states[i]);
+    }
+    // history continues on from the state stepped back to
+    gameboy.run_frame();
+    rewind.capture(gameboy);
+    ASSERT_TRUE(rewind.step_back(gameboy));
+    EXPECT_EQ(gameboy.save_state(), states[10]);
+    while (rewind.step_back(gameboy));
+    EXPECT_EQ(gameboy.save_state(), states[0]);
+    EXPECT_EQ(rewind.stats().history, 0);
+}
+
+TEST(Rewind_test, RingDropsOldest) {
+    ROMDATA rom = busy_test_rom();
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    GAMEBOY::Rewind rewind(128*1024, 2);
+    std::vector<std::vector<uint8_t>> states;
+    for (int i=0; i<60; i++)
+    {
+        gameboy.run_frame();
+        rewind.capture(gameboy);
+        if (i % 2 == 1)
+        {
+            states.push_back(gameboy.save_state());
+        }
+    }
+    EXPECT_EQ(rewind.stats().captures, 30);
+    size_t history = rewind.stats().history;
+    EXPECT_GT(history, 0);
+    EXPECT_LT(history, 29);
+    EXPECT_LE(rewind.stats().used_bytes, 128*1024);
+    // every snapshot still held is intact, back to the oldest
+    for (size_t i=0; i<history; i++)
+    {
+        ASSERT_TRUE(rewind.step_back(gameboy));
+        ASSERT_EQ(gameboy.save_state(), states[states.size() - 2 - i]);
+    }
+    EXPECT_FALSE(rewind.step_back(gameboy));
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "gameboy/scheduler.h"
+#include "gameboy/memory_dma.h"
+#include "cpu_init_helper.h"
+
+TEST(Scheduler_test, DispatchOrder) {
+    GAMEBOY::Scheduler scheduler;
+    std::vector<GAMEBOY::EventType> order;
+    for (auto type : {GAMEBOY::EventType::TIMER, GAMEBOY::EventType::PPU_MODE,
+            GAMEBOY::EventType::SERIAL_TRANSFER})
+    {
+        scheduler.handler(type, [&order, type](uint64_t) {
+            order.push_back(type);
+        });
+    }
+    scheduler.schedule(GAMEBOY::EventType::SERIAL_TRANSFER, 8);
+    scheduler.schedule(GAMEBOY::EventType::PPU_MODE, 8);
+    scheduler.schedule(GAMEBOY::EventType::TIMER, 12);
+    EXPECT_EQ(scheduler.next_due(), 8);
+    scheduler.advance(7);
+    EXPECT_TRUE(order.empty());
+    scheduler.advance(5);
+    // same cycle dispatches in priority order
+    std::vector<GAMEBOY::EventType> expected = {
+        GAMEBOY::EventType::PPU_MODE,
+        GAMEBOY::EventType::SERIAL_TRANSFER,
+        GAMEBOY::EventType::TIMER
+    };
+    EXPECT_EQ(order, expected);
+    EXPECT_EQ(scheduler.next_due(), GAMEBOY::Scheduler::NEVER);
+}
+
+TEST(Scheduler_test, RescheduleAndCancel) {
+    GAMEBOY::Scheduler scheduler;
+    std::vector<uint64_t> times;
+    scheduler.handler(GAMEBOY::EventType::TIMER, [&times](uint64_t time) {
+        times.push_back(time);
+    });
+    scheduler.schedule(GAMEBOY::EventType::TIMER, 4);
+    // replaces the pending event
+    scheduler.schedule(GAMEBOY::EventType::TIMER, 16);
+    EXPECT_EQ(scheduler.due(GAMEBOY::EventType::TIMER), 16);
+    scheduler.advance(20);
+    ASSERT_EQ(times.size(), 1);
+    EXPECT_EQ(times[0], 16);
+    EXPECT_FALSE(scheduler.pending(GAMEBOY::EventType::TIMER));
+    scheduler.schedule_in(GAMEBOY::EventType::TIMER, 4);
+    scheduler.cancel(GAMEBOY::EventType::TIMER);
+    scheduler.advance(100);
+    EXPECT_EQ(times.size(), 1);
+}
+
+TEST(Scheduler_test, OamDma) {
+    CpuInitHelper helper;
+    GAMEBOY::DmaController dma(helper.addressDispatcher);
+    for (uint16_t i=0; i<0xA0; i++)
+    {
+        helper.addressDispatcher.write(GAMEBOY::WRAM_LO + i, i);
+    }
+    helper.addressDispatcher.write(GAMEBOY::IOHandler::PPU_REG_DMA, 0xC0);
+    // 1 M-cycle to start, 160 to copy & 1 to finish
+    for (int i=0; i<161; i++)
+    {
+        helper.addressDispatcher.scheduler().advance(4);
+        EXPECT_EQ(helper.addressDispatcher.read(GAMEBOY::WRAM_LO), 0xFF);
+    }
+    helper.addressDispatcher.scheduler().advance(4);
+    for (uint16_t i=0; i<0xA0; i++)
+    {
+        EXPECT_EQ(helper.addressDispatcher.read(GAMEBOY::OAM_LO + i), i);
+    }
+}
+
+TEST(Scheduler_test, SerialTransfer) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::INTERRUPT_FLAG, 0);
+    memory.write(GAMEBOY::IOHandler::SERIAL_DATA, 0x42);
+    memory.write(GAMEBOY::IOHandler::SERIAL_CONTROL, 0x81);
+    memory.scheduler().advance(4095);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::SERIAL_CONTROL) & 0x80, 0x80);
+    EXPECT_EQ(memory.read(GAMEBOY::INTERRUPT_FLAG) & 0x08, 0);
+    memory.scheduler().advance(1);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::SERIAL_CONTROL) & 0x80, 0);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::SERIAL_DATA), 0xFF);
+    EXPECT_EQ(memory.read(GAMEBOY::INTERRUPT_FLAG) & 0x08, 0x08);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "gameboy/spsc_queue.h"
+
+TEST(SpscQueue_test, FullAndEmpty) {
+    GAMEBOY::SpscQueue<int, 4> queue;
+    int value = 0;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(value));
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_TRUE(queue.push(3));
+    // one slot is always kept free
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(queue.push(4));
+    for (int expected=2; expected<=4; expected++)
+    {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueue_test, TwoThreadsInOrder) {
+    GAMEBOY::SpscQueue<uint32_t, 8> queue;
+    const uint32_t count = 100000;
+    std::thread producer([&queue, count]()
+    {
+        for (uint32_t i=0; i<count;)
+        {
+            if (queue.push(i))
+            {
+                i++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 0;
+    uint32_t value;
+    while (expected < count)
+    {
+        if (queue.pop(value))
+        {
+            EXPECT_EQ(value, expected);
+            expected++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(SpscRing_test, PartialWritesAndReads) {
+    GAMEBOY::SpscRing<int, 8> ring;
+    int values[16];
+    for (int i=0; i<16; i++)
+    {
+        values[i] = i;
+    }
+    int out[10] = {};
+    EXPECT_EQ(ring.read(out, 4), 0);
+    EXPECT_EQ(ring.write(values, 5), 5);
+    EXPECT_EQ(ring.read(out, 3), 3);
+    EXPECT_EQ(out[2], 2);
+    // wraps around, all 8 slots are usable
+    EXPECT_EQ(ring.write(values + 5, 10), 6);
+    EXPECT_EQ(ring.size(), 8);
+    EXPECT_EQ(ring.read(out, 10), 8);
+    for (int i=0; i<8; i++)
+    {
+        EXPECT_EQ(out[i], i + 3);
+    }
+}
+
+TEST(SpscRing_test, TwoThreadsInOrder) {
+    GAMEBOY::SpscRing<uint32_t, 64> ring;
+    const uint32_t count = 100000;
+    std::thread producer([&ring, count]()
+    {
+        uint32_t block[7];
+        for (uint32_t i=0; i<count;)
+        {
+            uint32_t size = std::min<uint32_t>(7, count - i);
+            for (uint32_t j=0; j<size; j++)
+            {
+                block[j] = i + j;
+            }
+            uint32_t written = ring.write(block, size);
+            i += written;
+            if (written == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 0;
+    uint32_t block[5];
+    while (expected < count)
+    {
+        size_t read = ring.read(block, 5);
+        for (size_t j=0; j<read; j++)
+        {
+            EXPECT_EQ(block[j], expected++);
+        }
+    }
+    producer.join();
+}
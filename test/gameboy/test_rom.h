@@ -0,0 +1,32 @@
+#ifndef __TEST_ROM_H__
+#define __TEST_ROM_H__
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+#include "gameboy/rom.h"
+
+// 32KB ROM without a mapper, with the given code at the entry point
+inline ROMDATA test_rom(const std::vector<uint8_t>& code)
+{
+    ROMDATA rom(std::vector<uint8_t>(32768, 0));
+    std::copy(code.cbegin(), code.cend(), rom.begin() + 0x100);
+    return rom;
+}
+
+/*
+ * Runs the given setup code, then copies TIMA & LY across memory from
+ * VRAM upwards, so every frame differs
+ */
+inline ROMDATA busy_test_rom(std::vector<uint8_t> setup = {})
+{
+    // LD A,0x05; LDH (0x07),A; LD HL,0x8000
+    // LDH A,(0x05); LD (HL+),A; LDH A,(0x44); LDH (0x43),A; INC B; JR -10
+    const std::vector<uint8_t> loop = {0x3E, 0x05, 0xE0, 0x07, 0x21, 0x00, 0x80,
+        0xF0, 0x05, 0x22, 0xF0, 0x44, 0xE0, 0x43, 0x04, 0x18, 0xF6};
+    setup.insert(setup.end(), loop.cbegin(), loop.cend());
+    return test_rom(setup);
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "gameboy/memory_io.h"
+#include "cpu_init_helper.h"
+
+TEST(Timer_test, DivFromClock) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.scheduler().advance(256*3 + 4);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 3);
+    // reset on write, counting restarts from this cycle
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_DIV, 0x55);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 0);
+    memory.scheduler().advance(252);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 0);
+    memory.scheduler().advance(4);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 1);
+}
+
+TEST(Timer_test, TimaOverflow) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::INTERRUPT_FLAG, 0);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TMA, 0x80);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0xFE);
+    // enabled, increment every 4 M-cycles
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    memory.scheduler().advance(16);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0xFF);
+    memory.scheduler().advance(16);
+    // TIMA reads 0 for the M-cycle before TMA is copied in
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x00);
+    EXPECT_EQ(memory.read(GAMEBOY::INTERRUPT_FLAG) & 0x04, 0);
+    memory.scheduler().advance(4);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x80);
+    EXPECT_EQ(memory.read(GAMEBOY::INTERRUPT_FLAG) & 0x04, 0x04);
+}
+
+TEST(Timer_test, Disabled) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x01);
+    memory.scheduler().advance(1024);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0);
+    EXPECT_FALSE(memory.scheduler().pending(GAMEBOY::EventType::TIMER));
+}
+
+TEST(Timer_test, SingleEventPerOverflow) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    // nothing runs until the 256th increment overflows
+    EXPECT_EQ(memory.scheduler().due(GAMEBOY::EventType::TIMER), 256*16 + 4);
+    memory.scheduler().advance(100*16);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 100);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0xF0);
+    EXPECT_EQ(memory.scheduler().due(GAMEBOY::EventType::TIMER), 116*16 + 4);
+}
+
+TEST(Timer_test, DivResetFallingEdge) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    // increment every 64 M-cycles, on bit 7 of the system counter
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x07);
+    memory.scheduler().advance(128);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0);
+    // resetting the counter with bit 7 set increments TIMA
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_DIV, 0);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 1);
+    // the next increment is a full period after the reset
+    memory.scheduler().advance(252);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 1);
+    memory.scheduler().advance(4);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 2);
+    // with bit 7 clear there is no extra increment
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_DIV, 0);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 2);
+}
+
+TEST(Timer_test, TacDisableFallingEdge) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    memory.scheduler().advance(8);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x01);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 1);
+}
+
+TEST(Timer_test, TimaWriteAbortsReload) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::INTERRUPT_FLAG, 0);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TMA, 0x80);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0xFF);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    memory.scheduler().advance(16);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x00);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0x10);
+    memory.scheduler().advance(4);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x10);
+    EXPECT_EQ(memory.read(GAMEBOY::INTERRUPT_FLAG) & 0x04, 0);
+}
+
+TEST(Timer_test, ReloadCycleWrites) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TMA, 0x80);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0xFF);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    memory.scheduler().advance(20);
+    // TIMA writes are ignored while TMA is copied
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0x10);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x80);
+    // TMA writes go through to TIMA
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TMA, 0x90);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x90);
+    memory.scheduler().advance(4);
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TIMA, 0x10);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 0x10);
+}
+
+TEST(Timer_test, StopHoldsCounter) {
+    CpuInitHelper helper;
+    auto& memory = helper.addressDispatcher;
+    memory.write(GAMEBOY::IOHandler::TIMER_REG_TAC, 0x05);
+    memory.scheduler().advance(100*16);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 100);
+    // STOP resets DIV, then neither DIV nor TIMA count until it ends
+    memory.timer().stop();
+    memory.scheduler().advance(1000*16);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 0);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 100);
+    EXPECT_FALSE(memory.scheduler().pending(GAMEBOY::EventType::TIMER));
+    memory.timer().resume();
+    uint64_t resumed = memory.scheduler().now();
+    EXPECT_EQ(memory.scheduler().due(GAMEBOY::EventType::TIMER), resumed + 156*16 + 4);
+    memory.scheduler().advance(256);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_DIV), 1);
+    EXPECT_EQ(memory.read(GAMEBOY::IOHandler::TIMER_REG_TIMA), 116);
+}
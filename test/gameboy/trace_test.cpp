@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "gameboy/cpu_disasm.h"
+#include "gameboy/file.h"
+#include "gameboy/gameboy.h"
+#include "gameboy/trace.h"
+#include "test_rom.h"
+
+// LD A,$42; LD ($C000),A; JR -2 for two frames
+static std::vector<uint8_t> record_trace(bool memory_accesses)
+{
+    ROMDATA rom = test_rom({0x3E, 0x42, 0xEA, 0x00, 0xC0, 0x18, 0xFE});
+    GAMEBOY::InputHandler input_handler;
+    GAMEBOY::Gameboy gameboy(rom, input_handler);
+    // one file per test, so they can run in parallel
+    std::string name = testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::string path = testing::TempDir() + "trace_test_" + name + ".bin";
+    GAMEBOY::TraceRecorder tracer(path, memory_accesses);
+    gameboy.tracer(&tracer);
+    gameboy.run_frame();
+    gameboy.run_frame();
+    gameboy.tracer(nullptr);
+    EXPECT_TRUE(tracer.close());
+    auto data = GAMEBOY::FileInterface::standard().read(path);
+    EXPECT_TRUE(data.has_value());
+    std::remove(path.c_str());
+    return data.value_or(std::vector<uint8_t>());
+}
+
+TEST(Trace_test, Instructions) {
+    std::vector<uint8_t> data = record_trace(false);
+    GAMEBOY::TraceReader reader(data.data(), data.size());
+    EXPECT_FALSE(reader.memory_accesses());
+    ASSERT_GT(reader.size(), 3);
+    EXPECT_EQ(reader[0].kind, GAMEBOY::TraceKind::INSTRUCTION);
+    EXPECT_EQ(reader[0].cycle, 0);
+    EXPECT_EQ(reader[0].pc, 0x100);
+    EXPECT_EQ(reader[0].bank, 1);
+    EXPECT_EQ(reader[0].opcode, 0x3E);
+    EXPECT_EQ(reader[0].operands[0], 0x42);
+    EXPECT_EQ(reader[0].af, 0x01B0);
+    EXPECT_EQ(reader[1].pc, 0x102);
+    EXPECT_EQ(reader[1].cycle, 8);
+    EXPECT_EQ(reader[1].af, 0x42B0);
+    EXPECT_EQ(reader[1].operands[0], 0x00);
+    EXPECT_EQ(reader[1].operands[1], 0xC0);
+    EXPECT_EQ(reader[2].pc, 0x105);
+    EXPECT_EQ(reader[2].cycle, 24);
+}
+
+TEST(Trace_test, FrameIndex) {
+    std::vector<uint8_t> data = record_trace(false);
+    GAMEBOY::TraceReader reader(data.data(), data.size());
+    ASSERT_EQ(reader.frames(), 2);
+    const GAMEBOY::TraceRecord& first = reader[reader.frame_start(0)];
+    EXPECT_EQ(first.kind, GAMEBOY::TraceKind::FRAME);
+    EXPECT_EQ(first.cycle, 144*456);
+    const GAMEBOY::TraceRecord& second = reader[reader.frame_start(1)];
+    EXPECT_EQ(second.kind, GAMEBOY::TraceKind::FRAME);
+    EXPECT_EQ(second.cycle, 144*456 + GAMEBOY::FRAME_CYCLES);
+    EXPECT_THROW(reader.frame_start(2), std::out_of_range);
+}
+
+TEST(Trace_test, MemoryAccesses) {
+    std::vector<uint8_t> data = record_trace(true);
+    GAMEBOY::TraceReader reader(data.data(), data.size());
+    EXPECT_TRUE(reader.memory_accesses());
+    ASSERT_GT(reader.size(), 7);
+    EXPECT_EQ(reader[1].kind, GAMEBOY::TraceKind::READ);
+    EXPECT_EQ(reader[1].addr, 0x101);
+    EXPECT_EQ(reader[1].data, 0x42);
+    EXPECT_EQ(reader[2].kind, GAMEBOY::TraceKind::INSTRUCTION);
+    // LD ($C000),A reads its operands, then writes, attributed to its PC
+    EXPECT_EQ(reader[3].kind, GAMEBOY::TraceKind::READ);
+    EXPECT_EQ(reader[4].kind, GAMEBOY::TraceKind::READ);
+    EXPECT_EQ(reader[5].kind, GAMEBOY::TraceKind::WRITE);
+    EXPECT_EQ(reader[5].pc, 0x102);
+    EXPECT_EQ(reader[5].addr, 0xC000);
+    EXPECT_EQ(reader[5].data, 0x42);
+    EXPECT_GT(reader[5].cycle, reader[2].cycle);
+    EXPECT_LT(reader[5].cycle, reader[6].cycle);
+}
+
+TEST(Trace_test, Unfinished) {
+    std::vector<uint8_t> data = record_trace(false);
+    GAMEBOY::TraceReader closed(data.data(), data.size());
+    // as if the recorder never got to write the index & header
+    GAMEBOY::TraceHeader header = closed.header();
+    header.record_count = 0;
+    header.frame_count = 0;
+    header.frame_index_offset = 0;
+    std::memcpy(data.data(), &header, sizeof(header));
+    data.resize(sizeof(header) + closed.size()*sizeof(GAMEBOY::TraceRecord) + 5);
+    GAMEBOY::TraceReader reader(data.data(), data.size());
+    EXPECT_EQ(reader.size(), closed.size());
+    EXPECT_EQ(reader.frames(), 0);
+    data[0] = 'X';
+    EXPECT_THROW(GAMEBOY::TraceReader(data.data(), data.size()), std::invalid_argument);
+}
+
+TEST(Trace_test, Disassemble) {
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0x00, 0, 0), "NOP");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0x3E, 0x42, 0), "LD A,$42");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xEA, 0x00, 0xC0), "LD ($C000),A");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xE0, 0x40, 0), "LDH ($FF40),A");
+    EXPECT_EQ(GAMEBOY::disassemble(0x108, 0x18, 0xFE, 0), "JR $0108");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0x20, 0x05, 0), "JR NZ,$0107");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xF8, 0xFE, 0), "LD HL,SP-2");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xE8, 0x03, 0), "ADD SP,3");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0x7E, 0, 0), "LD A,(HL)");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0x76, 0, 0), "HALT");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xAF, 0, 0), "XOR A");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xCB, 0x37, 0), "SWAP A");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xCB, 0x7C, 0), "BIT 7,H");
+    EXPECT_EQ(GAMEBOY::disassemble(0x100, 0xD3, 0, 0), "DB $D3");
+    EXPECT_EQ(GAMEBOY::instruction_length(0x00), 1);
+    EXPECT_EQ(GAMEBOY::instruction_length(0x3E), 2);
+    EXPECT_EQ(GAMEBOY::instruction_length(0xCD), 3);
+    EXPECT_EQ(GAMEBOY::instruction_length(0xCB), 2);
+    EXPECT_EQ(GAMEBOY::instruction_length(0x10), 2);
+}